@@ -10,7 +10,10 @@
 import sys
 import termios
 import time
+from collections.abc import Callable
+from contextlib import suppress
 from pty import CHILD, fork
+from typing import Any
 
 from kitty.constants import kitten_exe
 from kitty.fast_data_types import Screen, safe_pipe
@@ -82,8 +85,142 @@ def parse_bytes(data: bytes|memoryview) -> None:
         sys.stdout.write(str(screen.linebuf))
 
 
+def run_pixel_kernels_benchmark(width: int = 512, iterations: int = 20000) -> None:
+    from kitty.fast_data_types import benchmark_pixel_kernels, has_avx2, has_sse4_2
+    impls = {'scalar': 1}
+    if has_sse4_2:
+        impls['128'] = 2
+    if has_avx2:
+        impls['256'] = 3
+    for name, which in impls.items():
+        for kernel, secs in benchmark_pixel_kernels(which, width, iterations).items():
+            print(f'{name:>6} {kernel:24} {secs * 1e9 / (width * iterations):.3f} ns/pixel')
+
+
+def run_disk_cache_encryption_benchmark(size: int = 16 * 1024 * 1024, iterations: int = 64) -> None:
+    from kitty.fast_data_types import benchmark_disk_cache_encryption
+    for mode in ('xor', 'aes-ctr', 'chacha20'):
+        secs = benchmark_disk_cache_encryption(mode, size, iterations)
+        print(f'{mode:>9}: {size * iterations / secs / 1e9:6.2f} GB/s')
+
+
+def run_spawn_benchmark(sizes_in_mb: tuple[int, ...] = (0, 512, 2048), iterations: int = 50) -> None:
+    # Reports the median latency of spawning a child with fork(), with
+    # posix_spawn() + the spawn helper and via the zygote as the RSS of the
+    # parent grows
+    from kitty.child import zygote
+    from kitty.constants import spawn_helper_exe
+    from kitty.fast_data_types import spawn
+    helper = spawn_helper_exe()
+    if not helper:
+        raise SystemExit('The spawn helper has not been built')
+    zygote_fd = zygote.fd_for_spawn()
+
+    def median_latency(spawn_helper: str, zygote_fd: int = -1) -> float:
+        times = []
+        for i in range(iterations):
+            master, slave = os.openpty()
+            ready_read_fd, ready_write_fd = os.pipe()
+            os.set_inheritable(ready_read_fd, True)
+            st = time.monotonic()
+            pid = spawn('/bin/true', '/', ('true',), ('PATH=/usr/bin:/bin',), master, slave, -1, -1, ready_read_fd, ready_write_fd,
+                        (), kitten_exe(), False, (), spawn_helper, zygote_fd)
+            times.append(time.monotonic() - st)
+            for fd in (slave, ready_read_fd, ready_write_fd):
+                os.close(fd)
+            os.waitpid(pid, 0)
+            os.close(master)
+        return sorted(times)[len(times) // 2] * 1000
+
+    for mb in sizes_in_mb:
+        ballast = bytearray(mb * 1024 * 1024)
+        for i in range(0, len(ballast), 4096):
+            ballast[i] = 1
+        zygote_latency = f'{median_latency(helper, zygote_fd):7.3f} ms' if zygote_fd > -1 else 'unsupported'
+        print(f'RSS +{mb:5d} MB: fork: {median_latency(""):7.3f} ms posix_spawn: {median_latency(helper):7.3f} ms zygote: {zygote_latency}')
+        del ballast
+    zygote.shutdown()
+
+
+def run_cell_ranges_benchmark(columns: int = 200, rows: int = 60) -> None:
+    # Reports how many cell instances the cell program draws per frame when
+    # only the cells before the trailing default background cells of each row
+    # are drawn, for a few typical kinds of screen content.
+    from kitty.fast_data_types import test_cell_data_row_extents
+    from kitty.fonts.render import setup_for_testing
+    with open(__file__) as f:
+        source = f.read().splitlines()
+    workloads = {
+        'source code': source,
+        'shell session': [f'$ ls -l dir{i}' if i % 8 == 0 else f'-rw-r--r-- 1 user user {i * 137:6d} file{i}.txt' for i in range(rows)],
+        'full width': ['=' * columns] * rows,
+    }
+    with setup_for_testing() as (sprites, cell_width, cell_height):
+        for name, lines in workloads.items():
+            screen = Screen(None, rows, columns, 0, cell_width, cell_height, 0, None)
+            for i, line in enumerate(lines[:rows]):
+                if i:
+                    screen.carriage_return(), screen.linefeed()
+                screen.draw(line[:columns])
+            extents = test_cell_data_row_extents(screen)
+            drawn = sum(max(c, s) for c, s in extents)
+            total = rows * columns
+            print(f'{name:>14}: {drawn:6d} of {total} cells drawn ({100 * drawn / total:5.1f}%), {total / max(1, drawn):.1f}x fewer instances')
+
+
+def run_startup_benchmark(iterations: int = 10, timeout: float = 30) -> None:
+    # Reports the time taken by kitty to show its first frame and to import
+    # its modules, using the startup profiler. Needs a display.
+    import json
+    import subprocess
+    import tempfile
+
+    from kitty.constants import kitty_exe
+    results: list[dict[str, Any]] = []
+    with tempfile.TemporaryDirectory() as tdir:
+        output = os.path.join(tdir, 'profile.json')
+        env = dict(os.environ, KITTY_PROFILE_STARTUP=output)
+        for i in range(iterations):
+            with suppress(FileNotFoundError):
+                os.remove(output)
+            p = subprocess.Popen([kitty_exe(), '--config=NONE', 'sleep', str(timeout)], env=env)
+            # the profile is written once the first frame is shown
+            end = time.monotonic() + timeout
+            while not os.path.exists(output) and p.poll() is None and time.monotonic() < end:
+                time.sleep(0.01)
+            p.terminate()
+            p.wait()
+            try:
+                with open(output) as f:
+                    results.append(json.load(f))
+            except FileNotFoundError:
+                raise SystemExit('kitty did not write its startup profile, is there a display?')
+
+    def median(key: Callable[[dict[str, Any]], float]) -> float:
+        return sorted(map(key, results))[len(results) // 2]
+
+    print(f'Median of {iterations} runs:')
+    for name in results[0]['marks']:
+        print(f'{median(lambda r: r["marks"].get(name, 0)):9.2f} ms  {name}')
+    print(f'{median(lambda r: r["import_time"]):9.2f} ms  importing {results[0]["num_modules"]} modules')
+
+
 def main() -> None:
-    run_parsing_benchmark()
+    which = sys.argv[1] if len(sys.argv) > 1 else 'parsing'
+    if which == 'parsing':
+        run_parsing_benchmark()
+    elif which == 'pixel-kernels':
+        run_pixel_kernels_benchmark()
+    elif which == 'cell-ranges':
+        run_cell_ranges_benchmark()
+    elif which == 'disk-cache-encryption':
+        run_disk_cache_encryption_benchmark()
+    elif which == 'spawn':
+        run_spawn_benchmark()
+    elif which == 'startup':
+        run_startup_benchmark()
+    else:
+        raise SystemExit(f'Unknown benchmark: {which}')
 
 
 if __name__ == '__main__':
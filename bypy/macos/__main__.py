@@ -110,6 +110,7 @@ def do_sign(app_dir: str) -> None:
         # Sign kitten
         with current_dir('MacOS'):
             codesign('kitten')
+            codesign('kitty-spawn-helper')
         # Sign sub-apps
         for x in os.listdir('.'):
             if x.endswith('.app'):
@@ -385,6 +386,7 @@ def freeze_python(self):
         shutil.rmtree(self.python_stdlib)
         iv['build_frozen_launcher']([path_to_freeze_dir(), self.obj_dir])
         os.rename(join(dirname(self.contents_dir), 'bin', 'kitty'), join(self.contents_dir, 'MacOS', 'kitty'))
+        os.rename(join(dirname(self.contents_dir), 'bin', 'kitty-spawn-helper'), join(self.contents_dir, 'MacOS', 'kitty-spawn-helper'))
         shutil.rmtree(join(dirname(self.contents_dir), 'bin'))
         self.fix_dependencies_in_lib(join(self.contents_dir, 'MacOS', 'kitty'))
         for f in glob.glob(join(self.contents_dir, '*.app', 'Contents', 'MacOS', '*')):
@@ -286,7 +286,7 @@ def parsers() -> None:
     keymap: KeymapType = {
         'a': ('action', flag('tTqpdfac')),
         'd': ('delete_action', flag('aAiIcCfFnNpPqQrRxXyYzZ')),
-        't': ('transmission_type', flag('dfts')),
+        't': ('transmission_type', flag('dftsS')),
         'o': ('compressed', flag('z')),
         'f': ('format', 'uint'),
         'm': ('more', 'uint'),
@@ -203,6 +203,26 @@ static void swapBuffersEGL(_GLFWwindow* window)
     eglSwapBuffers(_glfw.egl.display, window->context.egl.surface);
 }
 
+static void swapBuffersWithDamageEGL(_GLFWwindow* window, const int* rects, int num_rects)
+{
+    if (window != _glfwPlatformGetTls(&_glfw.contextSlot))
+    {
+        _glfwInputError(GLFW_PLATFORM_ERROR,
+                        "EGL: The context must be current on the calling thread when swapping buffers");
+        return;
+    }
+
+    eglSwapBuffersWithDamage(_glfw.egl.display, window->context.egl.surface, (const EGLint*)rects, num_rects);
+}
+
+static int bufferAgeEGL(_GLFWwindow* window)
+{
+    EGLint age = 0;
+    if (!eglQuerySurface(_glfw.egl.display, window->context.egl.surface, EGL_BUFFER_AGE_EXT, &age))
+        return 0;
+    return age;
+}
+
 static void swapIntervalEGL(int interval)
 {
     eglSwapInterval(_glfw.egl.display, interval);
@@ -435,6 +455,16 @@ bool _glfwInitEGL(void)
         extensionSupportedEGL("EGL_KHR_context_flush_control");
     _glfw.egl.EXT_present_opaque =
         extensionSupportedEGL("EGL_EXT_present_opaque");
+    _glfw.egl.EXT_buffer_age =
+        extensionSupportedEGL("EGL_EXT_buffer_age");
+    // With Wayland, eglSwapBuffersWithDamage() sends the damage to the
+    // compositor using wl_surface.damage_buffer
+    if (extensionSupportedEGL("EGL_KHR_swap_buffers_with_damage"))
+        _glfw.egl.SwapBuffersWithDamage = (PFN_eglSwapBuffersWithDamage)
+            eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+    else if (extensionSupportedEGL("EGL_EXT_swap_buffers_with_damage"))
+        _glfw.egl.SwapBuffersWithDamage = (PFN_eglSwapBuffersWithDamage)
+            eglGetProcAddress("eglSwapBuffersWithDamageEXT");
 
     return true;
 }
@@ -726,6 +756,10 @@ bool _glfwCreateContextEGL(_GLFWwindow* window,
 
     window->context.makeCurrent = makeContextCurrentEGL;
     window->context.swapBuffers = swapBuffersEGL;
+    if (_glfw.egl.SwapBuffersWithDamage)
+        window->context.swapBuffersWithDamage = swapBuffersWithDamageEGL;
+    if (_glfw.egl.EXT_buffer_age)
+        window->context.bufferAge = bufferAgeEGL;
     window->context.swapInterval = swapIntervalEGL;
     window->context.extensionSupported = extensionSupportedEGL;
     window->context.getProcAddress = getProcAddressEGL;
@@ -5551,6 +5551,15 @@ GLFWAPI GLFWwindow* glfwGetCurrentContext(void);
  *  @ingroup window
  */
 GLFWAPI void glfwSwapBuffers(GLFWwindow* window);
+/* Same as glfwSwapBuffers() except that the compositor is told that only
+ * the specified rectangles have changed since the previous frame. rects are
+ * num_rects groups of x, y, width, height in framebuffer pixels with a bottom left
+ * origin. Falls back to glfwSwapBuffers() when the context does not support it. */
+GLFWAPI void glfwSwapBuffersWithDamage(GLFWwindow* window, const int* rects, int num_rects);
+/* Returns the age of the back buffer of the window, that is the number of
+ * frames ago its contents were drawn, or zero if the contents are undefined or
+ * the age is not known. The context of the window must be current. */
+GLFWAPI int glfwGetBufferAge(GLFWwindow* window);
 
 /*! @brief Sets the swap interval for the current context.
  *
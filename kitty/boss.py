@@ -27,7 +27,7 @@
 
 from kitty.types import WindowResizeDrag
 
-from .child import cached_process_data, default_env, set_default_env
+from .child import cached_process_data, default_env, set_default_env, zygote
 from .cli import create_opts, green, parse_args
 from .cli_stub import CLIOptions, SaveAsSessionOptions
 from .clipboard import (
@@ -179,6 +179,7 @@
 
     from .fast_data_types import OSWindowSize
     from .rc.base import ResponseType
+    from .remote_control import EventSubscription
 # }}}
 
 RCResponse = Union[dict[str, Any], None, AsyncResponse]
@@ -397,6 +398,7 @@ def __init__(
         self.primary_selection = Clipboard(ClipboardType.primary_selection)
         self.update_check_started = False
         self.peer_data_map: dict[int, dict[str, Sequence[str]] | None] = {}
+        self.rc_event_subscriptions: dict[int, EventSubscription] = {}
         self.background_process_death_notify_map: dict[int, Callable[[int, Exception | None], None]] = {}
         self.encryption_key = EllipticCurveKey()
         self.encryption_public_key = f'{RC_ENCRYPTION_PROTOCOL_VERSION}:{base64.b85encode(self.encryption_key.public).decode("ascii")}'
@@ -441,6 +443,10 @@ def __init__(
         self.atexit.unlink(store_effective_config())
 
     def startup_first_child(self, os_window_id: int | None, startup_sessions: Iterable[Session] = ()) -> None:
+        if get_options().spawn_zygote:
+            # Start the zygote before any window is created so that the
+            # first launch does not have to wait for it
+            zygote.fd_for_spawn()
         si = startup_sessions or create_sessions(get_options(), self.args, default_session=get_options().startup_session)
         focused_os_window = wid = 0
         token = os.environ.pop('XDG_ACTIVATION_TOKEN', '')
@@ -707,6 +713,7 @@ def add_child(self, window: Window) -> None:
         assert window.child.pid is not None and window.child.child_fd is not None
         self.child_monitor.add_child(window.id, window.child.pid, window.child.child_fd, window.screen)
         self.window_id_map[window.id] = window
+        window.notify_rc_subscribers('window_created')
 
     def _handle_remote_command(self, cmd: memoryview, window: Window | None = None, peer_id: int = 0) -> RCResponse:
         from .remote_control import is_cmd_allowed, parse_cmd, remote_control_allowed
@@ -898,9 +905,29 @@ def call_remote_control(self, self_window: Window | None, args: tuple[str, ...])
                 return None
             raise
 
-    def peer_message_received(self, msg_bytes: bytes, peer_id: int, is_remote_control: bool) -> bytes | bool | None:
+    def read_only_peer_messages_received(
+        self, messages: tuple[tuple[bytes, int, bool], ...]
+    ) -> list[bytes | tuple[bytes, str | bytes] | bool | None]:
+        # Read only remote control commands, such as ls, are deferred by the
+        # main loop till after it has rendered and there is no pending input.
+        # They still run here, on the main thread, one after the other. The
+        # only state shared between them is the list of foreground processes,
+        # which is read once for the whole batch.
+        ans: list[bytes | tuple[bytes, str | bytes] | bool | None] = []
+        with cached_process_data():
+            for msg_bytes, peer_id, is_remote_control in messages:
+                try:
+                    ans.append(self.peer_message_received(msg_bytes, peer_id, is_remote_control))
+                except Exception:
+                    import traceback
+                    traceback.print_exc()
+                    ans.append(None)
+        return ans
+
+    def peer_message_received(self, msg_bytes: bytes, peer_id: int, is_remote_control: bool) -> bytes | tuple[bytes, str | bytes] | bool | None:
         if peer_id > 0 and msg_bytes == b'peer_death':
             self.peer_data_map.pop(peer_id, None)
+            self.rc_event_subscriptions.pop(peer_id, None)
             return False
         if is_remote_control:
             cmd_prefix = b'\x1bP@kitty-cmd'
@@ -941,7 +968,9 @@ def peer_message_received(self, msg_bytes: bytes, peer_id: int, is_remote_contro
                 self.launch_urls(*cmdline_args_for_open, no_replace_window=True)
                 return None
             args.args = rest
-            opts = create_opts(args)
+            # the config is re-used between requests as long as it is unchanged,
+            # so that opening a new window does not need to parse it every time
+            opts = create_opts(args, share=True)
             if data['session_data']:
                 if data['session_data'] == 'none':
                     args.session = 'none'
@@ -3033,6 +3062,10 @@ def apply_new_options(self, opts: Options) -> None:
         apply_options_update()
         set_layout_options(opts)
         set_default_env(opts.env.copy())
+        if opts.spawn_zygote:
+            zygote.fd_for_spawn()
+        else:
+            zygote.shutdown()
         # Update font data
         from .fonts.render import set_font_family
         set_font_family(opts)
@@ -3092,7 +3125,7 @@ def load_config_file(self, *paths: str, apply_overrides: bool = True, overrides:
         final_overrides = old_opts.config_overrides if apply_overrides else ()
         if overrides:
             final_overrides += tuple(overrides)
-        opts = load_config(*paths, overrides=final_overrides or None, accumulate_bad_lines=bad_lines)
+        opts = load_config(*paths, overrides=final_overrides or None, accumulate_bad_lines=bad_lines, use_cache=True)
         if bad_lines:
             self.show_bad_config_lines(bad_lines)
         self.apply_new_options(opts)
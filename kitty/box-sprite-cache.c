@@ -0,0 +1,351 @@
+/*
+ * box-sprite-cache.c
+ * Copyright (C) 2026 Kovid Goyal <kovid at kovidgoyal.net>
+ *
+ * Distributed under terms of the GPL3 license.
+ */
+
+#include "box-sprite-cache.h"
+#include "decorations.h"
+#include "safe-wrappers.h"
+#include "state.h"
+#include "threading.h"
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+
+// Bump this whenever the rendering in decorations.c changes
+#define BOX_SPRITE_CACHE_VERSION 1u
+#define MAX_NUM_SETS 8u
+#define MAX_NUM_WORKERS 8u
+// Number of sets kept in the on-disk cache, least recently used sets are removed
+#define MAX_NUM_DISK_ENTRIES 32u
+static const char box_sprite_cache_magic[8] = {'K', 'B', 'O', 'X', 'S', 'P', 'R', 'T'};
+
+typedef struct BoxSpriteCacheHeader {
+    char magic[8];
+    uint32_t version, cell_width, cell_height, num_chars;
+    double dpi_x, dpi_y;
+    float box_drawing_scale[4];
+} BoxSpriteCacheHeader;
+
+struct BoxSpriteSet {
+    BoxSpriteCacheHeader header;
+    uint8_t *masks;
+    char *cache_path;
+    pthread_mutex_t lock;
+    pthread_t workers[MAX_NUM_WORKERS];
+    unsigned num_workers, num_workers_running, next_char_idx;
+    bool finished, failed, finished_seen_by_main_thread;
+    // cancelled sets stop rendering and are not saved, abandoned sets are
+    // freed by their last worker thread
+    bool cancelled, abandoned;
+};
+
+static BoxSpriteSet* sets[MAX_NUM_SETS] = {0};
+static size_t num_sets = 0;
+static char *cache_dir = NULL;
+
+#define R(first, last) + (last - first + 1)
+static const unsigned num_box_chars = 0 BOX_CHAR_RANGES(R);
+#undef R
+
+static char_type
+box_char_at(unsigned idx) {
+#define R(first, last) if (idx <= last - first) return first + idx; idx -= last - first + 1;
+    BOX_CHAR_RANGES(R)
+#undef R
+    return 0;
+}
+
+static ssize_t
+box_char_index(char_type ch) {
+    unsigned base = 0;
+#define R(first, last) if (first <= ch && ch <= last) return base + ch - first; base += last - first + 1;
+    BOX_CHAR_RANGES(R)
+#undef R
+    return -1;
+}
+
+static size_t
+mask_size(const BoxSpriteSet *set) { return (size_t)set->header.cell_width * set->header.cell_height; }
+
+// Disk cache {{{
+static bool
+ensure_cache_dir(void) {
+    if (cache_dir) return true;
+    RAII_PyObject(kc, PyImport_ImportModule("kitty.constants"));
+    if (!kc) { PyErr_Clear(); return false; }
+    RAII_PyObject(base, PyObject_CallMethod(kc, "cache_dir", NULL));
+    RAII_PyObject(version, PyObject_GetAttrString(kc, "str_version"));
+    if (!base || !version || !PyUnicode_Check(base) || !PyUnicode_Check(version)) { PyErr_Clear(); return false; }
+    size_t sz = strlen(PyUnicode_AsUTF8(base)) + strlen(PyUnicode_AsUTF8(version)) + 64;
+    cache_dir = malloc(sz);
+    if (!cache_dir) return false;
+    snprintf(cache_dir, sz, "%s/box-sprites-%s", PyUnicode_AsUTF8(base), PyUnicode_AsUTF8(version));
+    if (mkdir(cache_dir, 0700) != 0 && errno != EEXIST) { free(cache_dir); cache_dir = NULL; return false; }
+    return true;
+}
+
+static char*
+cache_path_for(const char *dir, const BoxSpriteCacheHeader *h) {
+    size_t sz = strlen(dir) + 256;
+    char *ans = malloc(sz);
+    if (ans) snprintf(ans, sz, "%s/%ux%u-%.3fx%.3f-%.3f-%.3f-%.3f-%.3f-v%u", dir, h->cell_width, h->cell_height, h->dpi_x, h->dpi_y,
+            h->box_drawing_scale[0], h->box_drawing_scale[1], h->box_drawing_scale[2], h->box_drawing_scale[3], BOX_SPRITE_CACHE_VERSION);
+    return ans;
+}
+
+static bool
+read_fully(int fd, uint8_t *buf, size_t sz) {
+    while (sz) {
+        ssize_t n = read(fd, buf, sz);
+        if (n < 0) { if (errno == EINTR || errno == EAGAIN) continue; return false; }
+        if (n == 0) return false;
+        buf += n; sz -= n;
+    }
+    return true;
+}
+
+static bool
+write_fully(int fd, const uint8_t *buf, size_t sz) {
+    while (sz) {
+        ssize_t n = write(fd, buf, sz);
+        if (n < 0) { if (errno == EINTR || errno == EAGAIN) continue; return false; }
+        if (n == 0) return false;
+        buf += n; sz -= n;
+    }
+    return true;
+}
+
+static bool
+load_from_disk(BoxSpriteSet *set) {
+    if (!set->cache_path) return false;
+    int fd = safe_open(set->cache_path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) return false;
+    BoxSpriteCacheHeader h;
+    bool ok = read_fully(fd, (uint8_t*)&h, sizeof(h)) && memcmp(&h, &set->header, sizeof(h)) == 0 &&
+        read_fully(fd, set->masks, mask_size(set) * num_box_chars);
+    if (ok) futimens(fd, NULL);  // the modification time is used for LRU pruning
+    safe_close(fd, __FILE__, __LINE__);
+    return ok;
+}
+
+typedef struct DiskEntry {
+    char *path;
+    time_t mtime;
+} DiskEntry;
+
+static int
+cmp_disk_entries(const void *a_, const void *b_) {
+    const DiskEntry *a = a_, *b = b_;
+    // most recently used first
+    return a->mtime == b->mtime ? 0 : (a->mtime < b->mtime ? 1 : -1);
+}
+
+static void
+prune_disk_cache(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+    DiskEntry *entries = NULL;
+    size_t count = 0, capacity = 0;
+    struct dirent *e;
+    while ((e = readdir(d))) {
+        if (e->d_name[0] == '.') continue;
+        size_t sz = strlen(dir) + strlen(e->d_name) + 2;
+        char *path = malloc(sz);
+        if (!path) break;
+        snprintf(path, sz, "%s/%s", dir, e->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) { free(path); continue; }
+        if (count >= capacity) {
+            capacity = MAX(64u, capacity * 2);
+            DiskEntry *n = realloc(entries, capacity * sizeof(entries[0]));
+            if (!n) { free(path); break; }
+            entries = n;
+        }
+        entries[count++] = (DiskEntry){.path=path, .mtime=st.st_mtime};
+    }
+    closedir(d);
+    if (count > MAX_NUM_DISK_ENTRIES) {
+        qsort(entries, count, sizeof(entries[0]), cmp_disk_entries);
+        for (size_t i = MAX_NUM_DISK_ENTRIES; i < count; i++) unlink(entries[i].path);
+    }
+    for (size_t i = 0; i < count; i++) free(entries[i].path);
+    free(entries);
+}
+
+static void
+save_to_disk(BoxSpriteSet *set) {
+    if (!set->cache_path) return;
+    size_t sz = strlen(set->cache_path) + 16;
+    RAII_ALLOC(char, tpath, malloc(sz));
+    if (!tpath) return;
+    snprintf(tpath, sz, "%s.XXXXXX", set->cache_path);
+    int fd = mkstemp(tpath);
+    if (fd < 0) return;
+    bool ok = write_fully(fd, (const uint8_t*)&set->header, sizeof(set->header)) && write_fully(fd, set->masks, mask_size(set) * num_box_chars);
+    safe_close(fd, __FILE__, __LINE__);
+    if (!ok || rename(tpath, set->cache_path) != 0) { unlink(tpath); return; }
+    char *sep = strrchr(tpath, '/');
+    if (sep) { *sep = 0; prune_disk_cache(tpath); }
+}
+// }}}
+
+// Rendering {{{
+static void
+destroy_set(BoxSpriteSet *set) {
+    pthread_mutex_destroy(&set->lock);
+    free(set->masks); free(set->cache_path); free(set);
+}
+
+static void
+render_chars(BoxSpriteSet *set) {
+    const size_t sz = mask_size(set);
+    RAII_ALLOC(uint8_t, scratch, malloc(sz * (1 + SUPERSAMPLE_FACTOR * SUPERSAMPLE_FACTOR)));
+    while (scratch) {
+        pthread_mutex_lock(&set->lock);
+        unsigned idx = set->cancelled ? num_box_chars : set->next_char_idx++;
+        pthread_mutex_unlock(&set->lock);
+        if (idx >= num_box_chars) break;
+        // the line thicknesses come from the header, not the global options
+        // which can change while rendering
+        render_box_char_with_line_thickness(
+            box_char_at(idx), scratch, set->header.cell_width, set->header.cell_height, set->header.dpi_x, set->header.dpi_y, 1.0,
+            set->header.box_drawing_scale);
+        memcpy(set->masks + idx * sz, scratch, sz);
+    }
+    pthread_mutex_lock(&set->lock);
+    if (!scratch) set->failed = true;
+    bool is_last = --set->num_workers_running == 0;
+    bool save = is_last && !set->failed && !set->cancelled;
+    pthread_mutex_unlock(&set->lock);
+    if (is_last) {
+        if (save) save_to_disk(set);
+        pthread_mutex_lock(&set->lock);
+        set->finished = true;
+        bool abandoned = set->abandoned;
+        pthread_mutex_unlock(&set->lock);
+        if (abandoned) destroy_set(set);
+    }
+}
+
+static void*
+render_worker(void *x) {
+    set_thread_name("BoxSprites");
+    render_chars(x);
+    return NULL;
+}
+
+static void
+start_rendering(BoxSpriteSet *set) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned num = MAX(1u, MIN(MAX_NUM_WORKERS, ncpu > 1 ? (unsigned)ncpu - 1 : 1u));
+    set->num_workers_running = num;
+    for (unsigned i = 0; i < num; i++) {
+        if (pthread_create(&set->workers[i], NULL, render_worker, set) != 0) {
+            pthread_mutex_lock(&set->lock);
+            set->num_workers_running -= num - i;
+            if (!set->num_workers_running) set->failed = set->finished = true;
+            pthread_mutex_unlock(&set->lock);
+            break;
+        }
+        set->num_workers++;
+    }
+}
+
+// Frees the set without waiting for its workers, which stop at the next
+// character and free the set themselves if still running
+static void
+evict_set(BoxSpriteSet *set) {
+    for (unsigned i = 0; i < set->num_workers; i++) pthread_detach(set->workers[i]);
+    pthread_mutex_lock(&set->lock);
+    set->cancelled = true;
+    bool finished = set->finished;
+    if (!finished) set->abandoned = true;
+    pthread_mutex_unlock(&set->lock);
+    if (finished) destroy_set(set);
+}
+
+static void
+free_set(BoxSpriteSet *set) {
+    pthread_mutex_lock(&set->lock);
+    set->cancelled = true;
+    pthread_mutex_unlock(&set->lock);
+    for (unsigned i = 0; i < set->num_workers; i++) pthread_join(set->workers[i], NULL);
+    destroy_set(set);
+}
+// }}}
+
+static BoxSpriteSet*
+create_set(const BoxSpriteCacheHeader *h, const char *dir) {
+    BoxSpriteSet *set = calloc(1, sizeof(BoxSpriteSet));
+    if (!set) return NULL;
+    set->header = *h;
+    set->masks = malloc(mask_size(set) * num_box_chars);
+    if (!set->masks || pthread_mutex_init(&set->lock, NULL) != 0) { free(set->masks); free(set); return NULL; }
+    if (dir) set->cache_path = cache_path_for(dir, h);
+    return set;
+}
+
+static BoxSpriteCacheHeader
+header_for(unsigned cell_width, unsigned cell_height, double dpi_x, double dpi_y, const float box_drawing_scale[4]) {
+    BoxSpriteCacheHeader h = {.version=BOX_SPRITE_CACHE_VERSION, .cell_width=cell_width, .cell_height=cell_height, .num_chars=num_box_chars, .dpi_x=dpi_x, .dpi_y=dpi_y};
+    memcpy(h.magic, box_sprite_cache_magic, sizeof(h.magic));
+    memcpy(h.box_drawing_scale, box_drawing_scale, sizeof(h.box_drawing_scale));
+    return h;
+}
+
+BoxSpriteSet*
+box_sprite_set_for(unsigned cell_width, unsigned cell_height, double dpi_x, double dpi_y) {
+    BoxSpriteCacheHeader h = header_for(cell_width, cell_height, dpi_x, dpi_y, OPT(box_drawing_scale));
+    for (size_t i = 0; i < num_sets; i++) {
+        if (memcmp(&sets[i]->header, &h, sizeof(h)) == 0) return sets[i];
+    }
+    if (!cell_width || !cell_height) return NULL;
+    BoxSpriteSet *set = create_set(&h, ensure_cache_dir() ? cache_dir : NULL);
+    if (!set) return NULL;
+    if (load_from_disk(set)) set->finished = true;
+    else start_rendering(set);
+    if (num_sets >= MAX_NUM_SETS) {
+        evict_set(sets[0]);
+        memmove(sets, sets + 1, sizeof(sets[0]) * --num_sets);
+    }
+    sets[num_sets++] = set;
+    return set;
+}
+
+const uint8_t*
+box_sprite_set_get(BoxSpriteSet *set, char_type ch) {
+    if (!set->finished_seen_by_main_thread) {
+        pthread_mutex_lock(&set->lock);
+        set->finished_seen_by_main_thread = set->finished;
+        pthread_mutex_unlock(&set->lock);
+        if (!set->finished_seen_by_main_thread) return NULL;
+    }
+    if (set->failed) return NULL;
+    ssize_t idx = box_char_index(ch);
+    return idx < 0 ? NULL : set->masks + idx * mask_size(set);
+}
+
+PyObject*
+test_box_sprite_cache(PyObject *self UNUSED, PyObject *args) {
+    const char *dir; unsigned cell_width, cell_height; float scale[4];
+    if (!PyArg_ParseTuple(args, "sII(ffff)", &dir, &cell_width, &cell_height, scale, scale + 1, scale + 2, scale + 3)) return NULL;
+    if (!cell_width || !cell_height) { PyErr_SetString(PyExc_ValueError, "Cell size must be non-zero"); return NULL; }
+    BoxSpriteCacheHeader h = header_for(cell_width, cell_height, 96., 96., scale);
+    BoxSpriteSet *set = create_set(&h, dir);
+    if (!set || !set->cache_path) { if (set) destroy_set(set); return PyErr_NoMemory(); }
+    bool loaded = load_from_disk(set);
+    if (!loaded) { set->num_workers_running = 1; render_chars(set); }
+    PyObject *ans = Py_BuildValue("Osy#", loaded ? Py_True : Py_False, set->cache_path, set->masks, (Py_ssize_t)(mask_size(set) * num_box_chars));
+    destroy_set(set);
+    return ans;
+}
+
+void
+free_box_sprite_sets(void) {
+    for (size_t i = 0; i < num_sets; i++) free_set(sets[i]);
+    num_sets = 0;
+    free(cache_dir); cache_dir = NULL;
+}
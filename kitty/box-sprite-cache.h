@@ -0,0 +1,27 @@
+/*
+ * box-sprite-cache.h
+ * Copyright (C) 2026 Kovid Goyal <kovid at kovidgoyal.net>
+ *
+ * Distributed under terms of the GPL3 license.
+ */
+
+#pragma once
+
+#include "data-types.h"
+
+typedef struct BoxSpriteSet BoxSpriteSet;
+
+// Returns the set of pre-rendered box drawing alpha masks for the specified
+// cell size, creating it if needed. Creation loads the set from the on-disk
+// cache or starts rendering it in background threads. Must be called from the
+// main thread.
+BoxSpriteSet* box_sprite_set_for(unsigned cell_width, unsigned cell_height, double dpi_x, double dpi_y);
+// Returns the pre-rendered alpha mask of cell_width * cell_height bytes for ch
+// or NULL if it is not available yet
+const uint8_t* box_sprite_set_get(BoxSpriteSet *set, char_type ch);
+// Cancels all background rendering and frees all sets
+void free_box_sprite_sets(void);
+// Loads the set for the specified cell size and box_drawing_scale from the
+// cache in the specified directory, rendering and saving it if not present.
+// Returns (loaded_from_cache, cache_path, masks).
+PyObject* test_box_sprite_cache(PyObject *self, PyObject *args);
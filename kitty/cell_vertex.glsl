@@ -22,6 +22,7 @@ uniform float gamma_lut[256];
 uniform uint draw_bg_bitfield;
 uniform usampler2D sprite_decorations_map;
 uniform float row_offset;
+uniform uint instance_offset;  // index of the first cell when drawing a range of cells
 
 // Have to use fixed locations here as all variants of the cell program share the same VAOs
 layout(location=0) in uvec3 colors;
@@ -208,7 +209,7 @@ struct CellData {
 } cell_data;
 
 CellData set_vertex_position(vec3 cell_fg, vec3 cell_bg) {
-    uint instance_id = uint(gl_InstanceID);
+    uint instance_id = uint(gl_InstanceID) + instance_offset;
     float dx = 2.0 / float(columns);
     float dy = 2.0 / float(lines);
     /* The current cell being rendered */
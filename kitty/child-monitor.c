@@ -42,7 +42,8 @@ typedef struct {
     char *data;
     size_t sz;
     id_type peer_id;
-    bool is_remote_control_peer;
+    bool is_remote_control_peer, is_read_only;
+    monotonic_t received_at;
 } Message;
 
 typedef struct {
@@ -83,7 +84,9 @@ static Child scratch[MAX_CHILDREN] = {{0}};
 static Child add_queue[MAX_CHILDREN] = {{0}}, remove_queue[MAX_CHILDREN] = {{0}}, remove_notify[MAX_CHILDREN] = {{0}};
 static size_t add_queue_count = 0, remove_queue_count = 0;
 static struct pollfd children_fds[MAX_CHILDREN + EXTRA_FDS] = {{0}};
-static pthread_mutex_t children_lock, talk_lock;
+static pthread_mutex_t children_lock;
+// statically initialized as peers can be used without a ChildMonitor in tests
+static pthread_mutex_t talk_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool kill_signal_received = false, reload_config_signal_received = false;
 static ChildMonitor *the_monitor = NULL;
 
@@ -92,6 +95,16 @@ typedef struct {
     int status;
 } ReapedPID;
 
+// Read only remote control commands received from sockets, waiting to be
+// answered after rendering
+static struct {
+    Message *items;
+    size_t count, capacity;
+} deferred_rc_messages = {0};
+// The max time a read only remote control command is deferred while there is
+// input to process
+#define MAX_RC_DEFERRAL ms_to_monotonic_t(100ll)
+
 static pid_t monitored_pids[256] = {0};
 static size_t monitored_pids_count = 0;
 static ReapedPID reaped_pids[arraysz(monitored_pids)] = {{0}};
@@ -166,10 +179,6 @@ new_childmonitor_object(PyTypeObject *type, PyObject *args, PyObject UNUSED *kwd
         PyErr_Format(PyExc_RuntimeError, "Failed to create children_lock mutex: %s", strerror(ret));
         return NULL;
     }
-    if ((ret = pthread_mutex_init(&talk_lock, NULL)) != 0) {
-        PyErr_Format(PyExc_RuntimeError, "Failed to create talk_lock mutex: %s", strerror(ret));
-        return NULL;
-    }
     self = (ChildMonitor *)type->tp_alloc(type, 0);
     if (!init_loop_data(&self->io_loop_data, KITTY_HANDLED_SIGNALS)) return PyErr_SetFromErrno(PyExc_OSError);
     self->talk_fd = talk_fd;
@@ -196,7 +205,6 @@ dealloc(ChildMonitor* self) {
         self->messages_count = 0; self->messages_capacity = 0;
     }
     pthread_mutex_destroy(&children_lock);
-    pthread_mutex_destroy(&talk_lock);
     Py_CLEAR(self->dump_callback);
     Py_CLEAR(self->death_notify);
     while (remove_queue_count) {
@@ -230,6 +238,7 @@ wakeup_io_loop(ChildMonitor *self, bool in_signal_handler) {
 static void* io_loop(void *data);
 static void* talk_loop(void *data);
 static void send_response_to_peer(id_type peer_id, const char *msg, size_t msg_sz, bool is_async_response);
+static bool send_python_response_to_peer(id_type peer_id, PyObject *resp, bool is_async_response);
 static void wakeup_talk_loop(bool);
 static bool add_peer_to_injection_queue(int peer_fd, int pipe_fd);
 static bool talk_thread_started = false;
@@ -438,6 +447,8 @@ shutdown_monitor(ChildMonitor *self, PyObject *a UNUSED) {
 static bool
 do_parse(ChildMonitor *self, Screen *screen, monotonic_t now, bool flush) {
     ParseData pd = {.dump_callback = self->dump_callback, .now = now};
+    // images decoded in the background are treated as input so they are rendered promptly
+    if (screen_finish_graphics_decodes(screen, false)) pd.input_read = true;
     self->parse_func(screen, &pd, flush);
     if (pd.input_read) {
         if (pd.write_space_created) wakeup_io_loop(self, false);
@@ -448,6 +459,25 @@ do_parse(ChildMonitor *self, Screen *screen, monotonic_t now, bool flush) {
     return pd.input_read;
 }
 
+static bool
+has_deferred_rc_messages(id_type peer_id) {
+    for (size_t i = 0; i < deferred_rc_messages.count; i++) if (deferred_rc_messages.items[i].peer_id == peer_id) return true;
+    return false;
+}
+
+static void
+send_peer_message_response(id_type peer_id, PyObject *resp) {
+    if (resp) {
+        if (PyBytes_Check(resp) || PyTuple_Check(resp)) {
+            if (!send_python_response_to_peer(peer_id, resp, false)) {
+                PyErr_Print();
+                send_response_to_peer(peer_id, NULL, 0, false);
+            }
+        } else if (resp == Py_None) send_response_to_peer(peer_id, NULL, 0, false);
+        else if (resp == Py_True) send_response_to_peer(peer_id, NULL, 0, true);
+    } else send_response_to_peer(peer_id, NULL, 0, false);
+}
+
 static bool
 parse_input(ChildMonitor *self) {
     // Parse all available input that was read in the I/O thread.
@@ -500,18 +530,21 @@ parse_input(ChildMonitor *self) {
     if (msgs_count) {
         for (size_t i = 0; i < msgs_count; i++) {
             Message *msg = msgs + i;
+            // Messages from a peer that has deferred messages are deferred
+            // as well so that responses are sent in order
+            if (msg->data && (msg->is_read_only || has_deferred_rc_messages(msg->peer_id))) {
+                ensure_space_for(&deferred_rc_messages, items, Message, deferred_rc_messages.count + 1, capacity, 16, false);
+                deferred_rc_messages.items[deferred_rc_messages.count++] = *msg;
+                continue;
+            }
             PyObject *resp = NULL;
             if (msg->data) {
                 resp = PyObject_CallMethod(global_state.boss, "peer_message_received", "y#KO", msg->data, (int)msg->sz, msg->peer_id, msg->is_remote_control_peer ? Py_True : Py_False);
                 free(msg->data);
                 if (!resp) PyErr_Print();
             }
-            if (resp) {
-                if (PyBytes_Check(resp)) send_response_to_peer(msg->peer_id, PyBytes_AS_STRING(resp), PyBytes_GET_SIZE(resp), false);
-                else if (resp == Py_None) send_response_to_peer(msg->peer_id, NULL, 0, false);
-                else if (resp == Py_True) send_response_to_peer(msg->peer_id, NULL, 0, true);
-                Py_CLEAR(resp);
-            } else send_response_to_peer(msg->peer_id, NULL, 0, false);
+            send_peer_message_response(msg->peer_id, resp);
+            Py_CLEAR(resp);
         }
         free(msgs); msgs = NULL;
     }
@@ -711,10 +744,56 @@ change_menubar_title(PyObject *title UNUSED) {
 #endif
 }
 
+// Damage tracking {{{
+static Region
+window_damage_region(const WindowRenderData *rd) {
+    // the area of the window including its padding, margins and borders
+    const WindowGeometry *g = &rd->geometry;
+    return (Region){
+        .left=g->left - MIN(g->left, g->spaces.left), .top=g->top - MIN(g->top, g->spaces.top),
+        .right=g->right + g->spaces.right, .bottom=g->bottom + g->spaces.bottom
+    };
+}
+
+static void
+damage_cursor_cells(OSWindow *os_window, const WindowRenderData *rd, const CursorRenderInfo *c) {
+    const Screen *screen = rd->screen;
+    if (!screen->columns || !screen->lines) return;
+    index_type num_cols = 1, num_rows = 1;
+    screen_cursor_span(rd->screen, c->x, c->y, &num_cols, &num_rows);
+    const WindowGeometry *g = &rd->geometry;
+    const unsigned width = g->right - g->left, height = g->bottom - g->top, cols = screen->columns, lines = screen->lines;
+    const unsigned x1 = MIN(c->x, cols), x2 = MIN(c->x + num_cols, cols), y1 = MIN(c->y, lines), y2 = MIN(c->y + num_rows, lines);
+    if (x2 <= x1 || y2 <= y1) return;
+    // a pixel of slack on every side for rounding in the cell layout
+    Region r = {
+        .left = g->left + x1 * width / cols, .right = g->left + (x2 * width + cols - 1) / cols + 1,
+        .top = g->top + y1 * height / lines, .bottom = g->top + (y2 * height + lines - 1) / lines + 1,
+    };
+    r.left -= MIN(r.left, 1u); r.top -= MIN(r.top, 1u);
+    damage_os_window_region(os_window, r);
+}
+
+static void
+damage_cursor(OSWindow *os_window, Window *w) {
+    const Screen *screen = w->render_data.screen;
+    const CursorRenderInfo *prev = &screen->last_rendered.cursor, *cur = &screen->cursor_render_info;
+    if (prev->text_blink_opacity != cur->text_blink_opacity || prev->multicursor_count != cur->multicursor_count || (
+                pixel_scroll_enabled(screen) && screen->pixel_scroll_offset_y)) {
+        // blinking text and extra cursors can be anywhere in the window
+        damage_os_window_region(os_window, window_damage_region(&w->render_data));
+        return;
+    }
+    damage_cursor_cells(os_window, &w->render_data, prev);
+    damage_cursor_cells(os_window, &w->render_data, cur);
+}
+// }}}
+
 static bool
 prepare_to_render_os_window(OSWindow *os_window, monotonic_t now, unsigned int *active_window_id, color_type *active_window_bg, unsigned int *num_visible_windows, bool *all_windows_have_same_bg, bool scan_for_animated_images) {
 #define TD os_window->tab_bar_render_data
-    bool needs_render = os_window->needs_render;
+    os_window->damage.frame = (Region){0}; os_window->damage.is_full = false;
+    if (os_window->needs_render) damage_os_window(os_window);
     os_window->needs_render = false;
     bool was_previously_rendered_with_layers = os_window->needs_layers;
     os_window->needs_layers = (
@@ -729,7 +808,7 @@ prepare_to_render_os_window(OSWindow *os_window, monotonic_t now, unsigned int *
         // we never render a cursor in the tab bar
         CursorRenderInfo *cri = &TD.screen->cursor_render_info;
         zero_at_ptr(cri); cri->x = TD.screen->cursor->x; cri->y = TD.screen->cursor->y;
-        if (send_cell_data_to_gpu(TD.vao_idx, TD.screen, os_window)) needs_render = true;
+        if (send_cell_data_to_gpu(TD.vao_idx, TD.screen, os_window)) damage_os_window_region(os_window, window_damage_region(&TD));
         os_window->needs_layers = os_window->needs_layers || screen_needs_rendering_in_layers(os_window, NULL, TD.screen);
     }
     if (OPT(mouse_hide.hide_wait) > 0 && !is_mouse_hidden(os_window)) {
@@ -757,14 +836,14 @@ prepare_to_render_os_window(OSWindow *os_window, monotonic_t now, unsigned int *
                     if (drag_scroll(w, os_window)) {
                         w->last_drag_scroll_at = now;
                         set_maximum_wait(ms_to_monotonic_t(20ll));
-                        needs_render = true;
+                        damage_os_window_region(os_window, window_damage_region(&WD));
                     } else w->last_drag_scroll_at = 0;
                 } else set_maximum_wait(now - w->last_drag_scroll_at);
             }
             bool is_active_window = i == tab->active_window;
             if (is_active_window) {
                 *active_window_id = w->id;
-                if (collect_cursor_info(&WD.screen->cursor_render_info, w, now, os_window)) needs_render = true;
+                if (collect_cursor_info(&WD.screen->cursor_render_info, w, now, os_window)) damage_cursor(os_window, w);
                 WD.screen->cursor_render_info.is_focused = os_window->is_focused;
                 set_os_window_title_from_window(w, os_window);
                 *active_window_bg = window_bg;
@@ -776,7 +855,7 @@ prepare_to_render_os_window(OSWindow *os_window, monotonic_t now, unsigned int *
                         os_window->cursor_blink_zero_time = now;
                     }
                     if (update_cursor_trail(&tab->cursor_trail, w, now, os_window)) {
-                        needs_render = true;
+                        damage_os_window(os_window);
                         // A max wait of zero causes key input processing to be
                         // slow so handle the case of OPT(repaint_delay) == 0, see https://github.com/kovidgoyal/kitty/pull/8066
                         set_maximum_wait(MAX(OPT(repaint_delay), ms_to_monotonic_t(1ll)));
@@ -789,11 +868,11 @@ prepare_to_render_os_window(OSWindow *os_window, monotonic_t now, unsigned int *
                 }
             } else {
                 if (WD.screen->cursor_render_info.render_even_when_unfocused) {
-                    if (collect_cursor_info(&WD.screen->cursor_render_info, w, now, os_window)) needs_render = true;
+                    if (collect_cursor_info(&WD.screen->cursor_render_info, w, now, os_window)) damage_cursor(os_window, w);
                     WD.screen->cursor_render_info.is_focused = false;
                 } else {
                     if (WD.screen->sgr_blink_was_used) {
-                        if (collect_cursor_info(&WD.screen->cursor_render_info, w, now, os_window)) needs_render = true;
+                        if (collect_cursor_info(&WD.screen->cursor_render_info, w, now, os_window)) damage_cursor(os_window, w);
                         WD.screen->cursor_render_info.is_focused = false;
                     } else {
                         WD.screen->cursor_render_info.text_blink_opacity = 1;
@@ -803,23 +882,23 @@ prepare_to_render_os_window(OSWindow *os_window, monotonic_t now, unsigned int *
             }
             if (scan_for_animated_images) {
                 monotonic_t min_gap;
-                if (scan_active_animations(WD.screen->grman, now, &min_gap, true)) needs_render = true;
+                if (scan_active_animations(WD.screen->grman, now, &min_gap, true)) damage_os_window_region(os_window, window_damage_region(&WD));
                 if (min_gap < MONOTONIC_T_MAX) {
                     global_state.check_for_active_animated_images = true;
                     set_maximum_wait(min_gap);
                 }
             }
-            if (send_cell_data_to_gpu(WD.vao_idx, WD.screen, os_window)) needs_render = true;
-            if (WD.screen->start_visual_bell_at != 0) needs_render = true;
+            if (send_cell_data_to_gpu(WD.vao_idx, WD.screen, os_window) || WD.screen->start_visual_bell_at != 0) damage_os_window_region(os_window, window_damage_region(&WD));
             // Prepare window title bar screen data for GPU
             WindowRenderData *trd = &w->window_title_render_data;
             if (trd->screen && trd->geometry.bottom > trd->geometry.top && trd->geometry.right > trd->geometry.left) {
                 trd->screen->cursor_render_info.is_visible = false;
-                if (send_cell_data_to_gpu(trd->vao_idx, trd->screen, os_window)) needs_render = true;
+                if (send_cell_data_to_gpu(trd->vao_idx, trd->screen, os_window)) damage_os_window_region(os_window, window_damage_region(trd));
             }
         }
     }
-    return needs_render || was_previously_rendered_with_layers != os_window->needs_layers;
+    if (was_previously_rendered_with_layers != os_window->needs_layers || tab->border_rects.is_dirty) damage_os_window(os_window);
+    return os_window_is_damaged(os_window);
 }
 
 static void
@@ -929,19 +1008,21 @@ render_os_window(OSWindow *w, monotonic_t now, bool scan_for_animated_images) {
     }
     w->render_calls++;
     make_os_window_context_current(w);
-    bool needs_render = w->redraw_count > 0 || w->live_resize.in_progress || global_state.thumbnail_callback.os_window == w->id;
+    bool needs_full_render = w->redraw_count > 0 || w->live_resize.in_progress || global_state.thumbnail_callback.os_window == w->id;
     if (w->viewport_size_dirty) {
         set_gpu_viewport(w->viewport_width, w->viewport_height);
         w->viewport_size_dirty = false;
-        needs_render = true;
+        needs_full_render = true;
     }
     unsigned int active_window_id = 0, num_visible_windows = 0;
     bool all_windows_have_same_bg;
     color_type active_window_bg = 0;
     if (!w->fonts_data) { log_error("No fonts data found for window id: %llu", w->id); return false; }
-    if (prepare_to_render_os_window(w, now, &active_window_id, &active_window_bg, &num_visible_windows, &all_windows_have_same_bg, scan_for_animated_images)) needs_render = true;
-    if (w->last_active_window_id != active_window_id || w->last_active_tab != w->active_tab || w->focused_at_last_render != w->is_focused) needs_render = true;
-    if (w->render_calls < 3 && w->bgimage && w->bgimage->texture_id) needs_render = true;
+    const bool is_damaged = prepare_to_render_os_window(w, now, &active_window_id, &active_window_bg, &num_visible_windows, &all_windows_have_same_bg, scan_for_animated_images);
+    if (w->last_active_window_id != active_window_id || w->last_active_tab != w->active_tab || w->focused_at_last_render != w->is_focused) needs_full_render = true;
+    if (w->render_calls < 3 && w->bgimage && w->bgimage->texture_id) needs_full_render = true;
+    if (needs_full_render) damage_os_window(w);
+    const bool needs_render = needs_full_render || is_damaged;
     if (needs_render) render_prepared_os_window(w, active_window_id, active_window_bg, num_visible_windows, all_windows_have_same_bg);
     if (w->is_focused) change_menubar_title(w->window_title);
     return needs_render;
@@ -1339,6 +1420,40 @@ process_cocoa_pending_actions(void) {
 }
 #endif
 
+static void
+process_deferred_rc_messages(bool input_read, monotonic_t now) {
+    // Read only remote control commands such as ls and get-text are deferred
+    // until after render, once the main loop has no input to process, so that
+    // polling clients never delay a frame. They are still run on the main
+    // thread, as a batch that reads the foreground process list only once.
+    // Under sustained input they are deferred by at most MAX_RC_DEFERRAL.
+    if (!deferred_rc_messages.count) return;
+    monotonic_t waited = now - deferred_rc_messages.items[0].received_at;
+    if (input_read && waited < MAX_RC_DEFERRAL) { set_maximum_wait(MAX_RC_DEFERRAL - waited); return; }
+    const size_t count = deferred_rc_messages.count;
+    RAII_PyObject(batch, PyTuple_New(count));
+    if (batch) {
+        for (size_t i = 0; i < count; i++) {
+            const Message *msg = deferred_rc_messages.items + i;
+            PyObject *t = Py_BuildValue("y#KO", msg->data, (Py_ssize_t)msg->sz, msg->peer_id, msg->is_remote_control_peer ? Py_True : Py_False);
+            if (!t) { Py_CLEAR(batch); break; }
+            PyTuple_SET_ITEM(batch, i, t);
+        }
+    }
+    RAII_PyObject(responses, batch ? PyObject_CallMethod(global_state.boss, "read_only_peer_messages_received", "O", batch) : NULL);
+    if (!responses) PyErr_Print();
+    else if (!PyList_Check(responses) || (size_t)PyList_GET_SIZE(responses) != count) {
+        log_error("read_only_peer_messages_received() returned an invalid value");
+        Py_CLEAR(responses);
+    }
+    for (size_t i = 0; i < count; i++) {
+        Message *msg = deferred_rc_messages.items + i;
+        send_peer_message_response(msg->peer_id, responses ? PyList_GET_ITEM(responses, i) : NULL);
+        free(msg->data);
+    }
+    deferred_rc_messages.count = 0;
+}
+
 static void process_global_state(void *data);
 
 static void
@@ -1364,6 +1479,7 @@ process_global_state(void *data) {
     }
     if (parse_input(self)) input_read = true;
     render(now, input_read);
+    process_deferred_rc_messages(input_read, now);
 #ifdef __APPLE__
     if (has_cocoa_pending_actions) {
         process_cocoa_pending_actions();
@@ -1389,6 +1505,8 @@ main_loop(ChildMonitor *self, PyObject *a UNUSED) {
 #define main_loop_doc "The main thread loop"
     state_check_timer = add_main_loop_timer(1000, true, do_state_check, self, NULL);
     run_main_loop(process_global_state, self);
+    for (size_t i = 0; i < deferred_rc_messages.count; i++) free(deferred_rc_messages.items[i].data);
+    free(deferred_rc_messages.items); zero_at_ptr(&deferred_rc_messages);
 #ifdef __APPLE__
     cocoa_free_actions_data();
 #endif
@@ -1801,6 +1919,27 @@ free_peer(Peer *peer) {
 
 #define KITTY_CMD_PREFIX "\x1bP@kitty-cmd{"
 
+static bool
+is_read_only_rc_command(const char *data, size_t sz) {
+    // Look for the name of the command in the JSON without parsing it. Both
+    // kitten @ and kitty put cmd first. Encrypted commands are never read only
+    // since the name is not visible. A wrong answer here only changes when
+    // the command is run, not whether it is allowed.
+    static const char *read_only_commands[] = {"ls", "get-text", "get_text", "get-colors", "get_colors"};
+    const size_t limit = MIN(sz, (size_t)256);
+    const char *p = NULL, *end = data + limit;
+    for (size_t i = 0; i + 5 <= limit && !p; i++) if (memcmp(data + i, "\"cmd\"", 5) == 0) p = data + i;
+    if (!p) return false;
+    for (p += 5; p < end && (*p == ' ' || *p == ':'); p++);
+    if (p >= end || *p++ != '"') return false;
+    const char *q = memchr(p, '"', end - p);
+    if (!q) return false;
+    for (size_t i = 0; i < arraysz(read_only_commands); i++) {
+        if (strlen(read_only_commands[i]) == (size_t)(q - p) && memcmp(read_only_commands[i], p, q - p) == 0) return true;
+    }
+    return false;
+}
+
 static void
 queue_peer_message(ChildMonitor *self, Peer *peer) {
     talk_mutex(lock);
@@ -1816,6 +1955,8 @@ queue_peer_message(ChildMonitor *self, Peer *peer) {
     }
     m->peer_id = peer->id;
     m->is_remote_control_peer = peer->is_remote_control_peer;
+    m->is_read_only = m->is_remote_control_peer && m->data && is_read_only_rc_command(m->data, m->sz);
+    m->received_at = monotonic();
     peer->num_of_unresponded_messages_sent_to_main_thread++;
     talk_mutex(unlock);
     wakeup_main_loop();
@@ -1896,7 +2037,7 @@ write_to_peer(Peer *peer) {
     else if (n < 0) {
         if (errno != EINTR) { log_error("write() to peer socket failed with error: %s", strerror(errno)); peer->write.used = 0; peer->write.failed = true; }
     } else {
-        if ((size_t)n > peer->write.used) memmove(peer->write.data, peer->write.data + n, peer->write.used - n);
+        if ((size_t)n < peer->write.used) memmove(peer->write.data, peer->write.data + n, peer->write.used - n);
         peer->write.used -= n;
     }
     talk_mutex(unlock);
@@ -2034,34 +2175,118 @@ end:
     return 0;
 }
 
-static void
-send_response_to_peer(id_type peer_id, const char *msg, size_t msg_sz, bool is_async_response) {
-    bool wakeup = false;
-    talk_mutex(lock);
+static Peer*
+peer_for_response(id_type peer_id, bool is_async_response) {
+    // must be called with the talk mutex held
     for (size_t i = 0; i < talk_data.num_peers; i++) {
         Peer *peer = talk_data.peers + i;
         if (peer->id == peer_id) {
             peer->waiting_for_async_response = is_async_response;
             if (peer->num_of_unresponded_messages_sent_to_main_thread) peer->num_of_unresponded_messages_sent_to_main_thread--;
-            if (!peer->write.failed) {
-                if (peer->write.capacity - peer->write.used < msg_sz) {
-                    void *data = realloc(peer->write.data, peer->write.capacity + msg_sz);
-                    if (data) {
-                        peer->write.data = data;
-                        peer->write.capacity += msg_sz;
-                    } else fatal("Out of memory");
-                }
-                if (msg_sz && msg) {
-                    memcpy(peer->write.data + peer->write.used, msg, msg_sz);
-                    peer->write.used += msg_sz;
-                }
-            }
-            wakeup = true;
-            break;
+            return peer;
         }
     }
+    return NULL;
+}
+
+static void
+ensure_peer_write_space(Peer *peer, size_t sz) {
+    if (peer->write.capacity - peer->write.used < sz) {
+        void *data = realloc(peer->write.data, peer->write.used + sz);
+        if (data) {
+            peer->write.data = data;
+            peer->write.capacity = peer->write.used + sz;
+        } else fatal("Out of memory");
+    }
+}
+
+static void
+send_response_to_peer(id_type peer_id, const char *msg, size_t msg_sz, bool is_async_response) {
+    talk_mutex(lock);
+    Peer *peer = peer_for_response(peer_id, is_async_response);
+    if (peer && !peer->write.failed && msg_sz && msg) {
+        ensure_peer_write_space(peer, msg_sz);
+        memcpy(peer->write.data + peer->write.used, msg, msg_sz);
+        peer->write.used += msg_sz;
+    }
+    talk_mutex(unlock);
+    if (peer) wakeup_talk_loop(false);
+}
+
+// Binary framing of remote control responses. Used instead of JSON inside an
+// escape code when the client asks for it, so that bulk data such as screen
+// contents is sent as is, in chunks, rather than JSON encoded. A response is
+// an R frame containing the response as JSON without its data field, one or
+// more D frames containing the data and an E frame. Empty data is sent as a
+// single empty D frame so that it can be told apart from no data. Every frame
+// is a one byte type followed by the payload size as a big endian uint32 and
+// the payload. This is framing only, not streaming: the command still builds
+// its complete data in memory and the whole response is copied into the write
+// buffer at once, so it avoids JSON escaping, not holding the data in memory.
+#define RC_FRAME_HEADER_SIZE 5u
+#define RC_FRAME_CHUNK_SIZE (64u * 1024u)
+
+static char*
+write_rc_frame(char *dest, char type, const char *payload, size_t sz) {
+    dest[0] = type;
+    dest[1] = (sz >> 24) & 0xff; dest[2] = (sz >> 16) & 0xff; dest[3] = (sz >> 8) & 0xff; dest[4] = sz & 0xff;
+    if (sz) memcpy(dest + RC_FRAME_HEADER_SIZE, payload, sz);
+    return dest + RC_FRAME_HEADER_SIZE + sz;
+}
+
+static void
+send_framed_response_to_peer(id_type peer_id, const char *header, size_t header_sz, const char *data, size_t data_sz, bool is_async_response) {
+    const size_t num_chunks = MAX(1u, (data_sz + RC_FRAME_CHUNK_SIZE - 1) / RC_FRAME_CHUNK_SIZE);
+    const size_t total = header_sz + data_sz + (num_chunks + 2) * RC_FRAME_HEADER_SIZE;
+    talk_mutex(lock);
+    Peer *peer = peer_for_response(peer_id, is_async_response);
+    if (peer && !peer->write.failed) {
+        ensure_peer_write_space(peer, total);
+        char *p = write_rc_frame(peer->write.data + peer->write.used, 'R', header, header_sz);
+        size_t pos = 0;
+        do {
+            const size_t sz = MIN(RC_FRAME_CHUNK_SIZE, data_sz - pos);
+            p = write_rc_frame(p, 'D', data + pos, sz);
+            pos += sz;
+        } while (pos < data_sz);
+        write_rc_frame(p, 'E', NULL, 0);
+        peer->write.used += total;
+    }
+    talk_mutex(unlock);
+    if (peer) wakeup_talk_loop(false);
+}
+
+// Queues data that is not a response to a command, such as an event, for a
+// peer. Unlike a response it does not change whether the peer is waiting for
+// an asynchronous response, so the peer stays open until it closes the connection.
+static void
+push_to_peer(id_type peer_id, const char *msg, size_t msg_sz) {
+    Peer *peer = NULL;
+    talk_mutex(lock);
+    for (size_t i = 0; i < talk_data.num_peers; i++) {
+        if (talk_data.peers[i].id == peer_id) { peer = talk_data.peers + i; break; }
+    }
+    if (peer && !peer->write.failed && msg_sz) {
+        ensure_peer_write_space(peer, msg_sz);
+        memcpy(peer->write.data + peer->write.used, msg, msg_sz);
+        peer->write.used += msg_sz;
+    }
     talk_mutex(unlock);
-    if (wakeup) wakeup_talk_loop(false);
+    if (peer) wakeup_talk_loop(false);
+}
+
+static bool
+send_python_response_to_peer(id_type peer_id, PyObject *resp, bool is_async_response) {
+    // resp is either bytes or a (header, data) tuple for binary framing
+    if (PyBytes_Check(resp)) { send_response_to_peer(peer_id, PyBytes_AS_STRING(resp), PyBytes_GET_SIZE(resp), is_async_response); return true; }
+    const char *header, *data; Py_ssize_t header_sz, data_sz;
+    PyObject *d;
+    if (!PyArg_ParseTuple(resp, "y#O", &header, &header_sz, &d)) return false;
+    if (PyUnicode_Check(d)) { if (!(data = PyUnicode_AsUTF8AndSize(d, &data_sz))) return false; }
+    else if (PyBytes_Check(d)) { data = PyBytes_AS_STRING(d); data_sz = PyBytes_GET_SIZE(d); }
+    else { PyErr_SetString(PyExc_TypeError, "The data of a framed response must be str or bytes"); return false; }
+    send_framed_response_to_peer(peer_id, header, header_sz, data, data_sz, is_async_response);
+    return true;
 }
 
 // }}}
@@ -2117,20 +2342,93 @@ cocoa_set_menubar_title(PyObject *self UNUSED, PyObject *args UNUSED) {
 
 static PyObject*
 send_data_to_peer(PyObject *self UNUSED, PyObject *args) {
-    char * msg; Py_ssize_t sz;
+    PyObject *msg;
     unsigned long long peer_id;
     int is_async_response = 0;
-    if (!PyArg_ParseTuple(args, "Ks#|p", &peer_id, &msg, &sz, &is_async_response)) return NULL;
-    send_response_to_peer(peer_id, msg, sz, is_async_response);
+    if (!PyArg_ParseTuple(args, "KO|p", &peer_id, &msg, &is_async_response)) return NULL;
+    if (PyTuple_Check(msg)) {
+        if (!send_python_response_to_peer(peer_id, msg, is_async_response)) return NULL;
+    } else {
+        const char *data; Py_ssize_t sz;
+        if (PyUnicode_Check(msg)) { if (!(data = PyUnicode_AsUTF8AndSize(msg, &sz))) return NULL; }
+        else if (PyBytes_Check(msg)) { data = PyBytes_AS_STRING(msg); sz = PyBytes_GET_SIZE(msg); }
+        else { PyErr_SetString(PyExc_TypeError, "msg must be str, bytes or a (header, data) tuple"); return NULL; }
+        send_response_to_peer(peer_id, data, sz, is_async_response);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject*
+push_data_to_peer(PyObject *self UNUSED, PyObject *args) {
+    unsigned long long peer_id;
+    const char *data; Py_ssize_t sz;
+    if (!PyArg_ParseTuple(args, "Ky#", &peer_id, &data, &sz)) return NULL;
+    push_to_peer(peer_id, data, sz);
     Py_RETURN_NONE;
 }
 
+static PyObject*
+peer_pending_output_size(PyObject *self UNUSED, PyObject *pid) {
+    // Number of bytes not yet read by the peer or -1 if there is no such peer
+    unsigned long long peer_id = PyLong_AsUnsignedLongLong(pid);
+    if (PyErr_Occurred()) return NULL;
+    long long ans = -1;
+    talk_mutex(lock);
+    for (size_t i = 0; i < talk_data.num_peers; i++) {
+        if (talk_data.peers[i].id == peer_id) { ans = talk_data.peers[i].write.used; break; }
+    }
+    talk_mutex(unlock);
+    return PyLong_FromLongLong(ans);
+}
+
+static PyObject*
+add_test_peer(PyObject *self UNUSED, PyObject *args UNUSED) {
+    // Adds a remote control peer that has sent one command to the main thread
+    // and returns its id and the other end of its connection. Only for tests,
+    // in which the talk thread does not run.
+    if (talk_thread_started) { PyErr_SetString(PyExc_RuntimeError, "Cannot add test peers while the talk thread is running"); return NULL; }
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return PyErr_SetFromErrno(PyExc_OSError);
+    talk_mutex(lock);
+    id_type peer_id = add_peer(fds[0], true);
+    if (peer_id) talk_data.peers[talk_data.num_peers - 1].num_of_unresponded_messages_sent_to_main_thread = 1;
+    talk_mutex(unlock);
+    if (!peer_id) { safe_close(fds[1], __FILE__, __LINE__); PyErr_SetString(PyExc_RuntimeError, "Too many peers"); return NULL; }
+    return Py_BuildValue("Ki", (unsigned long long)peer_id, fds[1]);
+}
+
+static PyObject*
+test_peer_state(PyObject *self UNUSED, PyObject *args) {
+    // Returns the bookkeeping state of a peer added by add_test_peer(). The
+    // action is one of: write, to write pending output as the talk thread
+    // would, or remove, to remove the peer.
+    unsigned long long peer_id; const char *action = "";
+    if (!PyArg_ParseTuple(args, "K|s", &peer_id, &action)) return NULL;
+    if (talk_thread_started) { PyErr_SetString(PyExc_RuntimeError, "Cannot use test peers while the talk thread is running"); return NULL; }
+    Peer *p = NULL;
+    for (size_t i = 0; i < talk_data.num_peers && !p; i++) if (talk_data.peers[i].id == peer_id) p = talk_data.peers + i;
+    if (!p) Py_RETURN_NONE;
+    if (strcmp(action, "write") == 0 && p->write.used) write_to_peer(p);
+    PyObject *ans = Py_BuildValue("{sOsnsn}", "waiting_for_async_response", p->waiting_for_async_response ? Py_True : Py_False,
+        "unresponded_messages", (Py_ssize_t)p->num_of_unresponded_messages_sent_to_main_thread, "pending_output", (Py_ssize_t)p->write.used);
+    if (strcmp(action, "remove") == 0) {
+        const size_t idx = p - talk_data.peers;
+        free_peer(p);
+        remove_i_from_array(talk_data.peers, idx, talk_data.num_peers);
+    }
+    return ans;
+}
+
 static PyMethodDef module_methods[] = {
     METHODB(safe_pipe, METH_VARARGS),
     {"add_timer", (PyCFunction)add_python_timer, METH_VARARGS, ""},
     {"remove_timer", (PyCFunction)remove_python_timer, METH_VARARGS, ""},
     METHODB(monitor_pid, METH_VARARGS),
     METHODB(send_data_to_peer, METH_VARARGS),
+    METHODB(peer_pending_output_size, METH_O),
+    METHODB(push_data_to_peer, METH_VARARGS),
+    METHODB(add_test_peer, METH_NOARGS),
+    METHODB(test_peer_state, METH_VARARGS),
     METHODB(cocoa_set_menubar_title, METH_VARARGS),
     METHODB(mask_kitty_signals_process_wide, METH_NOARGS),
     {"sigqueue", (PyCFunction)sig_queue, METH_VARARGS, ""},
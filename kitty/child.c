@@ -15,6 +15,12 @@
 #include <signal.h>
 #include <sys/ioctl.h>
 #include <termios.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include "launcher/spawn-helper.h"
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
 
 #define EXTRA_ENV_BUFFER_SIZE 64
 
@@ -62,13 +68,170 @@ wait_for_terminal_ready(int fd) {
     }
 }
 
+// Spawning via the spawn helper {{{
+typedef struct HelperArgs {
+    char **argv;
+    char ready_fd[32], preserved_fds[2048];
+    int forwarded_fds[2];
+} HelperArgs;
+
+static void
+free_helper_args(HelperArgs *h) {
+    for (size_t i = 0; i < arraysz(h->forwarded_fds); i++) if (h->forwarded_fds[i] > -1) safe_close(h->forwarded_fds[i], __FILE__, __LINE__);
+    free(h->argv);
+}
+
+// Build the command line of the spawn helper, see spawn-helper.c
+static bool
+prepare_helper_args(
+    HelperArgs *h, const char *spawn_helper, const char *exe, const char *cwd, const char *tty_name, char **argv, Py_ssize_t argc,
+    char **env, Py_ssize_t envc, int ready_read_fd, const char *kitten_exe, bool forward_stdio, PyObject *pass_fds
+) {
+    size_t pos = 0;
+    h->forwarded_fds[0] = -1; h->forwarded_fds[1] = -1;
+    if (!(h->argv = calloc(argc + 8, sizeof(char*)))) { PyErr_NoMemory(); return false; }
+    if (forward_stdio) {
+        // dup() does not set FD_CLOEXEC so these will be inherited by the helper
+        if ((h->forwarded_fds[0] = safe_dup(STDOUT_FILENO)) < 0 || (h->forwarded_fds[1] = safe_dup(STDERR_FILENO)) < 0) {
+            PyErr_SetFromErrno(PyExc_OSError); return false;
+        }
+        env[envc] = (char*)(env + (envc + 2));
+        snprintf(env[envc], EXTRA_ENV_BUFFER_SIZE, "KITTY_STDIO_FORWARDED=%d", h->forwarded_fds[0]);
+        pos += snprintf(h->preserved_fds, sizeof(h->preserved_fds), "%d,%d", h->forwarded_fds[0], h->forwarded_fds[1]);
+    }
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(pass_fds); i++) {
+        PyObject *pfd = PyTuple_GET_ITEM(pass_fds, i);
+        if (!PyLong_Check(pfd)) { PyErr_SetString(PyExc_TypeError, "pass_fds must contain only integers"); return false; }
+        int fd = PyLong_AsLong(pfd);
+        if (fd > -1 && fd < FD_SETSIZE && pos + 16 < sizeof(h->preserved_fds)) {
+            pos += snprintf(h->preserved_fds + pos, sizeof(h->preserved_fds) - pos, "%s%d", pos ? "," : "", fd);
+        }
+    }
+    snprintf(h->ready_fd, sizeof(h->ready_fd), "%d", ready_read_fd);
+    h->argv[0] = (char*)spawn_helper; h->argv[1] = (char*)cwd; h->argv[2] = (char*)tty_name; h->argv[3] = h->ready_fd;
+    h->argv[4] = h->preserved_fds; h->argv[5] = (char*)kitten_exe; h->argv[6] = (char*)exe;
+    memcpy(h->argv + 7, argv, argc * sizeof(char*));
+    return true;
+}
+
+// Spawn the child using posix_spawn() which on modern libcs uses
+// vfork()/clone(CLONE_VM|CLONE_VFORK) so its cost does not depend on the size
+// of the kitty process. The steps that posix_spawn() cannot perform, such as
+// establishing the controlling terminal and waiting for the terminal to be
+// ready, are done by the spawn helper which then execs the actual child.
+static pid_t
+spawn_via_helper(const HelperArgs *h, char **env, int slave, int stdin_read_fd, const int *handled_signals, int num_handled_signals) {
+    pid_t pid = -1;
+    posix_spawnattr_t attr; posix_spawn_file_actions_t actions;
+    if ((errno = posix_spawnattr_init(&attr)) != 0) { PyErr_SetFromErrno(PyExc_OSError); return -1; }
+    if ((errno = posix_spawn_file_actions_init(&actions)) != 0) { posix_spawnattr_destroy(&attr); PyErr_SetFromErrno(PyExc_OSError); return -1; }
+    sigset_t defaults, mask; sigemptyset(&defaults); sigemptyset(&mask);
+    for (int si = 0; si < num_handled_signals; si++) sigaddset(&defaults, handled_signals[si]);
+    // See _Py_RestoreSignals in signalmodule.c for a list of signals python nukes
+#ifdef SIGPIPE
+    sigaddset(&defaults, SIGPIPE);
+#endif
+#ifdef SIGXFSZ
+    sigaddset(&defaults, SIGXFSZ);
+#endif
+#ifdef SIGXFZ
+    sigaddset(&defaults, SIGXFZ);
+#endif
+    bool ok = true;
+#define C(x) if (ok && (errno = x) != 0) { PyErr_SetFromErrno(PyExc_OSError); ok = false; }
+    C(posix_spawnattr_setsigdefault(&attr, &defaults));
+    C(posix_spawnattr_setsigmask(&attr, &mask));
+    C(posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK));
+    // Redirect stdin/stdout/stderr to the pty
+    C(posix_spawn_file_actions_adddup2(&actions, stdin_read_fd > -1 ? stdin_read_fd : slave, STDIN_FILENO));
+    C(posix_spawn_file_actions_adddup2(&actions, slave, STDOUT_FILENO));
+    C(posix_spawn_file_actions_adddup2(&actions, slave, STDERR_FILENO));
+    C(posix_spawn(&pid, h->argv[0], &actions, &attr, h->argv, env));
+#undef C
+    if (!ok) pid = -1;
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+    return pid;
+}
+
+static bool
+send_all(int fd, const void *buf, size_t sz) {
+    const char *p = buf;
+    while (sz) {
+        ssize_t n = send(fd, p, sz, MSG_NOSIGNAL);
+        if (n < 0) { if (errno == EINTR || errno == EAGAIN) continue; PyErr_SetFromErrno(PyExc_OSError); return false; }
+        p += n; sz -= n;
+    }
+    return true;
+}
+
+static bool
+recv_all(int fd, void *buf, size_t sz) {
+    char *p = buf;
+    while (sz) {
+        ssize_t n = recv(fd, p, sz, 0);
+        if (n < 0) { if (errno == EINTR || errno == EAGAIN) continue; PyErr_SetFromErrno(PyExc_OSError); return false; }
+        if (n == 0) { PyErr_SetString(PyExc_ConnectionResetError, "The zygote process has quit"); return false; }
+        p += n; sz -= n;
+    }
+    return true;
+}
+
+// Send a launch request to the zygote, see spawn-helper.h. The child is
+// created by the zygote from its own small address space and is a child of
+// kitty.
+static pid_t
+spawn_via_zygote(int zygote_fd, const HelperArgs *h, Py_ssize_t argc, char **env, int slave, int stdin_read_fd, int ready_read_fd, PyObject *pass_fds) {
+    ZygoteRequest req = {.argc=argc + 6};
+    int fds[ZYGOTE_MAX_FDS];
+#define add_fd(src, target) { if (req.num_fds >= ZYGOTE_MAX_FDS) { PyErr_SetString(PyExc_OSError, "Too many fds to pass to zygote"); return -1; } fds[req.num_fds] = src; req.targets[req.num_fds++] = target; }
+    add_fd(stdin_read_fd > -1 ? stdin_read_fd : slave, STDIN_FILENO);
+    add_fd(slave, STDOUT_FILENO);
+    add_fd(slave, STDERR_FILENO);
+    add_fd(ready_read_fd, ready_read_fd);
+    for (size_t i = 0; i < arraysz(h->forwarded_fds); i++) if (h->forwarded_fds[i] > -1) add_fd(h->forwarded_fds[i], h->forwarded_fds[i]);
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(pass_fds); i++) {
+        int fd = PyLong_AsLong(PyTuple_GET_ITEM(pass_fds, i));
+        if (fd > -1 && fd < FD_SETSIZE) add_fd(fd, fd);
+    }
+#undef add_fd
+    for (uint32_t i = 0; i < req.argc; i++) req.payload_size += strlen(h->argv[i + 1]) + 1;
+    for (char **e = env; *e; e++) { req.payload_size += strlen(*e) + 1; req.envc++; }
+    RAII_ALLOC(char, payload, malloc(req.payload_size));
+    if (!payload) { PyErr_NoMemory(); return -1; }
+    size_t pos = 0;
+#define add_str(x) { size_t n = strlen(x) + 1; memcpy(payload + pos, x, n); pos += n; }
+    for (uint32_t i = 0; i < req.argc; i++) add_str(h->argv[i + 1]);
+    for (char **e = env; *e; e++) add_str(*e);
+#undef add_str
+
+    union { char buf[CMSG_SPACE(sizeof(int) * ZYGOTE_MAX_FDS)]; struct cmsghdr align; } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = {.iov_base=&req, .iov_len=sizeof(req)};
+    struct msghdr msg = {.msg_iov=&iov, .msg_iovlen=1, .msg_control=control.buf, .msg_controllen=CMSG_SPACE(sizeof(int) * req.num_fds)};
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET; cmsg->cmsg_type = SCM_RIGHTS; cmsg->cmsg_len = CMSG_LEN(sizeof(int) * req.num_fds);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * req.num_fds);
+    ssize_t n;
+    while ((n = sendmsg(zygote_fd, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR);
+    if (n < 0) { PyErr_SetFromErrno(PyExc_OSError); return -1; }
+    // The fds have been sent with the first byte, send the rest normally
+    if (!send_all(zygote_fd, (char*)&req + n, sizeof(req) - n) || !send_all(zygote_fd, payload, req.payload_size)) return -1;
+    int32_t reply;
+    if (!recv_all(zygote_fd, &reply, sizeof(reply))) return -1;
+    if (reply < 0) { errno = -reply; PyErr_SetFromErrno(PyExc_OSError); return -1; }
+    return reply;
+}
+// }}}
+
 static PyObject*
 spawn(PyObject *self UNUSED, PyObject *args) {
     PyObject *argv_p, *env_p, *handled_signals_p, *pass_fds;
     int master, slave, stdin_read_fd, stdin_write_fd, ready_read_fd, ready_write_fd, forward_stdio;
-    const char *kitten_exe;
+    int zygote_fd = -1;
+    const char *kitten_exe, *spawn_helper = "";
     char *cwd, *exe;
-    if (!PyArg_ParseTuple(args, "ssO!O!iiiiiiO!spO!", &exe, &cwd, &PyTuple_Type, &argv_p, &PyTuple_Type, &env_p, &master, &slave, &stdin_read_fd, &stdin_write_fd, &ready_read_fd, &ready_write_fd, &PyTuple_Type, &handled_signals_p, &kitten_exe, &forward_stdio, &PyTuple_Type, &pass_fds)) return NULL;
+    if (!PyArg_ParseTuple(args, "ssO!O!iiiiiiO!spO!|si", &exe, &cwd, &PyTuple_Type, &argv_p, &PyTuple_Type, &env_p, &master, &slave, &stdin_read_fd, &stdin_write_fd, &ready_read_fd, &ready_write_fd, &PyTuple_Type, &handled_signals_p, &kitten_exe, &forward_stdio, &PyTuple_Type, &pass_fds, &spawn_helper, &zygote_fd)) return NULL;
     char name[2048] = {0};
     if (ttyname_r(slave, name, sizeof(name) - 1) != 0) { PyErr_SetFromErrno(PyExc_OSError); return NULL; }
     char **argv = serialize_string_tuple(argv_p, 0);
@@ -78,6 +241,21 @@ spawn(PyObject *self UNUSED, PyObject *args) {
     int handled_signals[16] = {0}, num_handled_signals = MIN((int)arraysz(handled_signals), PyTuple_GET_SIZE(handled_signals_p));
     for (Py_ssize_t i = 0; i < num_handled_signals; i++) handled_signals[i] = PyLong_AsLong(PyTuple_GET_ITEM(handled_signals_p, i));
 
+    if (spawn_helper[0]) {
+        HelperArgs h = {0};
+        pid_t pid = -1;
+        if (prepare_helper_args(
+            &h, spawn_helper, exe, cwd, name, argv, PyTuple_GET_SIZE(argv_p), env, PyTuple_GET_SIZE(env_p), ready_read_fd, kitten_exe, forward_stdio, pass_fds)
+        ) {
+            if (zygote_fd > -1) pid = spawn_via_zygote(zygote_fd, &h, PyTuple_GET_SIZE(argv_p), env, slave, stdin_read_fd, ready_read_fd, pass_fds);
+            else pid = spawn_via_helper(&h, env, slave, stdin_read_fd, handled_signals, num_handled_signals);
+        }
+        free_helper_args(&h);
+        free(argv); free(env);
+        if (pid < 0) return NULL;
+        return PyLong_FromLong(pid);
+    }
+
 #if PY_VERSION_HEX >= 0x03070000
     PyOS_BeforeFork();
 #endif
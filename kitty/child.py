@@ -12,7 +12,7 @@
 
 import kitty.fast_data_types as fast_data_types
 
-from .constants import handled_signals, is_freebsd, is_macos, kitten_exe, kitty_base_dir, shell_path, terminfo_dir
+from .constants import handled_signals, is_freebsd, is_macos, kitten_exe, kitty_base_dir, shell_path, spawn_helper_exe, terminfo_dir
 from .types import run_once
 from .utils import cmdline_for_hold, log_error, resolved_shell, which
 
@@ -108,6 +108,10 @@ def processes_in_group(grp: int) -> list[int]:
 
 @contextmanager
 def cached_process_data() -> Generator[None, None, None]:
+    if hasattr(process_group_map, 'cached_map'):
+        # nested use, keep the snapshot of the outermost context
+        yield
+        return
     try:
         cm = process_group_map()
     except Exception:
@@ -209,6 +213,44 @@ class ProcessDesc(TypedDict):
     cmdline: Sequence[str] | None
 
 
+class Zygote:
+
+    # A pre-spawned spawn helper that launches children from its own small
+    # address space, see spawn-helper.c. Only supported on Linux.
+    fd: int = -1
+    failed: bool = False
+
+    def fd_for_spawn(self) -> int:
+        if self.fd < 0 and not self.failed:
+            helper = spawn_helper_exe()
+            if is_macos or is_freebsd or not helper:
+                self.failed = True
+                return -1
+            import signal
+            import socket
+            ours, theirs = socket.socketpair(socket.AF_UNIX, socket.SOCK_STREAM)
+            with ours, theirs:
+                os.set_inheritable(theirs.fileno(), True)
+                try:
+                    os.posix_spawn(
+                        helper, [helper, '--zygote', str(theirs.fileno())], {}, setsid=True, setsigmask=(),
+                        setsigdef=tuple(handled_signals) + (signal.SIGPIPE, signal.SIGXFSZ))
+                except OSError as err:
+                    log_error(f'Failed to start the zygote process with error: {err}')
+                    self.failed = True
+                    return -1
+                self.fd = ours.detach()
+        return self.fd
+
+    def shutdown(self, failed: bool = False) -> None:
+        # The zygote quits when its socket is closed
+        if self.fd > -1:
+            os.close(self.fd)
+            self.fd = -1
+        self.failed = failed
+
+
+zygote = Zygote()
 child_counter = count()
 
 
@@ -375,9 +417,21 @@ def fork(self) -> int | None:
             argv = cmdline_for_hold(argv)
             final_exe = argv[0]
         env = tuple(f'{k}={v}' for k, v in self.final_env.items())
-        pid = fast_data_types.spawn(
+        spawn_args = (
             final_exe, cwd, tuple(argv), env, master, slave, stdin_read_fd, stdin_write_fd,
-            ready_read_fd, ready_write_fd, tuple(handled_signals), kitten_exe(), opts.forward_stdio, pass_fds)
+            ready_read_fd, ready_write_fd, tuple(handled_signals), kitten_exe(), opts.forward_stdio, pass_fds,
+            spawn_helper_exe())
+        if opts.spawn_zygote and (zygote_fd := zygote.fd_for_spawn()) > -1:
+            try:
+                pid = fast_data_types.spawn(*spawn_args, zygote_fd)
+            except OSError as err:
+                log_error(f'Failed to launch child via the zygote process, disabling it. Error: {err}')
+                zygote.shutdown(failed=True)
+                pid = fast_data_types.spawn(*spawn_args)
+        else:
+            if not opts.spawn_zygote:
+                zygote.shutdown()
+            pid = fast_data_types.spawn(*spawn_args)
         os.close(slave)
         self.pid = pid
         self.child_fd = master
@@ -19,6 +19,7 @@ typedef enum {
     FREETYPE_CLEANUP_FUNC,
     SYSTEMD_CLEANUP_FUNC,
     SHADERS_CLEANUP_FUNC,
+    GRAPHICS_CLEANUP_FUNC,
 
     NUM_CLEANUP_FUNCS
 } AtExitCleanupFunc;
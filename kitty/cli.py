@@ -724,11 +724,11 @@ def parse_override(x: str) -> str:
     return override_pat().sub(r'\1 ', x.lstrip())
 
 
-def create_opts(args: CLIOptions, accumulate_bad_lines: list[BadLineType] | None = None) -> KittyOpts:
+def create_opts(args: CLIOptions, accumulate_bad_lines: list[BadLineType] | None = None, share: bool = False) -> KittyOpts:
     from .config import load_config
     config = default_config_paths(args.config)
     overrides = map(parse_override, args.override or ())
-    opts = load_config(*config, overrides=overrides, accumulate_bad_lines=accumulate_bad_lines)
+    opts = load_config(*config, overrides=overrides, accumulate_bad_lines=accumulate_bad_lines, use_cache=True, share=share)
     return opts
 
 
@@ -781,6 +781,11 @@ contrast(Color* self, PyObject *o) {
     return PyFloat_FromDouble(rgb_contrast(self->color, other->color));
 }
 
+static PyObject*
+color_reduce(Color* self, PyObject *args UNUSED) {
+    return Py_BuildValue("O(BBBB)", Py_TYPE(self), self->color.r, self->color.g, self->color.b, self->color.a);
+}
+
 static int
 hexchar_to_int(char c) {
     switch (c) {
@@ -1121,6 +1126,7 @@ parse_color(PyTypeObject *type UNUSED, PyObject *pspec) {
 static PyMethodDef color_methods[] = {
     METHODB(contrast, METH_O),
     METHODB(parse_color, METH_O | METH_CLASS),
+    {"__reduce__", (PyCFunction)color_reduce, METH_NOARGS, ""},
     {NULL}  /* Sentinel */
 };
 
@@ -244,6 +244,107 @@ def geninclude(path: str) -> list[str]:
 
 
 
+def glob_include(base_path_for_includes: str, pattern: str) -> tuple[str, ...]:
+    from pathlib import Path
+    return tuple(map(lambda x: str(os.fspath(x)), sorted(Path(base_path_for_includes).glob(pattern))))
+
+
+def env_include(pattern: str) -> tuple[tuple[str, str], ...]:
+    from fnmatch import fnmatchcase
+    return tuple((k, v) for k, v in os.environ.items() if fnmatchcase(k, pattern))
+
+
+env_var_pat = re.compile(r'\$(?:(\w+)|\{([^}]+)\})')
+FileSignature = tuple[int, int, int]
+
+
+def file_signature(st: os.stat_result) -> FileSignature:
+    return st.st_mtime_ns, st.st_size, st.st_ino
+
+
+class ConfigDependencies:
+
+    '''
+    Everything the result of parsing some config files depends on: the files
+    themselves, the environment variables they refer to and the results of
+    globinclude and envinclude. Used to check if a cached parse result is still
+    valid without parsing again.
+    '''
+
+    def __init__(self) -> None:
+        self.files: dict[str, FileSignature | None] = {}
+        self.env_vars: dict[str, str | None] = {'HOME': os.environ.get('HOME')}
+        self.globs: dict[tuple[str, str], tuple[str, ...]] = {}
+        self.env_includes: dict[str, tuple[tuple[str, str], ...]] = {}
+        self.cacheable = True
+
+    def add_file(self, path: str, st: os.stat_result | None = None) -> None:
+        self.files[os.path.abspath(path)] = None if st is None else file_signature(st)
+
+    def add_env_vars_in(self, line: str) -> None:
+        if '$' in line:
+            for m in env_var_pat.finditer(line):
+                key = m.group(1) or m.group(2)
+                self.env_vars[key] = os.environ.get(key)
+
+    def is_valid(self) -> bool:
+        for path, sig in self.files.items():
+            try:
+                st = os.stat(path)
+            except OSError:
+                if sig is not None:
+                    return False
+            else:
+                if sig != file_signature(st):
+                    return False
+        for key, val in self.env_vars.items():
+            if os.environ.get(key) != val:
+                return False
+        for (base, pattern), found in self.globs.items():
+            if glob_include(base, pattern) != found:
+                return False
+        for pattern, matched in self.env_includes.items():
+            if env_include(pattern) != matched:
+                return False
+        return True
+
+
+config_dependencies: ConfigDependencies | None = None
+
+
+@contextmanager
+def recording_dependencies() -> Iterator[ConfigDependencies]:
+    global config_dependencies
+    orig = config_dependencies
+    config_dependencies = ans = ConfigDependencies()
+    orig_redirect = getattr(log_error, 'redirect', None)
+
+    def redirect(msg: str) -> None:
+        # Many option parsers report problems without failing, such configs
+        # must be parsed, and so the problems reported, every time
+        ans.cacheable = False
+        if orig_redirect is None:
+            from ..fast_data_types import log_error_string
+            log_error_string(msg)
+        else:
+            orig_redirect(msg)
+
+    setattr(log_error, 'redirect', redirect)
+    try:
+        yield ans
+    finally:
+        config_dependencies = orig
+        if orig_redirect is None:
+            delattr(log_error, 'redirect')
+        else:
+            setattr(log_error, 'redirect', orig_redirect)
+
+
+def not_cacheable() -> None:
+    if config_dependencies is not None:
+        config_dependencies.cacheable = False
+
+
 include_keys = 'include', 'globinclude', 'envinclude', 'geninclude'
 
 
@@ -284,24 +385,30 @@ def parse_line(
     m = key_pat.match(line)
     if m is None:
         log_error(f'Ignoring invalid config line: {line!r}')
+        not_cacheable()
         return
     key, val = m.groups()
+    if config_dependencies is not None:
+        config_dependencies.add_env_vars_in(val)
     if key.endswith('include') and key in include_keys:
         val = expandvars(os.path.expanduser(val.strip()), {'KITTY_OS': os_name()})
         if key == 'globinclude':
-            from pathlib import Path
-            vals = tuple(map(lambda x: str(os.fspath(x)), sorted(Path(base_path_for_includes).glob(val))))
+            vals = glob_include(base_path_for_includes, val)
+            if config_dependencies is not None:
+                config_dependencies.globs[(base_path_for_includes, val)] = vals
         elif key == 'envinclude':
-            from fnmatch import fnmatchcase
-            for x in os.environ:
-                if fnmatchcase(x, val):
-                    with currently_parsing.set_file(f'<env var: {x}>'):
-                        _parse(
-                            NamedLineIterator(os.path.join(base_path_for_includes, ''), iter(os.environ[x].splitlines())),
-                            parse_conf_item, ans, memory, accumulate_bad_lines, effective_config_lines
-                        )
+            matched = env_include(val)
+            if config_dependencies is not None:
+                config_dependencies.env_includes[val] = matched
+            for x, env_val in matched:
+                with currently_parsing.set_file(f'<env var: {x}>'):
+                    _parse(
+                        NamedLineIterator(os.path.join(base_path_for_includes, ''), iter(env_val.splitlines())),
+                        parse_conf_item, ans, memory, accumulate_bad_lines, effective_config_lines
+                    )
             return
         elif key == 'geninclude':
+            not_cacheable()  # the output of the program can change at any time
             if not os.path.isabs(val):
                 val = os.path.join(base_path_for_includes, val)
             if not memory.seen(val):
@@ -328,20 +435,25 @@ def parse_line(
                 continue
             try:
                 with open(val, encoding='utf-8', errors='replace') as include:
+                    if config_dependencies is not None:
+                        config_dependencies.add_file(val, os.fstat(include.fileno()))
                     with currently_parsing.set_file(val):
                         _parse(include, parse_conf_item, ans, memory, accumulate_bad_lines, effective_config_lines)
             except FileNotFoundError:
                 log_error(f'Could not find included config file: {val}, ignoring')
+                not_cacheable()
             except OSError:
                 log_error(
                     'Could not read from included config file: {}, ignoring'.
                     format(val)
                 )
+                not_cacheable()
         return
     if parse_conf_item(key, val, ans):
         effective_config_lines(key, line)
     else:
         log_error(f'Ignoring unknown config key: {key}')
+        not_cacheable()
 
 
 
@@ -441,14 +553,19 @@ def load_config(
             continue
         if path == '-':
             path = '/dev/stdin'
+            not_cacheable()
             with currently_parsing.set_file(path):
                 vals = parse_config(sys.stdin)
         else:
             try:
                 with open(path, encoding='utf-8', errors='replace') as f:
+                    if config_dependencies is not None:
+                        config_dependencies.add_file(path, os.fstat(f.fileno()))
                     with currently_parsing.set_file(path):
                         vals = parse_config(f)
             except (FileNotFoundError, PermissionError):
+                if config_dependencies is not None:
+                    config_dependencies.add_file(path)
                 continue
         found_paths.append(path)
         ans = merge_configs(ans, vals)
@@ -8,9 +8,9 @@
 from functools import partial
 from typing import Any
 
-from .conf.utils import BadLine, parse_config_base
+from .conf.utils import BadLine, ConfigDependencies, parse_config_base, recording_dependencies
 from .conf.utils import load_config as _load_config
-from .constants import cache_dir, defconf
+from .constants import cache_dir, config_dir, defconf, str_version
 from .options.types import Options, defaults, option_names
 from .options.utils import KeyboardMode, KeyboardModeMap, KeyDefinition, MouseMap, MouseMapping, build_action_aliases
 from .typing_compat import TypedDict
@@ -159,19 +159,98 @@ def parse_config(
 effective_config_lines: list[str] = []
 
 
-def load_config(*paths: str, overrides: Iterable[str] | None = None, accumulate_bad_lines: list[BadLine] | None = None) -> Options:
+# Compiled config cache {{{
+# The merged result of parsing the config files is cached, keyed by the paths
+# and overrides, and re-used as long as none of the files or environment
+# variables it depends on have changed, see ConfigDependencies.
+
+CONFIG_CACHE_VERSION = 1
+CompiledConfig = tuple[dict[str, Any], tuple[str, ...], list[str]]
+
+
+def compiled_config_path(paths: tuple[str, ...], overrides: tuple[str, ...]) -> str:
+    from hashlib import sha256
+    key = CONFIG_CACHE_VERSION, str_version, config_dir, tuple(p if p == '-' else os.path.abspath(p) for p in paths), overrides
+    return os.path.join(cache_dir(), 'compiled-config', sha256(repr(key).encode()).hexdigest())
+
+
+def load_compiled_config(path: str) -> tuple[ConfigDependencies, CompiledConfig] | None:
+    import pickle
+    try:
+        with open(path, 'rb') as f:
+            deps, ans = pickle.load(f)
+    except FileNotFoundError:
+        return None
+    except Exception as err:
+        log_error(f'Ignoring invalid compiled config cache at {path} with error: {err}')
+        return None
+    if not isinstance(deps, ConfigDependencies) or not deps.is_valid():
+        return None
+    return deps, ans
+
+
+def save_compiled_config(path: str, deps: ConfigDependencies, compiled: CompiledConfig, max_entries: int = 16) -> None:
+    import pickle
+    from .options import parse, types, utils
+    from .conf import utils as conf_utils
+    # changes to the parsing code in a development checkout invalidate the cache
+    for m in (parse, types, utils, conf_utils):
+        with suppress(OSError):
+            deps.add_file(m.__file__, os.stat(m.__file__))
+    try:
+        data = pickle.dumps((deps, compiled), protocol=pickle.HIGHEST_PROTOCOL)
+    except Exception as err:
+        log_error(f'Not caching compiled config as it could not be serialized with error: {err}')
+        return
+    d = os.path.dirname(path)
+    try:
+        os.makedirs(d, mode=0o700, exist_ok=True)
+        atomic_save(data, path)
+        entries = sorted(os.scandir(d), key=lambda e: e.stat().st_mtime, reverse=True)
+        for e in entries[max_entries:]:
+            os.remove(e.path)
+    except OSError as err:
+        log_error(f'Failed to save compiled config with error: {err}')
+
+
+# Options objects returned by load_config(share=True), re-used as long as the
+# config they were created from is unchanged
+shared_options: dict[str, tuple[ConfigDependencies, Options]] = {}
+# }}}
+
+
+def load_config(
+    *paths: str, overrides: Iterable[str] | None = None, accumulate_bad_lines: list[BadLine] | None = None,
+    use_cache: bool = False, share: bool = False,
+) -> Options:
+    ''' With share=True the returned object may be returned by later calls as well, so it must not be modified. '''
     from .options.parse import merge_result_dicts
     from .options.types import secret_options
+
+    overrides = tuple(overrides) if overrides is not None else ()
+    cache_path = compiled_config_path(paths, overrides) if use_cache or share else ''
+    if share and (shared := shared_options.get(cache_path)) is not None and shared[0].is_valid():
+        return shared[1]
     del effective_config_lines[:]
 
     def add_effective_config_line(key: str, line: str) -> None:
         if key not in secret_options:
             effective_config_lines.append(line)
 
-    overrides = tuple(overrides) if overrides is not None else ()
-    opts_dict, found_paths = _load_config(
-        defaults, partial(parse_config, accumulate_bad_lines=accumulate_bad_lines, effective_config_lines=add_effective_config_line),
-        merge_result_dicts, *paths, overrides=overrides)
+    if use_cache and (loaded := load_compiled_config(cache_path)) is not None:
+        deps, (opts_dict, found_paths, lines) = loaded
+        effective_config_lines.extend(lines)
+    else:
+        num_bad_lines = len(accumulate_bad_lines or ())
+        with recording_dependencies() as deps:
+            opts_dict, found_paths = _load_config(
+                defaults, partial(parse_config, accumulate_bad_lines=accumulate_bad_lines, effective_config_lines=add_effective_config_line),
+                merge_result_dicts, *paths, overrides=overrides)
+        # configs with errors are never cached so that the errors are reported every time
+        if num_bad_lines != len(accumulate_bad_lines or ()):
+            deps.cacheable = False
+        if use_cache and deps.cacheable:
+            save_compiled_config(cache_path, deps, (opts_dict, found_paths, effective_config_lines[:]))
     opts = Options(opts_dict)
 
     opts.alias_map = build_action_aliases(opts.kitten_alias, 'kitten')
@@ -186,6 +265,11 @@ def add_effective_config_line(key: str, line: str) -> None:
     opts.config_paths = found_paths
     opts.all_config_paths = paths
     opts.config_overrides = overrides
+    if share and deps.cacheable:
+        shared_options.pop(cache_path, None)
+        while len(shared_options) > 3:
+            del shared_options[next(iter(shared_options))]
+        shared_options[cache_path] = deps, opts
     return opts
 
 
@@ -89,6 +89,14 @@ def kitten_exe() -> str:
     return os.path.join(os.path.dirname(kitty_exe()), 'kitten')
 
 
+@run_once
+def spawn_helper_exe() -> str:
+    # Empty if the helper is not available, in which case children are
+    # spawned using fork()
+    ans = os.path.join(os.path.dirname(kitty_exe()), 'kitty-spawn-helper')
+    return ans if os.access(ans, os.X_OK) else ''
+
+
 def _get_config_dir() -> str:
     cdir = kitty_run_data.get('config_dir', '')
     if cdir:
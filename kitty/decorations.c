@@ -7,6 +7,7 @@
 
 #include "decorations.h"
 #include "state.h"
+#include "simd-string.h"
 
 typedef uint32_t uint;
 
@@ -239,6 +240,7 @@ typedef struct Canvas {
     uint width, height, supersample_factor;
     struct { double x, y; } dpi;
     double scale;  // used to scale line thickness with font size for multicell rendering
+    const float *line_thickness;  // the box_drawing_scale option
     Range *holes; uint holes_count, holes_capacity;
     Limit *y_limits; uint y_limits_count, y_limits_capacity;
 } Canvas;
@@ -262,7 +264,7 @@ append_limit(Canvas *self, double upper, double lower) {
 static double
 thickness_as_float(Canvas *self, uint level, bool horizontal) {
     level = min(level, arraysz(OPT(box_drawing_scale)));
-    double pts = OPT(box_drawing_scale)[level];
+    double pts = self->line_thickness[level];
     double dpi = horizontal ? self->dpi.x : self->dpi.y;
     return self->supersample_factor * self->scale * pts * dpi / 72.0;
 }
@@ -482,6 +484,10 @@ average_intensity(const Canvas *src, uint dest_x, uint dest_y) {
 
 static void
 downsample(const Canvas *src, Canvas *dest) {
+    if (src->supersample_factor == 4 && src->width >= 4 * dest->width) {
+        for (uint y = 0; y < dest->height; y++) downsample_and_add_4x4(src->mask + 4 * y * src->width, src->width, dest->mask + dest->width * y, dest->width);
+        return;
+    }
     for (uint y = 0; y < dest->height; y++) {
         uint offset = dest->width * y;
         for (uint x = 0; x < dest->width; x++) {
@@ -1536,7 +1542,14 @@ sextant(Canvas *self, uint which) {
 
 void
 render_box_char(char_type ch, uint8_t *buf, unsigned width, unsigned height, double dpi_x, double dpi_y, double scale) {
-    Canvas canvas = {.mask=buf, .width = width, .height = height, .dpi={.x=dpi_x, .y=dpi_y}, .supersample_factor=1u, .scale=scale}, ss = canvas;
+    render_box_char_with_line_thickness(ch, buf, width, height, dpi_x, dpi_y, scale, OPT(box_drawing_scale));
+}
+
+void
+render_box_char_with_line_thickness(
+    char_type ch, uint8_t *buf, unsigned width, unsigned height, double dpi_x, double dpi_y, double scale, const float line_thickness[4]
+) {
+    Canvas canvas = {.mask=buf, .width = width, .height = height, .dpi={.x=dpi_x, .y=dpi_y}, .supersample_factor=1u, .scale=scale, .line_thickness=line_thickness}, ss = canvas;
     ss.mask = buf + width*height; ss.supersample_factor = SUPERSAMPLE_FACTOR;
     ss.width *= SUPERSAMPLE_FACTOR; ss.height *= SUPERSAMPLE_FACTOR;
     fill_canvas(&canvas, 0);
@@ -23,5 +23,18 @@ DecorationGeometry add_missing_glyph(uint8_t *buf, FontCellMetrics fcm);
 DecorationGeometry add_beam_cursor(uint8_t *buf, FontCellMetrics fcm, double dpi_x);
 DecorationGeometry add_underline_cursor(uint8_t *buf, FontCellMetrics fcm, double dpi_y);
 DecorationGeometry add_hollow_cursor(uint8_t *buf, FontCellMetrics fcm, double dpi_x, double dpi_y);
+// All codepoints rendered by render_box_char() as inclusive ranges
+#define BOX_CHAR_RANGES(R) \
+    R(0x2500, 0x259f) R(0x25c9, 0x25c9) R(0x25cb, 0x25cb) R(0x25cf, 0x25cf) R(0x25d6, 0x25d7) R(0x25dc, 0x25e5) \
+    R(0x2800, 0x28ff) /* braille */ \
+    R(0xe0b0, 0xe0bf) R(0xe0d6, 0xe0d7) /* powerline box drawing */ \
+    R(0xee00, 0xee0b) /* fira code progress bar/spinner */ \
+    R(0x1fb00, 0x1fbae) /* symbols for legacy computing */ \
+    R(0x1cd00, 0x1cde5) R(0x1fbe6, 0x1fbe7) /* octants */ \
+    R(0xf5d0, 0xf60d) /* branch drawing characters */
 void render_box_char(char_type ch, uint8_t *buf, unsigned width, unsigned height, double dpi_x, double dpi_y, double scale);
+// Same as render_box_char() but with the specified line thicknesses instead of
+// those from the box_drawing_scale option, safe to call from other threads
+void render_box_char_with_line_thickness(
+    char_type ch, uint8_t *buf, unsigned width, unsigned height, double dpi_x, double dpi_y, double scale, const float line_thickness[4]);
 #define SUPERSAMPLE_FACTOR 4u
@@ -6,6 +6,11 @@
  */
 
 #define MAX_KEY_SIZE 16u
+// Limits on the number of dirty entries written out together
+#define MAX_BATCH_ENTRIES 32u
+#define MAX_BATCH_SIZE (8u * 1024u * 1024u)
+// Disk space is reserved for the cache file in chunks of this size
+#define FALLOCATE_CHUNK_SIZE (4 * 1024 * 1024)
 
 #include "disk-cache.h"
 #include "safe-wrappers.h"
@@ -15,11 +20,18 @@
 #include "threading.h"
 #include "cross-platform-random.h"
 #include <structmember.h>
+#include <openssl/evp.h>
+#include <openssl/crypto.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <time.h>
 
+typedef enum { NO_ENCRYPTION, XOR_ENCRYPTION, AES_CTR_ENCRYPTION, CHACHA20_ENCRYPTION } EncryptionMode;
+#define CIPHER_KEY_SIZE 32u
+#define CIPHER_IV_SIZE 16u
+
 typedef struct CacheKey {
     void *hash_key;
     unsigned short hash_keylen;
@@ -28,8 +40,11 @@ typedef struct CacheKey {
 typedef struct {
     uint8_t *data;
     size_t data_sz;
-    bool written_to_disk, uses_encryption;
+    bool written_to_disk, being_written;
+    EncryptionMode encryption;
     off_t pos_in_cache_file;
+    monotonic_t queued_at;
+    // The key for XOR encryption or the IV for the stream ciphers
     uint8_t encryption_key[64];
 } CacheValue;
 
@@ -73,6 +88,19 @@ typedef struct Holes {
     off_t largest_hole_size;
 } Holes;
 
+typedef struct {
+    uint8_t key[MAX_KEY_SIZE];
+    unsigned short keylen;
+    uint8_t *data;
+    size_t data_sz;
+    off_t pos;
+    monotonic_t queued_at;
+    bool ok;
+    // data is written encrypted with these, it stays plaintext in RAM
+    EncryptionMode encryption;
+    uint8_t encryption_key[64];
+} BatchEntry;
+
 typedef struct {
     PyObject_HEAD
     char *cache_dir;
@@ -83,12 +111,27 @@ typedef struct {
     pthread_t write_thread;
     bool thread_started, lock_inited, loop_data_inited, shutting_down, fully_initialized;
     LoopData loop_data;
-    struct { CacheValue val; CacheKey key; } currently_writing;
+    // The dirty entries being written by the write thread, sorted by position
+    struct { BatchEntry items[MAX_BATCH_ENTRIES]; size_t count; unsigned generation; off_t reserve_from, reserve_to; } batch;
     cache_map map;
     Holes holes;
     unsigned long long total_size;
-    off_t end_of_data_offset;
-    bool needs_encryption;
+    off_t end_of_data_offset, allocated_size;
+    // Incremented whenever the cache is cleared
+    unsigned generation;
+    bool needs_encryption, defrag_active;
+    // The mode used for newly written entries and the key shared by the stream ciphers
+    EncryptionMode encryption_mode;
+    uint8_t cipher_key[CIPHER_KEY_SIZE];
+    EVP_CIPHER_CTX *cipher_ctx;
+    // used only by the write thread, for encrypting without the lock held
+    EVP_CIPHER_CTX *write_cipher_ctx;
+    struct {
+        unsigned long long entries_written, batches_written, write_calls, bytes_written;
+        unsigned long long defrag_steps, bytes_moved, full_defrags;
+        size_t max_queue_depth;
+        monotonic_t total_latency, max_latency;
+    } stats;
 } DiskCache;
 
 #define mutex(op) pthread_mutex_##op(&self->lock)
@@ -102,6 +145,7 @@ new_diskcache_object(PyTypeObject *type, PyObject UNUSED *args, PyObject UNUSED
         self->small_hole_threshold = 512;
         self->defrag_factor = 2;
         self->needs_encryption = true;
+        self->encryption_mode = AES_CTR_ENCRYPTION;
     }
     return (PyObject*) self;
 }
@@ -139,6 +183,41 @@ open_cache_file(const char *cache_path, bool *opened_securely) {
     return fd;
 }
 
+// Encryption {{{
+static const EVP_CIPHER*
+cipher_for_mode(EncryptionMode mode) {
+    switch (mode) {
+        case AES_CTR_ENCRYPTION: return EVP_aes_256_ctr();
+        case CHACHA20_ENCRYPTION: return EVP_chacha20();
+        default: return NULL;
+    }
+}
+
+static bool
+apply_stream_cipher(EVP_CIPHER_CTX *ctx, EncryptionMode mode, const uint8_t *key, const uint8_t *iv, uint8_t *data, size_t sz) {
+    // Both ciphers are used in counter mode so encryption and decryption are
+    // the same operation
+    const EVP_CIPHER *cipher = cipher_for_mode(mode);
+    if (!ctx || !cipher || 1 != EVP_EncryptInit_ex(ctx, cipher, NULL, key, iv)) return false;
+    int outl;
+    while (sz) {
+        const int chunk = (int)MIN(sz, (size_t)1024 * 1024 * 1024);
+        if (1 != EVP_EncryptUpdate(ctx, data, &outl, data, chunk)) return false;
+        data += chunk; sz -= chunk;
+    }
+    return true;
+}
+
+static bool
+decrypt_entry(DiskCache *self, const CacheValue *s, uint8_t *data, size_t sz) {
+    switch (s->encryption) {
+        case NO_ENCRYPTION: return true;
+        case XOR_ENCRYPTION: xor_data64(s->encryption_key, data, sz); return true;
+        default: return apply_stream_cipher(self->cipher_ctx, s->encryption, self->cipher_key, s->encryption_key, data, sz);
+    }
+}
+// }}}
+
 // Write loop {{{
 
 typedef struct {
@@ -275,24 +354,24 @@ remove_hole_from_maps(Holes *holes, Hole h) {
     }
 }
 
-static bool
+static off_t
 find_hole_to_use(DiskCache *self, const off_t required_sz) {
-    if (self->holes.largest_hole_size < required_sz) return false;
+    if (self->holes.largest_hole_size < required_sz) return -1;
     hole_size_map_itr i = vt_get(&self->holes.size_map, required_sz);
     if (vt_is_end(i)) {
         for (i = vt_first(&self->holes.size_map); !vt_is_end(i); i = vt_next(i)) {
             if (i.data->key >= required_sz) break;
         }
     }
-    if (vt_is_end(i)) return false;
+    if (vt_is_end(i)) return -1;
     Hole h = {.pos=i.data->val.positions[i.data->val.count-1], .size=i.data->key};
     remove_hole_from_maps_itr(&self->holes, h, i, i.data->val.count-1);
-    self->currently_writing.val.pos_in_cache_file = h.pos;
+    const off_t ans = h.pos;
     if (required_sz < h.size) {
         h.pos += required_sz; h.size -= required_sz;
         if (h.size > self->small_hole_threshold) add_hole_to_maps(&self->holes, h);
     }
-    return true;
+    return ans;
 }
 
 static inline bool
@@ -354,79 +433,181 @@ remove_from_disk(DiskCache *self, CacheValue *s) {
     }
 }
 
+static void
+free_batch(DiskCache *self) {
+    for (size_t i = 0; i < self->batch.count; i++) free(self->batch.items[i].data);
+    self->batch.count = 0; self->batch.reserve_from = 0; self->batch.reserve_to = 0;
+}
+
+static int
+cmp_batch_entries(const void *a_, const void *b_) {
+    const BatchEntry *a = a_, *b = b_;
+    return a->pos < b->pos ? -1 : (a->pos > b->pos ? 1 : 0);
+}
+
 static bool
-find_cache_entry_to_write(DiskCache *self) {
-    if (needs_defrag(self)) defrag(self);
+collect_batch(DiskCache *self) {
+    size_t batch_size = 0, queue_depth = 0;
     cache_map_for_loop(i) {
         CacheValue *s = i.data->val;
-        if (!s->written_to_disk) {
-            if (s->data) {
-                if (self->currently_writing.val.data) free(self->currently_writing.val.data);
-                self->currently_writing.val.data = s->data;
-                s->data = NULL;
-                self->currently_writing.val.data_sz = s->data_sz;
-                self->currently_writing.val.pos_in_cache_file = -1;
-                s->uses_encryption = false;
-                if (self->needs_encryption && secure_random_bytes(s->encryption_key, sizeof(s->encryption_key))) {
-                    xor_data64(s->encryption_key, self->currently_writing.val.data, s->data_sz);
-                    s->uses_encryption = true;
-                }
-                self->currently_writing.key.hash_keylen = MIN(i.data->key.hash_keylen, MAX_KEY_SIZE);
-                memcpy(self->currently_writing.key.hash_key, i.data->key.hash_key, self->currently_writing.key.hash_keylen);
-                find_hole_to_use(self, self->currently_writing.val.data_sz);
-                return true;
-            }
+        if (s->written_to_disk || s->being_written) continue;
+        if (!s->data || !s->data_sz) {
+            free(s->data); s->data = NULL;
             s->written_to_disk = true;
             s->pos_in_cache_file = 0;
             s->data_sz = 0;
+            continue;
+        }
+        queue_depth++;
+        if (self->batch.count >= MAX_BATCH_ENTRIES || (self->batch.count && batch_size + s->data_sz > MAX_BATCH_SIZE)) continue;
+        BatchEntry *e = self->batch.items + self->batch.count++;
+        e->data = s->data; s->data = NULL;
+        e->data_sz = s->data_sz;
+        e->queued_at = s->queued_at;
+        e->keylen = MIN(i.data->key.hash_keylen, MAX_KEY_SIZE);
+        memcpy(e->key, i.data->key.hash_key, e->keylen);
+        s->being_written = true;
+        // the entry is encrypted by the write thread without the lock held
+        s->encryption = NO_ENCRYPTION;
+        e->encryption = self->needs_encryption ? self->encryption_mode : NO_ENCRYPTION;
+        e->pos = find_hole_to_use(self, e->data_sz);
+        if (e->pos < 0) {
+            e->pos = self->end_of_data_offset;
+            self->end_of_data_offset += e->data_sz;
         }
+        batch_size += e->data_sz;
     }
-    return false;
+    if (!self->batch.count) return false;
+    // Sorted here, with the lock held, as reads scan the batch for in flight
+    // entries under the lock. write_batch() must not reorder it.
+    qsort(self->batch.items, self->batch.count, sizeof(self->batch.items[0]), cmp_batch_entries);
+    self->stats.max_queue_depth = MAX(self->stats.max_queue_depth, queue_depth);
+    self->batch.generation = self->generation;
+    if (self->end_of_data_offset > self->allocated_size) {
+        self->batch.reserve_from = self->allocated_size;
+        self->allocated_size = ((self->end_of_data_offset + FALLOCATE_CHUNK_SIZE - 1) / FALLOCATE_CHUNK_SIZE) * FALLOCATE_CHUNK_SIZE;
+        self->batch.reserve_to = self->allocated_size;
+    }
+    return true;
 }
 
 static bool
-write_dirty_entry(DiskCache *self) {
-    size_t left = self->currently_writing.val.data_sz;
-    uint8_t *p = self->currently_writing.val.data;
-    if (self->currently_writing.val.pos_in_cache_file < 0) {
-        self->currently_writing.val.pos_in_cache_file = self->end_of_data_offset;
-        if (self->currently_writing.val.pos_in_cache_file < 0) {
-            perror("Failed to seek in disk cache file");
-            return false;
-        }
-    }
-    off_t offset = self->currently_writing.val.pos_in_cache_file;
-    while (left > 0) {
-        ssize_t n = pwrite(self->cache_file_fd, p, left, offset);
+pwritev_all(int fd, struct iovec *iov, int iovcnt, off_t offset, unsigned long long *num_calls) {
+    while (iovcnt > 0) {
+        ssize_t n = pwritev(fd, iov, iovcnt, offset);
+        *num_calls += 1;
         if (n < 0) {
             if (errno == EINTR || errno == EAGAIN) continue;
             perror("Failed to write to disk-cache file");
-            self->currently_writing.val.pos_in_cache_file = -1;
             return false;
         }
         if (n == 0) {
             fprintf(stderr, "Failed to write to disk-cache file with zero return\n");
-            self->currently_writing.val.pos_in_cache_file = -1;
             return false;
         }
-        left -= n;
-        p += n;
         offset += n;
-        self->end_of_data_offset = MAX(self->end_of_data_offset, offset);
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) { n -= iov->iov_len; iov++; iovcnt--; }
+        if (iovcnt > 0) { iov->iov_base = (uint8_t*)iov->iov_base + n; iov->iov_len -= n; }
+    }
+    return true;
+}
+
+static bool
+write_encrypted_entry(DiskCache *self, BatchEntry *e) {
+    // Called without the lock held. The entry is encrypted in chunks as it is
+    // written, so e->data, which reads of in flight entries use, stays
+    // plaintext and no copy of the whole entry is needed.
+    if (!secure_random_bytes(e->encryption_key, sizeof(e->encryption_key))) return false;
+    if (e->encryption != XOR_ENCRYPTION) {
+        // the first four bytes of the ChaCha20 IV are the block counter, the rest is the nonce
+        if (e->encryption == CHACHA20_ENCRYPTION) memset(e->encryption_key, 0, 4);
+        const EVP_CIPHER *cipher = cipher_for_mode(e->encryption);
+        if (!self->write_cipher_ctx || !cipher || 1 != EVP_EncryptInit_ex(self->write_cipher_ctx, cipher, NULL, self->cipher_key, e->encryption_key)) {
+            log_error("Failed to encrypt disk cache entry, falling back to XOR");
+            if (!secure_random_bytes(e->encryption_key, sizeof(e->encryption_key))) return false;
+            e->encryption = XOR_ENCRYPTION;
+        }
+    }
+    // a multiple of 64 so that the XOR key stays aligned across chunks
+    uint8_t buf[64 * 1024];
+    for (size_t pos = 0; pos < e->data_sz;) {
+        const size_t sz = MIN(sizeof(buf), e->data_sz - pos);
+        if (e->encryption == XOR_ENCRYPTION) {
+            memcpy(buf, e->data + pos, sz);
+            xor_data64(e->encryption_key, buf, sz);
+        } else {
+            int outl;
+            if (1 != EVP_EncryptUpdate(self->write_cipher_ctx, buf, &outl, e->data + pos, (int)sz)) return false;
+        }
+        struct iovec iov = {.iov_base=buf, .iov_len=sz};
+        if (!pwritev_all(self->cache_file_fd, &iov, 1, e->pos + pos, &self->stats.write_calls)) return false;
+        pos += sz;
     }
     return true;
 }
 
 static void
-retire_currently_writing(DiskCache *self) {
-    cache_map_itr i = vt_get(&self->map, self->currently_writing.key);
-    if (!vt_is_end(i)) {
-        i.data->val->written_to_disk = true;
-        i.data->val->pos_in_cache_file = self->currently_writing.val.pos_in_cache_file;
+write_batch(DiskCache *self) {
+    // Called without the lock held. Only this thread ever writes to the cache
+    // file and the positions in the batch were reserved by collect_batch() so
+    // no other thread can touch them.
+#ifdef FALLOC_FL_KEEP_SIZE
+    // Reserve space ahead of time so that appending to the cache file does not
+    // fragment it on disk. Failure is harmless, not all filesystems support it.
+    if (self->batch.reserve_to > self->batch.reserve_from) {
+        while (fallocate(self->cache_file_fd, FALLOC_FL_KEEP_SIZE, self->batch.reserve_from, self->batch.reserve_to - self->batch.reserve_from) != 0 && errno == EINTR);
+    }
+#endif
+    BatchEntry *items = self->batch.items;
+    const size_t count = self->batch.count;
+    struct iovec iov[MAX_BATCH_ENTRIES];
+    for (size_t start = 0; start < count;) {
+        if (items[start].encryption != NO_ENCRYPTION) {
+            items[start].ok = write_encrypted_entry(self, items + start);
+            start++;
+            continue;
+        }
+        size_t end = start + 1;
+        while (end < count && items[end].encryption == NO_ENCRYPTION && items[end].pos == items[end-1].pos + (off_t)items[end-1].data_sz) end++;
+        for (size_t i = start; i < end; i++) { iov[i - start].iov_base = items[i].data; iov[i - start].iov_len = items[i].data_sz; }
+        bool ok = pwritev_all(self->cache_file_fd, iov, end - start, items[start].pos, &self->stats.write_calls);
+        for (size_t i = start; i < end; i++) items[i].ok = ok;
+        start = end;
+    }
+}
+
+static void
+retire_batch(DiskCache *self) {
+    const monotonic_t now = monotonic();
+    const bool cleared = self->batch.generation != self->generation;
+    for (size_t i = 0; i < self->batch.count && !cleared; i++) {
+        BatchEntry *e = self->batch.items + i;
+        cache_map_itr itr = vt_get(&self->map, (CacheKey){.hash_key=e->key, .hash_keylen=e->keylen});
+        CacheValue *s = vt_is_end(itr) ? NULL : itr.data->val;
+        if (s && s->being_written) {
+            s->being_written = false;
+            s->written_to_disk = true;
+            if (e->ok) {
+                s->pos_in_cache_file = e->pos;
+                s->encryption = e->encryption;
+                memcpy(s->encryption_key, e->encryption_key, sizeof(s->encryption_key));
+                self->stats.entries_written++;
+                self->stats.bytes_written += e->data_sz;
+                const monotonic_t latency = now - e->queued_at;
+                self->stats.total_latency += latency;
+                self->stats.max_latency = MAX(self->stats.max_latency, latency);
+                continue;
+            }
+            // Keep the data in RAM as it could not be written
+            s->pos_in_cache_file = -1;
+            if (!s->data) { s->data = e->data; e->data = NULL; }
+        }
+        // The write failed or the entry was removed or replaced while being written
+        add_hole(self, e->pos, e->data_sz);
     }
-    free(self->currently_writing.val.data);
-    self->currently_writing.val.data = NULL;
-    self->currently_writing.val.data_sz = 0;
+    if (!cleared) self->stats.batches_written++;
+    free_batch(self);
+    self->defrag_active = needs_defrag(self);
 }
 
 static int
@@ -435,12 +616,127 @@ clear_disk_cache_with_lock_held(DiskCache *self) {
     cleanup_holes(&self->holes);
     self->total_size = 0;
     self->end_of_data_offset = 0;
+    self->allocated_size = 0;
+    self->generation++;
     if (self->cache_file_fd > -1) {
         if (ftruncate(self->cache_file_fd, 0) == -1) return errno;
     }
     return 0;
 }
 
+// Incremental defrag {{{
+// Rather than copying the whole cache file in one go, defrag is done in small
+// steps in between writes, each step moving at most one entry towards the
+// start of the file and shrinking the file when its tail becomes free.
+
+static bool
+copy_in_cache_file(int fd, off_t src, off_t dest, size_t sz) {
+    uint8_t buf[64 * 1024];
+    while (sz) {
+        ssize_t n = pread(fd, buf, MIN(sz, sizeof(buf)), src);
+        if (n < 0) { if (errno == EINTR || errno == EAGAIN) continue; return false; }
+        if (n == 0) return false;
+        for (ssize_t done = 0; done < n;) {
+            ssize_t w = pwrite(fd, buf + done, n - done, dest + done);
+            if (w < 0) { if (errno == EINTR || errno == EAGAIN) continue; return false; }
+            if (w == 0) return false;
+            done += w;
+        }
+        src += n; dest += n; sz -= n;
+    }
+    return true;
+}
+
+static bool
+trim_trailing_hole(DiskCache *self) {
+    hole_pos_map_itr i = vt_get(&self->holes.end_pos_map, self->end_of_data_offset);
+    if (vt_is_end(i)) return false;
+    Hole h = {.pos=i.data->key - i.data->val, .size=i.data->val};
+    remove_hole_from_maps(&self->holes, h);
+    update_largest_hole_size(&self->holes);
+    self->end_of_data_offset = h.pos;
+    if (ftruncate(self->cache_file_fd, self->end_of_data_offset) == 0) self->allocated_size = MIN(self->allocated_size, self->end_of_data_offset);
+    return true;
+}
+
+static bool
+move_entry(DiskCache *self, CacheKey key, CacheValue *s, off_t dest) {
+    // The destination never overlaps the entry, so the copy is done with the
+    // lock released as concurrent reads of the entry remain valid. Returns
+    // false if the copy failed or the entry was changed in the meantime.
+    const off_t src = s->pos_in_cache_file; const size_t sz = s->data_sz;
+    const unsigned generation = self->generation;
+    uint8_t keybuf[MAX_KEY_SIZE];
+    key.hash_keylen = MIN(key.hash_keylen, MAX_KEY_SIZE);
+    memcpy(keybuf, key.hash_key, key.hash_keylen); key.hash_key = keybuf;
+    mutex(unlock);
+    bool ok = copy_in_cache_file(self->cache_file_fd, src, dest, sz);
+    mutex(lock);
+    if (generation != self->generation) {
+        // The cache was cleared during the copy, which may have regrown the
+        // truncated file with stale data. Only this thread writes to the file
+        // so nothing has been written to it since the clear.
+        if (ftruncate(self->cache_file_fd, self->end_of_data_offset) == 0) self->allocated_size = MIN(self->allocated_size, self->end_of_data_offset);
+        return false;
+    }
+    if (!ok) return false;
+    cache_map_itr i = vt_get(&self->map, key);
+    if (vt_is_end(i)) return false;
+    s = i.data->val;
+    if (!s->written_to_disk || s->pos_in_cache_file != src || s->data_sz != sz) return false;
+    s->pos_in_cache_file = dest;
+    self->stats.bytes_moved += sz;
+    return true;
+}
+
+static bool
+defrag_step(DiskCache *self) {
+    // Must be called with the lock held and no batch in flight. Returns true
+    // if there is more defrag work to do.
+    if (!needs_defrag(self)) return false;
+    self->stats.defrag_steps++;
+    if (trim_trailing_hole(self)) return needs_defrag(self);
+    CacheValue *tail = NULL, *after_hole = NULL;
+    CacheKey tail_key = {0}, after_hole_key = {0};
+    Hole first_hole = {.pos=-1};
+    hole_pos_map_for_loop(h) {
+        if (first_hole.pos < 0 || h.data->key < first_hole.pos) { first_hole.pos = h.data->key; first_hole.size = h.data->val; }
+    }
+    cache_map_for_loop(i) {
+        CacheValue *s = i.data->val;
+        if (!s->written_to_disk || s->pos_in_cache_file < 0 || !s->data_sz) continue;
+        if (s->pos_in_cache_file + (off_t)s->data_sz == self->end_of_data_offset) { tail = s; tail_key = i.data->key; }
+        if (first_hole.pos > -1 && s->pos_in_cache_file == first_hole.pos + first_hole.size) { after_hole = s; after_hole_key = i.data->key; }
+    }
+    CacheValue *s = NULL; CacheKey key; off_t dest = -1;
+    if (tail && (dest = find_hole_to_use(self, tail->data_sz)) > -1) {
+        // Move the last entry into a hole that can hold it, shrinking the file
+        s = tail; key = tail_key;
+    } else if (after_hole) {
+        // Move the entry after the first hole to the end of the file so that
+        // the hole grows, a later step will move it back into a hole.
+        s = after_hole; key = after_hole_key;
+        dest = self->end_of_data_offset;
+        self->end_of_data_offset += s->data_sz;
+    }
+    if (s) {
+        const off_t src = s->pos_in_cache_file, sz = s->data_sz;
+        const unsigned generation = self->generation;
+        if (move_entry(self, key, s, dest)) add_hole(self, src, sz);
+        // after a clear the holes belong to the new generation
+        else if (generation == self->generation) add_hole(self, dest, sz);
+        trim_trailing_hole(self);
+        return needs_defrag(self);
+    }
+    // The remaining free space is in holes too small to be tracked, fall back
+    // to copying everything into a new file
+    self->stats.full_defrags++;
+    defrag(self);
+    self->allocated_size = 0;
+    return false;
+}
+// }}}
+
 static void*
 write_loop(void *data) {
     DiskCache *self = (DiskCache*)data;
@@ -448,19 +744,22 @@ write_loop(void *data) {
     struct pollfd fds[1] = {0};
     fds[0].fd = self->loop_data.wakeup_read_fd;
     fds[0].events = POLLIN;
-    bool found_dirty_entry = false;
 
     while (!self->shutting_down) {
         mutex(lock);
-        found_dirty_entry = find_cache_entry_to_write(self);
+        bool found_dirty_entries = collect_batch(self), more_defrag_work = false;
         size_t count = vt_size(&self->map);
+        if (!found_dirty_entries && count) more_defrag_work = defrag_step(self);
+        self->defrag_active = found_dirty_entries ? needs_defrag(self) : more_defrag_work;
         mutex(unlock);
-        if (found_dirty_entry) {
-            write_dirty_entry(self);
+        if (found_dirty_entries) {
+            write_batch(self);
             mutex(lock);
-            retire_currently_writing(self);
+            retire_batch(self);
             mutex(unlock);
             continue;
+        } else if (more_defrag_work) {
+            continue;
         } else if (!count) {
             mutex(lock);
             count = vt_size(&self->map);
@@ -484,11 +783,6 @@ ensure_state(DiskCache *self) {
         if (!init_loop_data(&self->loop_data, 0)) { PyErr_SetFromErrno(PyExc_OSError); return false; }
         self->loop_data_inited = true;
     }
-    if (!self->currently_writing.key.hash_key) {
-        self->currently_writing.key.hash_key = malloc(MAX_KEY_SIZE);
-        if (!self->currently_writing.key.hash_key) { PyErr_NoMemory(); return false; }
-    }
-
     if (!self->lock_inited) {
         if ((ret = pthread_mutex_init(&self->lock, NULL)) != 0) {
             PyErr_Format(PyExc_OSError, "Failed to create disk cache lock mutex: %s", strerror(ret));
@@ -530,6 +824,11 @@ ensure_state(DiskCache *self) {
         }
         self->needs_encryption = !opened_securely;
     }
+    if (!self->cipher_ctx) {
+        if (!secure_random_bytes(self->cipher_key, sizeof(self->cipher_key))) { PyErr_SetFromErrno(PyExc_OSError); return false; }
+        if (!(self->cipher_ctx = EVP_CIPHER_CTX_new())) { PyErr_NoMemory(); return false; }
+    }
+    if (!self->write_cipher_ctx && !(self->write_cipher_ctx = EVP_CIPHER_CTX_new())) { PyErr_NoMemory(); return false; }
     vt_init(&self->map); vt_init(&self->holes.pos_map); vt_init(&self->holes.size_map); vt_init(&self->holes.end_pos_map);
     self->fully_initialized = true;
     return true;
@@ -548,9 +847,6 @@ dealloc(DiskCache* self) {
         pthread_join(self->write_thread, NULL);
         self->thread_started = false;
     }
-    if (self->currently_writing.key.hash_key) {
-        free(self->currently_writing.key.hash_key); self->currently_writing.key.hash_key = NULL;
-    }
     if (self->lock_inited) {
         pthread_mutex_destroy(&self->lock);
         self->lock_inited = false;
@@ -564,7 +860,10 @@ dealloc(DiskCache* self) {
         safe_close(self->cache_file_fd, __FILE__, __LINE__);
         self->cache_file_fd = -1;
     }
-    if (self->currently_writing.val.data) free(self->currently_writing.val.data);
+    free_batch(self);
+    if (self->cipher_ctx) { EVP_CIPHER_CTX_free(self->cipher_ctx); self->cipher_ctx = NULL; }
+    if (self->write_cipher_ctx) { EVP_CIPHER_CTX_free(self->write_cipher_ctx); self->write_cipher_ctx = NULL; }
+    OPENSSL_cleanse(self->cipher_key, sizeof(self->cipher_key));
     free(self->cache_dir); self->cache_dir = NULL;
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -598,11 +897,13 @@ add_to_disk_cache(PyObject *self_, const void *key, size_t key_sz, const void *d
         if (vt_is_end(vt_insert(&self->map, k, s))) { PyErr_NoMemory(); goto end; }
     } else {
         s = i.data->val;
+        s->being_written = false;
         remove_from_disk(self, s);
         self->total_size -= MIN(self->total_size, s->data_sz);
         if (s->data) free(s->data);
     }
     s->data = copied_data; s->data_sz = data_sz; copied_data = NULL;
+    s->queued_at = monotonic();
     self->total_size += s->data_sz;
 end:
     mutex(unlock);
@@ -697,16 +998,20 @@ read_from_disk_cache(PyObject *self_, const void *key, size_t key_sz, void*(allo
     data = allocator(allocator_data, s->data_sz);
     if (!data) { PyErr_NoMemory(); goto end; }
 
-    if (s->data) { memcpy(data, s->data, s->data_sz); }
-    else if (self->currently_writing.val.data && self->currently_writing.key.hash_key && keys_are_equal(self->currently_writing.key, k)) {
-        memcpy(data, self->currently_writing.val.data, s->data_sz);
-        if (s->uses_encryption) xor_data64(s->encryption_key, data, s->data_sz);
+    const BatchEntry *in_flight = NULL;
+    if (s->being_written) {
+        for (size_t x = 0; x < self->batch.count && !in_flight; x++) {
+            const BatchEntry *e = self->batch.items + x;
+            if (e->keylen == key_sz && memcmp(e->key, key, key_sz) == 0) in_flight = e;
+        }
     }
+    if (s->data) { memcpy(data, s->data, s->data_sz); }
+    else if (in_flight) { memcpy(data, in_flight->data, s->data_sz); }
     else {
         read_from_cache_entry(self, s, data);
-        if (s->uses_encryption) xor_data64(s->encryption_key, data, s->data_sz);
+        if (!PyErr_Occurred() && !decrypt_entry(self, s, data, s->data_sz)) PyErr_SetString(PyExc_OSError, "Failed to decrypt disk cache entry");
     }
-    if (store_in_ram && !s->data && s->data_sz) {
+    if (store_in_ram && !s->data && s->data_sz && !PyErr_Occurred()) {
         void *copy = malloc(s->data_sz);
         if (copy) {
             memcpy(copy, data, s->data_sz); s->data = copy;
@@ -740,8 +1045,8 @@ disk_cache_wait_for_write(PyObject *self_, monotonic_t timeout) {
     if (!ensure_state(self)) return false;
     monotonic_t end_at = monotonic() + timeout;
     while (!timeout || monotonic() <= end_at) {
-        bool pending = false;
         mutex(lock);
+        bool pending = self->defrag_active;
         cache_map_for_loop(i) {
             if (!i.data->val->written_to_disk) {
                 pending = true;
@@ -827,6 +1132,24 @@ holes(PyObject *self_, PyObject *args UNUSED) {
     return ans;
 }
 
+static PyObject*
+stats(PyObject *self_, PyObject *args UNUSED) {
+    DiskCache *self = (DiskCache*)self_;
+    if (!ensure_state(self)) return NULL;
+    mutex(lock);
+    size_t queue_depth = 0;
+    cache_map_for_loop(i) { if (!i.data->val->written_to_disk) queue_depth++; }
+    PyObject *ans = Py_BuildValue("{sn sn sK sK sK sK sd sd sK sK sK}",
+        "queue_depth", (Py_ssize_t)queue_depth, "max_queue_depth", (Py_ssize_t)self->stats.max_queue_depth,
+        "entries_written", self->stats.entries_written, "batches_written", self->stats.batches_written,
+        "write_calls", self->stats.write_calls, "bytes_written", self->stats.bytes_written,
+        "mean_write_latency", self->stats.entries_written ? monotonic_t_to_s_double(self->stats.total_latency) / self->stats.entries_written : 0.,
+        "max_write_latency", monotonic_t_to_s_double(self->stats.max_latency),
+        "defrag_steps", self->stats.defrag_steps, "bytes_moved", self->stats.bytes_moved, "full_defrags", self->stats.full_defrags
+    );
+    mutex(unlock);
+    return ans;
+}
 
 static PyObject*
 add(PyObject *self, PyObject *args) {
@@ -910,10 +1233,44 @@ static PyMethodDef methods[] = {
     {"end_of_data_offset", end_of_data_offset, METH_NOARGS, NULL},
     {"clear", clear, METH_NOARGS, NULL},
     {"holes", holes, METH_NOARGS, NULL},
+    {"stats", stats, METH_NOARGS, NULL},
 
     {NULL}  /* Sentinel */
 };
 
+static const char* encryption_mode_names[] = {"none", "xor", "aes-ctr", "chacha20"};
+
+static PyObject*
+encryption_get(DiskCache *self, void *closure UNUSED) {
+    return PyUnicode_FromString(encryption_mode_names[self->encryption_mode]);
+}
+
+static int
+encryption_set(DiskCache *self, PyObject *val, void *closure UNUSED) {
+    if (!val || !PyUnicode_Check(val)) { PyErr_SetString(PyExc_TypeError, "encryption must be a string"); return -1; }
+    const char *q = PyUnicode_AsUTF8(val);
+    for (unsigned i = XOR_ENCRYPTION; i < arraysz(encryption_mode_names); i++) {
+        if (strcmp(q, encryption_mode_names[i]) == 0) {
+            // the lock is created and needs_encryption is set by ensure_state()
+            if (!ensure_state(self)) return -1;
+            mutex(lock);
+            self->encryption_mode = i;
+            // an explicitly chosen mode is used even when the cache file is
+            // not visible in the filesystem
+            self->needs_encryption = true;
+            mutex(unlock);
+            return 0;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "Unknown disk cache encryption mode: %s", q);
+    return -1;
+}
+
+static PyGetSetDef getsetters[] = {
+    {"encryption", (getter)encryption_get, (setter)encryption_set, "The encryption used for newly written entries: xor, aes-ctr or chacha20. Setting it enables encryption even for anonymous cache files.", NULL},
+    {NULL}
+};
+
 static PyMemberDef members[] = {
     {"total_size", T_ULONGLONG, offsetof(DiskCache, total_size), READONLY, "total_size"},
     {"small_hole_threshold", T_PYSSIZET, offsetof(DiskCache, small_hole_threshold), 0, "small_hole_threshold"},
@@ -931,9 +1288,44 @@ PyTypeObject DiskCache_Type = {
     .tp_doc = "A disk based secure cache",
     .tp_methods = methods,
     .tp_members = members,
+    .tp_getset = getsetters,
     .tp_new = new_diskcache_object,
 };
 
+static PyObject*
+benchmark_disk_cache_encryption(PyObject *self UNUSED, PyObject *args) {
+    const char *mode_name; unsigned long size, iterations;
+    PA("skk", &mode_name, &size, &iterations);
+    EncryptionMode mode = NO_ENCRYPTION;
+    for (unsigned i = XOR_ENCRYPTION; i < arraysz(encryption_mode_names); i++) {
+        if (strcmp(mode_name, encryption_mode_names[i]) == 0) mode = i;
+    }
+    if (mode == NO_ENCRYPTION) { PyErr_Format(PyExc_ValueError, "Unknown disk cache encryption mode: %s", mode_name); return NULL; }
+    RAII_ALLOC(uint8_t, data, calloc(1, MAX(1u, size)));
+    if (!data) return PyErr_NoMemory();
+    uint8_t key[64] = {0}, iv[64] = {0};
+    if (!secure_random_bytes(key, sizeof(key)) || !secure_random_bytes(iv, sizeof(iv))) return PyErr_SetFromErrno(PyExc_OSError);
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return PyErr_NoMemory();
+    bool ok = true;
+    monotonic_t start = monotonic();
+    for (unsigned long i = 0; i < iterations && ok; i++) {
+        if (mode == XOR_ENCRYPTION) xor_data64(key, data, size);
+        else ok = apply_stream_cipher(ctx, mode, key, iv, data, size);
+    }
+    monotonic_t elapsed = monotonic() - start;
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) { PyErr_SetString(PyExc_OSError, "Failed to encrypt data"); return NULL; }
+    return PyFloat_FromDouble(monotonic_t_to_s_double(elapsed));
+}
+
+static PyMethodDef module_methods[] = {
+    {"benchmark_disk_cache_encryption", benchmark_disk_cache_encryption, METH_VARARGS, NULL},
+    {NULL, NULL, 0, NULL}  /* Sentinel */
+};
+
+#undef EXTRA_INIT
+#define EXTRA_INIT if (PyModule_AddFunctions(module, module_methods) != 0) return 0;
 INIT_TYPE(DiskCache)
 PyObject* create_disk_cache(void) { return new_diskcache_object(&DiskCache_Type, NULL, NULL); }
 // }}}
@@ -141,6 +141,9 @@ def main() -> None:
         if first_arg.startswith('+'):
             namespaced(['+', first_arg[1:]] + sys.argv[2:])
         else:
+            if 'KITTY_PROFILE_STARTUP' in os.environ:
+                from kitty.startup_profiler import install
+                install()
             from kitty.main import main as kitty_main
             kitty_main()
     else:
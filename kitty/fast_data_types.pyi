@@ -61,6 +61,7 @@ IMPERATIVE_CLOSE_REQUESTED: int
 CLOSE_BEING_CONFIRMED: int
 ERROR_PREFIX: str
 GLSL_VERSION: int
+GRAPHICS_BATCH_SIZE: int
 # start glfw functional keys (auto generated by gen-key-constants.py do not edit)
 GLFW_FKEY_ESCAPE: int
 GLFW_FKEY_ENTER: int
@@ -453,6 +454,8 @@ def fc_match_postscript_name(
 
 def add_font_file(path: str) -> bool: ...
 def set_builtin_nerd_font(path: str) -> Union[CoreTextFont, FontConfigPattern]: ...
+def fallback_font_cache_info() -> Dict[str, int]: ...
+def font_cache_generation() -> int: ...
 
 
 class FeatureData(TypedDict):
@@ -1161,6 +1164,16 @@ def test_render_line(line: Line) -> None:
     pass
 
 
+def test_cell_data_row_extents(screen: Screen) -> Tuple[Tuple[int, int], ...]:
+    pass
+
+
+def test_box_sprite_cache(
+    cache_dir: str, cell_width: int, cell_height: int, box_drawing_scale: Tuple[float, float, float, float]
+) -> Tuple[bool, str, bytes]:
+    pass
+
+
 def sprite_map_set_limits(w: int, h: int) -> None:
     pass
 
@@ -1259,6 +1272,9 @@ class Screen:
     def cursor_at_prompt(self) -> bool:
         pass
 
+    def finish_graphics_decodes(self, wait: bool) -> bool:
+        pass
+
     def ignore_bells_for(self, duration: float = 1) -> None:
         pass
 
@@ -1532,6 +1548,8 @@ def spawn(
     kitten_exe: str,
     forward_stdio: bool,
     pass_fds: tuple[int, ...],
+    spawn_helper: str = '',
+    zygote_fd: int = -1,
 ) -> int:
     pass
 
@@ -1622,7 +1640,23 @@ def get_click_interval() -> float:
     pass
 
 
-def send_data_to_peer(peer_id: int, data: Union[str, bytes], is_async_response: bool = False) -> None:
+def send_data_to_peer(peer_id: int, data: Union[str, bytes, tuple[bytes, Union[str, bytes]]], is_async_response: bool = False) -> None:
+    pass
+
+
+def peer_pending_output_size(peer_id: int) -> int:
+    pass
+
+
+def push_data_to_peer(peer_id: int, data: bytes) -> None:
+    pass
+
+
+def add_test_peer() -> tuple[int, int]:
+    pass
+
+
+def test_peer_state(peer_id: int, action: str = '') -> Optional[dict[str, Any]]:
     pass
 
 
@@ -11,6 +11,7 @@
 #include <fontconfig/fontconfig.h>
 #include <dlfcn.h>
 #include "freetype_render_ui_text.h"
+#include <sys/stat.h>
 #ifndef FC_COLOR
 #define FC_COLOR "color"
 #endif
@@ -43,6 +44,16 @@ static struct {PyObject *face, *descriptor;} builtin_nerd_font = {0};
 #define FcPatternGetBool dynamically_loaded_fc_symbol.PatternGetBool
 #define FcPatternAddCharSet dynamically_loaded_fc_symbol.PatternAddCharSet
 #define FcConfigAppFontAddFile dynamically_loaded_fc_symbol.ConfigAppFontAddFile
+#define FcPatternFilter dynamically_loaded_fc_symbol.PatternFilter
+#define FcNameParse dynamically_loaded_fc_symbol.NameParse
+#define FcNameUnparse dynamically_loaded_fc_symbol.NameUnparse
+#define FcStrFree dynamically_loaded_fc_symbol.StrFree
+#define FcGetVersion dynamically_loaded_fc_symbol.GetVersion
+#define FcConfigGetConfigFiles dynamically_loaded_fc_symbol.ConfigGetConfigFiles
+#define FcConfigGetFontDirs dynamically_loaded_fc_symbol.ConfigGetFontDirs
+#define FcConfigGetFonts dynamically_loaded_fc_symbol.ConfigGetFonts
+#define FcStrListNext dynamically_loaded_fc_symbol.StrListNext
+#define FcStrListDone dynamically_loaded_fc_symbol.StrListDone
 
 static struct {
     FcBool(*Init)(void);
@@ -68,6 +79,16 @@ static struct {
     FcResult (*PatternGetBool) (const FcPattern *p, const char *object, int n, FcBool *b);
     FcBool (*PatternAddCharSet) (FcPattern *p, const char *object, const FcCharSet *c);
     FcBool (*ConfigAppFontAddFile) (FcConfig *config, const FcChar8 *file);
+    FcPattern * (*PatternFilter) (FcPattern *p, const FcObjectSet *os);
+    FcPattern * (*NameParse) (const FcChar8 *name);
+    FcChar8 * (*NameUnparse) (FcPattern *pat);
+    void (*StrFree) (FcChar8 *s);
+    int (*GetVersion) (void);
+    FcStrList * (*ConfigGetConfigFiles) (FcConfig *config);
+    FcStrList * (*ConfigGetFontDirs) (FcConfig *config);
+    FcFontSet * (*ConfigGetFonts) (FcConfig *config, FcSetName set);
+    FcChar8 * (*StrListNext) (FcStrList *list);
+    void (*StrListDone) (FcStrList *list);
 } dynamically_loaded_fc_symbol = {0};
 #define LOAD_FUNC(name) {\
     *(void **) (&dynamically_loaded_fc_symbol.name) = dlsym(libfontconfig_handle, "Fc" #name); \
@@ -119,6 +140,16 @@ load_fontconfig_lib(void) {
         LOAD_FUNC(PatternGetBool);
         LOAD_FUNC(PatternAddCharSet);
         LOAD_FUNC(ConfigAppFontAddFile);
+        LOAD_FUNC(PatternFilter);
+        LOAD_FUNC(NameParse);
+        LOAD_FUNC(NameUnparse);
+        LOAD_FUNC(StrFree);
+        LOAD_FUNC(GetVersion);
+        LOAD_FUNC(ConfigGetConfigFiles);
+        LOAD_FUNC(ConfigGetFontDirs);
+        LOAD_FUNC(ConfigGetFonts);
+        LOAD_FUNC(StrListNext);
+        LOAD_FUNC(StrListDone);
 }
 #undef LOAD_FUNC
 
@@ -131,9 +162,235 @@ ensure_initialized(void) {
     }
 }
 
+// Fallback cache {{{
+// Remembers the outcome of fallback font resolution for a set of codepoints
+// and style across font groups and, via a file in the cache directory, across
+// kitty instances. Failed lookups are remembered as well since they are the most
+// expensive, fontconfig has to consider every installed font for them. The
+// same file also stores the result of specializing the descriptors of the
+// configured fonts, so that common launches need no fontconfig queries at all.
+// It is ignored when the fontconfig configuration or installed fonts change.
+
+#define NAME fallback_cache_map_t
+#define KEY_TY const char*
+#define VAL_TY const char*
+static void free_const(const void* x) { free((void*)x); }
+#define KEY_DTOR_FN free_const
+#define VAL_DTOR_FN free_const
+#include "kitty-verstable.h"
+
+// Bump this whenever the format of cached entries changes
+#define FALLBACK_CACHE_VERSION 1u
+// Values are one of these followed, for FALLBACK_FONT_PATTERN, by a serialized
+// fontconfig pattern
+#define NO_FALLBACK_FONT '-'
+#define BUILTIN_NERD_FONT '*'
+#define FALLBACK_FONT_PATTERN '='
+
+static struct {
+    fallback_cache_map_t map;
+    char *path;
+    uint64_t generation;
+    unsigned long long hits, misses;
+    bool map_initialized, loaded, dirty;
+} fallback_cache = {0};
+
+static uint64_t
+hash_path_list(FcStrList *list, uint64_t h) {
+    if (!list) return h;
+    FcChar8 *path; struct stat st;
+    while ((path = FcStrListNext(list))) {
+        h = XXH3_64bits_withSeed(path, strlen((const char*)path), h);
+        if (stat((const char*)path, &st) == 0) {
+            const int64_t stamp[3] = {st.st_mtime, st.st_size, st.st_ino};
+            h = XXH3_64bits_withSeed(stamp, sizeof(stamp), h);
+        }
+    }
+    FcStrListDone(list);
+    return h;
+}
+
+// A fingerprint of the fontconfig configuration and installed fonts, it changes
+// whenever fontconfig would have to rebuild its own caches.
+static uint64_t
+fontconfig_generation(void) {
+    const int version = FcGetVersion();
+    uint64_t h = XXH3_64bits_withSeed(&version, sizeof(version), FALLBACK_CACHE_VERSION);
+    h = hash_path_list(FcConfigGetConfigFiles(NULL), h);
+    h = hash_path_list(FcConfigGetFontDirs(NULL), h);
+    FcFontSet *system = FcConfigGetFonts(NULL, FcSetSystem), *application = FcConfigGetFonts(NULL, FcSetApplication);
+    const int counts[2] = {system ? system->nfont : 0, application ? application->nfont : 0};
+    return XXH3_64bits_withSeed(counts, sizeof(counts), h);
+}
+
+static char*
+fallback_cache_path(void) {
+    RAII_PyObject(kc, PyImport_ImportModule("kitty.constants"));
+    if (!kc) { PyErr_Clear(); return NULL; }
+    RAII_PyObject(base, PyObject_CallMethod(kc, "cache_dir", NULL));
+    // different kitty versions can resolve fallback fonts differently
+    RAII_PyObject(version, PyObject_GetAttrString(kc, "str_version"));
+    if (!base || !version || !PyUnicode_Check(base) || !PyUnicode_Check(version)) { PyErr_Clear(); return NULL; }
+    size_t sz = strlen(PyUnicode_AsUTF8(base)) + strlen(PyUnicode_AsUTF8(version)) + 64;
+    char *ans = malloc(sz);
+    if (ans) snprintf(ans, sz, "%s/fallback-fonts-v%u-%s", PyUnicode_AsUTF8(base), FALLBACK_CACHE_VERSION, PyUnicode_AsUTF8(version));
+    return ans;
+}
+
+// Adds entries from the on-disk cache that are not already present, returns
+// false if the file is missing or was created for a different generation.
+static bool
+merge_fallback_cache_from_disk(void) {
+    if (!fallback_cache.path) return false;
+    FILE *f = fopen(fallback_cache.path, "re");
+    if (!f) return false;
+    char *line = NULL; size_t cap = 0; ssize_t n;
+    unsigned long long generation;
+    bool ok = (n = getline(&line, &cap, f)) > 0 && sscanf(line, "kitty-fallback-fonts %llx", &generation) == 1 && generation == fallback_cache.generation;
+    while (ok && (n = getline(&line, &cap, f)) > 0) {
+        if (line[n-1] == '\n') line[--n] = 0;
+        char *sep = strchr(line, '\t');
+        if (!sep || !sep[1]) continue;
+        *sep = 0;
+        if (!vt_is_end(vt_get(&fallback_cache.map, line))) continue;
+        const char *key = strdup(line), *val = strdup(sep + 1);
+        if (!key || !val || vt_is_end(vt_insert(&fallback_cache.map, key, val))) { free((void*)key); free((void*)val); break; }
+    }
+    free(line);
+    fclose(f);
+    return ok;
+}
+
+static void
+load_fallback_cache(void) {
+    if (!fallback_cache.map_initialized) { vt_init(&fallback_cache.map); fallback_cache.map_initialized = true; }
+    fallback_cache.loaded = true;
+    fallback_cache.generation = fontconfig_generation();
+    if (!fallback_cache.path) fallback_cache.path = fallback_cache_path();
+    // a stale cache file is replaced on exit even if no new lookups are made
+    if (!merge_fallback_cache_from_disk()) fallback_cache.dirty = true;
+}
+
+static void
+save_fallback_cache(void) {
+    if (!fallback_cache.dirty || !fallback_cache.path) return;
+    fallback_cache.dirty = false;
+    // pick up entries written by other kitty instances since we loaded
+    merge_fallback_cache_from_disk();
+    size_t sz = strlen(fallback_cache.path) + 16;
+    RAII_ALLOC(char, tpath, malloc(sz));
+    if (!tpath) return;
+    snprintf(tpath, sz, "%s.XXXXXX", fallback_cache.path);
+    int fd = mkstemp(tpath);
+    if (fd < 0) return;
+    FILE *f = fdopen(fd, "w");
+    if (!f) { close(fd); unlink(tpath); return; }
+    bool ok = fprintf(f, "kitty-fallback-fonts %llx\n", (unsigned long long)fallback_cache.generation) > 0;
+    vt_create_for_loop(fallback_cache_map_t_itr, i, &fallback_cache.map) {
+        if (!ok) break;
+        if (strpbrk(i.data->val, "\t\n")) continue;
+        ok = fprintf(f, "%s\t%s\n", i.data->key, i.data->val) > 0;
+    }
+    if (fclose(f) != 0) ok = false;
+    if (!ok || rename(tpath, fallback_cache.path) != 0) unlink(tpath);
+}
+
+static void
+reset_fallback_cache(void) {
+    if (fallback_cache.map_initialized) vt_cleanup(&fallback_cache.map);
+    fallback_cache.map_initialized = false; fallback_cache.loaded = false; fallback_cache.dirty = false;
+}
+
+static void
+free_fallback_cache(void) {
+    save_fallback_cache();
+    reset_fallback_cache();
+    free(fallback_cache.path); fallback_cache.path = NULL;
+}
+
+static char*
+fallback_cache_key(const ListOfChars *lc, bool bold, bool italic, bool emoji_presentation) {
+    const size_t sz = 8 + 9 * lc->count;
+    char *ans = malloc(sz);
+    if (!ans) return NULL;
+    // whether the builtin nerd font is available changes the outcome of failed lookups
+    int n = snprintf(ans, sz, "%c%c%c%c", emoji_presentation ? 'e' : '-', bold ? 'b' : '-', italic ? 'i' : '-', builtin_nerd_font.face ? 'n' : '-');
+    for (size_t i = 0; i < lc->count; i++) n += snprintf(ans + n, sz - n, ":%x", lc->chars[i]);
+    return ans;
+}
+
+static const char*
+font_cache_get(const char *key) {
+    if (!fallback_cache.loaded) load_fallback_cache();
+    fallback_cache_map_t_itr i = vt_get(&fallback_cache.map, key);
+    return vt_is_end(i) ? NULL : i.data->val;
+}
+
+static const char*
+fallback_cache_get(const char *key) {
+    const char *ans = font_cache_get(key);
+    if (ans) fallback_cache.hits++; else fallback_cache.misses++;
+    return ans;
+}
+
+static void
+fallback_cache_set(const char *key, char type, FcPattern *match) {
+    char *val = NULL;
+    if (type == FALLBACK_FONT_PATTERN) {
+        // only store the properties used by pattern_as_dict()
+        FcObjectSet *os = FcObjectSetBuild(FC_FILE, FC_FAMILY, FC_STYLE, FC_FULLNAME, FC_POSTSCRIPT_NAME, FC_FONT_FEATURES, FC_VARIABLE,
+#ifdef FC_NAMED_INSTANCE
+            FC_NAMED_INSTANCE,
+#endif
+            FC_WEIGHT, FC_WIDTH, FC_SLANT, FC_HINT_STYLE, FC_INDEX, FC_RGBA, FC_LCD_FILTER, FC_HINTING, FC_SCALABLE, FC_OUTLINE, FC_COLOR, FC_SPACING, NULL);
+        if (!os) return;
+        FcPattern *filtered = FcPatternFilter(match, os);
+        FcObjectSetDestroy(os);
+        if (!filtered) return;
+        FcChar8 *spec = FcNameUnparse(filtered);
+        FcPatternDestroy(filtered);
+        if (!spec) return;
+        const size_t sz = strlen((const char*)spec) + 2;
+        if ((val = malloc(sz))) snprintf(val, sz, "%c%s", type, (const char*)spec);
+        FcStrFree(spec);
+    } else if ((val = malloc(2))) { val[0] = type; val[1] = 0; }
+    const char *k = strdup(key);
+    if (!val || !k || vt_is_end(vt_insert(&fallback_cache.map, k, val))) { free(val); free((void*)k); return; }
+    fallback_cache.dirty = true;
+}
+
+static char*
+specialized_cache_key(const char *path, unsigned long face_idx, double font_sz_in_pts, double dpi) {
+    // keys and values are stored one per line separated by a tab
+    if (strpbrk(path, "\t\n")) return NULL;
+    const size_t sz = strlen(path) + 128;
+    char *ans = malloc(sz);
+    if (ans) snprintf(ans, sz, "s%g:%g:%lu:%s", font_sz_in_pts, dpi, face_idx, path);
+    return ans;
+}
+
+static PyObject*
+font_cache_generation(PyObject UNUSED *self, PyObject UNUSED *args) {
+    ensure_initialized();
+    if (!fallback_cache.loaded) load_fallback_cache();
+    return PyLong_FromUnsignedLongLong(fallback_cache.generation);
+}
+
+static PyObject*
+fallback_font_cache_info(PyObject UNUSED *self, PyObject UNUSED *args) {
+    unsigned long negative = 0;
+    if (fallback_cache.map_initialized) {
+        vt_create_for_loop(fallback_cache_map_t_itr, i, &fallback_cache.map) { if (i.data->val[0] == NO_FALLBACK_FONT) negative++; }
+    }
+    return Py_BuildValue("{sKsKsksk}", "hits", fallback_cache.hits, "misses", fallback_cache.misses,
+            "entries", fallback_cache.map_initialized ? (unsigned long)vt_size(&fallback_cache.map) : 0ul, "negative_entries", negative);
+}
+// }}}
+
 static void
 finalize(void) {
     if (initialized) {
+        free_fallback_cache();
         Py_CLEAR(builtin_nerd_font.face);
         Py_CLEAR(builtin_nerd_font.descriptor);
         FcFini();
@@ -223,6 +480,15 @@ pattern_as_dict(FcPattern *pat) {
 #undef LS
 }
 
+static PyObject*
+descriptor_from_cached_pattern(const char *spec) {
+    FcPattern *pat = FcNameParse((const FcChar8*)spec);
+    if (pat == NULL) { PyErr_SetString(PyExc_ValueError, "Failed to parse cached fontconfig pattern"); return NULL; }
+    PyObject *ans = pattern_as_dict(pat);
+    FcPatternDestroy(pat);
+    return ans;
+}
+
 static PyObject*
 font_set(FcFontSet *fs) {
     PyObject *ans = PyTuple_New(fs->nfont);
@@ -271,19 +537,23 @@ end:
     return ans;
 }
 
-static PyObject*
-_fc_match(FcPattern *pat) {
-    FcPattern *match = NULL;
-    PyObject *ans = NULL;
+static FcPattern*
+fc_match_pattern(FcPattern *pat) {
     FcResult result;
     FcConfigSubstitute(NULL, pat, FcMatchPattern);
     FcDefaultSubstitute(pat);
     /* printf("fc_match = %s\n", FcNameUnparse(pat)); */
-    match = FcFontMatch(NULL, pat, &result);
-    if (match == NULL) { PyErr_SetString(PyExc_KeyError, "FcFontMatch() failed"); goto end; }
-    ans = pattern_as_dict(match);
-end:
-    if (match) FcPatternDestroy(match);
+    FcPattern *match = FcFontMatch(NULL, pat, &result);
+    if (match == NULL) PyErr_SetString(PyExc_KeyError, "FcFontMatch() failed");
+    return match;
+}
+
+static PyObject*
+_fc_match(FcPattern *pat) {
+    FcPattern *match = fc_match_pattern(pat);
+    if (match == NULL) return NULL;
+    PyObject *ans = pattern_as_dict(match);
+    FcPatternDestroy(match);
     return ans;
 }
 
@@ -423,13 +693,25 @@ specialize_font_descriptor(PyObject *base_descriptor, double font_sz_in_pts, dou
     if (!features) return NULL;
     RAII_PyObject(final_features, NULL);
     RAII_PyObject(ans, NULL);
-    AP(FcPatternAddString, FC_FILE, (const FcChar8*)PyUnicode_AsUTF8(p), "path");
-    AP(FcPatternAddInteger, FC_INDEX, face_idx, "index");
-    AP(FcPatternAddDouble, FC_SIZE, font_sz_in_pts, "size");
-    AP(FcPatternAddDouble, FC_DPI, (dpi_x + dpi_y) / 2.0, "dpi");
-    ans = _fc_match(pat);
-    FcPatternDestroy(pat); pat = NULL;
-    if (!ans) return NULL;
+    const double dpi = (dpi_x + dpi_y) / 2.0;
+    RAII_ALLOC(char, cache_key, specialized_cache_key(PyUnicode_AsUTF8(p), face_idx, font_sz_in_pts, dpi));
+    const char *cached = cache_key ? font_cache_get(cache_key) : NULL;
+    if (cached && cached[0] == FALLBACK_FONT_PATTERN) {
+        if (!(ans = descriptor_from_cached_pattern(cached + 1))) PyErr_Clear();
+    }
+    if (!ans) {
+        AP(FcPatternAddString, FC_FILE, (const FcChar8*)PyUnicode_AsUTF8(p), "path");
+        AP(FcPatternAddInteger, FC_INDEX, face_idx, "index");
+        AP(FcPatternAddDouble, FC_SIZE, font_sz_in_pts, "size");
+        AP(FcPatternAddDouble, FC_DPI, dpi, "dpi");
+        FcPattern *match = fc_match_pattern(pat);
+        FcPatternDestroy(pat); pat = NULL;
+        if (!match) return NULL;
+        ans = pattern_as_dict(match);
+        if (ans && cache_key) fallback_cache_set(cache_key, FALLBACK_FONT_PATTERN, match);
+        FcPatternDestroy(match);
+        if (!ans) return NULL;
+    } else { FcPatternDestroy(pat); pat = NULL; }
     // fontconfig returns a completely random font if the base descriptor
     // points to a font that fontconfig hasnt indexed, for example the built-in
     // NERD font
@@ -498,16 +780,32 @@ create_fallback_face(PyObject UNUSED *base_face, const ListOfChars *lc, bool bol
     ensure_initialized();
     PyObject *ans = NULL;
     RAII_PyObject(d, NULL);
-    FcPattern *pat = FcPatternCreate();
+    RAII_ALLOC(char, cache_key, fallback_cache_key(lc, bold, italic, emoji_presentation));
+    FcPattern *pat = NULL, *match = NULL;
+    bool glyph_found = false, from_cache = false, used_nerd_font = false;
+    const char *cached = cache_key ? fallback_cache_get(cache_key) : NULL;
+    if (cached) {
+        switch (cached[0]) {
+            case NO_FALLBACK_FONT: Py_RETURN_NONE;
+            case BUILTIN_NERD_FONT:
+                if (builtin_nerd_font.face) {
+                    d = Py_NewRef(builtin_nerd_font.descriptor); from_cache = used_nerd_font = glyph_found = true; goto face_from_descriptor;
+                }
+                break;
+            case FALLBACK_FONT_PATTERN:
+                if ((d = descriptor_from_cached_pattern(cached + 1))) { from_cache = glyph_found = true; goto face_from_descriptor; }
+                PyErr_Clear();
+                break;
+        }
+    }
+    pat = FcPatternCreate();
     if (pat == NULL) return PyErr_NoMemory();
-    bool glyph_found = false;
     AP(FcPatternAddString, FC_FAMILY, (const FcChar8*)(emoji_presentation ? "emoji" : "monospace"), "family");
     if (!emoji_presentation && bold) { AP(FcPatternAddInteger, FC_WEIGHT, FC_WEIGHT_BOLD, "weight"); }
     if (!emoji_presentation && italic) { AP(FcPatternAddInteger, FC_SLANT, FC_SLANT_ITALIC, "slant"); }
     if (emoji_presentation) { AP(FcPatternAddBool, FC_COLOR, true, "color"); }
-    size_t num = cell_as_unicode_for_fallback(lc, char_buf, arraysz(char_buf));
-    add_charset(pat, num);
-    d = _fc_match(pat);
+    add_charset(pat, cell_as_unicode_for_fallback(lc, char_buf, arraysz(char_buf)));
+    if ((match = fc_match_pattern(pat))) d = pattern_as_dict(match);
 face_from_descriptor:
     if (d) {
         ssize_t idx = -1;
@@ -528,12 +826,15 @@ end:
     if (!glyph_found && !PyErr_Occurred()) {
         if (builtin_nerd_font.face && has_cell_text(face_has_codepoint, builtin_nerd_font.face, false, lc)) {
             Py_CLEAR(ans);
-            d = builtin_nerd_font.descriptor; Py_INCREF(d); glyph_found = true; goto face_from_descriptor;
+            d = builtin_nerd_font.descriptor; Py_INCREF(d); glyph_found = used_nerd_font = true; goto face_from_descriptor;
         } else {
             if (global_state.debug_font_fallback && ans) has_cell_text(face_has_codepoint, ans, true, lc);
             Py_CLEAR(ans); ans = Py_None; Py_INCREF(ans);
         }
     }
+    if (!from_cache && cache_key && ans) fallback_cache_set(
+        cache_key, glyph_found ? (used_nerd_font ? BUILTIN_NERD_FONT : FALLBACK_FONT_PATTERN) : NO_FALLBACK_FONT, match);
+    if (match != NULL) FcPatternDestroy(match);
     return ans;
 }
 
@@ -579,7 +880,11 @@ add_font_file(PyObject UNUSED *self, PyObject *args) {
     ensure_initialized();
     const char *path = NULL;
     if (!PyArg_ParseTuple(args, "s", &path)) return NULL;
-    if (FcConfigAppFontAddFile(NULL, (const unsigned char*)path)) Py_RETURN_TRUE;
+    if (FcConfigAppFontAddFile(NULL, (const unsigned char*)path)) {
+        // the set of available fonts has changed so cached fallback lookups are stale
+        reset_fallback_cache();
+        Py_RETURN_TRUE;
+    }
     Py_RETURN_FALSE;
 }
 
@@ -592,6 +897,8 @@ static PyMethodDef module_methods[] = {
     METHODB(fc_match_postscript_name, METH_VARARGS),
     METHODB(add_font_file, METH_VARARGS),
     METHODB(set_builtin_nerd_font, METH_O),
+    METHODB(fallback_font_cache_info, METH_NOARGS),
+    METHODB(font_cache_generation, METH_NOARGS),
     {NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
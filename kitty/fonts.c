@@ -12,8 +12,12 @@
 #include "state.h"
 #include "char-props.h"
 #include "decorations.h"
+#include "box-sprite-cache.h"
 #include "glyph-cache.h"
 #include "print-graphics.h"
+#include "simd-string.h"
+
+extern PyTypeObject Screen_Type;
 
 #define MISSING_GLYPH 1
 #define MAX_NUM_EXTRA_GLYPHS_PUA 4u
@@ -283,6 +287,8 @@ font_group_for(double font_sz_in_pts, double logical_dpi_x, double logical_dpi_y
     fg->logical_dpi_y = logical_dpi_y;
     fg->id = ++font_group_id_counter;
     initialize_font_group(fg);
+    // start rendering box drawing characters for this cell size in the background
+    box_sprite_set_for(fg->fcm.cell_width, fg->fcm.cell_height, fg->logical_dpi_x, fg->logical_dpi_y);
     return fg;
 }
 
@@ -727,17 +733,9 @@ START_ALLOW_CASE_RANGE
         case '\t':
         case IMAGE_PLACEHOLDER_CHAR:
             return BLANK_FONT;
-        case 0x2500 ... 0x2573:
-        case 0x2574 ... 0x259f:
-        case 0x25d6 ... 0x25d7:
-        case 0x25cb: case 0x25c9: case 0x25cf:
-        case 0x25dc ... 0x25e5:
-        case 0x2800 ... 0x28ff:
-        case 0xe0b0 ... 0xe0bf: case 0xe0d6 ... 0xe0d7:    // powerline box drawing
-        case 0xee00 ... 0xee0b:    // fira code progress bar/spinner
-        case 0x1fb00 ... 0x1fbae:  // symbols for legacy computing
-        case 0x1cd00 ... 0x1cde5: case 0x1fbe6: case 0x1fbe7:  // octants
-        case 0xf5d0 ... 0xf60d:    // branch drawing characters
+#define R(first, last) case first ... last:
+        BOX_CHAR_RANGES(R)
+#undef R
             if (allow_use_of_box_fonts) return BOX_FONT;
             /* fallthrough */
         default:
@@ -794,14 +792,10 @@ static PyObject *descriptor_for_idx = NULL;
 void
 render_alpha_mask(const uint8_t *alpha_mask, pixel* dest, const Region *src_rect, const Region *dest_rect, size_t src_stride, size_t dest_stride, pixel color_rgb) {
     pixel col = (color_rgb << 8) & 0xffffff00;
+    if (src_rect->right <= src_rect->left || dest_rect->right <= dest_rect->left) return;
+    const size_t count = MIN(src_rect->right - src_rect->left, dest_rect->right - dest_rect->left);
     for (size_t sr = src_rect->top, dr = dest_rect->top; sr < src_rect->bottom && dr < dest_rect->bottom; sr++, dr++) {
-        pixel *d = dest + dest_stride * dr;
-        const uint8_t *s = alpha_mask + src_stride * sr;
-        for(size_t sc = src_rect->left, dc = dest_rect->left; sc < src_rect->right && dc < dest_rect->right; sc++, dc++) {
-            uint8_t src_alpha = d[dc] & 0xff;
-            uint8_t alpha = s[sc];
-            d[dc] = col | MAX(alpha, src_alpha);
-        }
+        render_alpha_mask_row(alpha_mask + src_stride * sr + src_rect->left, dest + dest_stride * dr + dest_rect->left, count, col);
     }
 }
 
@@ -969,7 +963,7 @@ render_scaled_decoration(FontCellMetrics unscaled_metrics, FontCellMetrics scale
     for (unsigned srcy = src.top, desty=dest.top; srcy < src_limit && desty < dest_limit; srcy++, desty++) {
         uint8_t *srcp = alpha_mask + cell_width * srcy;
         pixel *destp = output + cell_width * desty;
-        for (unsigned x = 0; x < cell_width; x++) destp[x] = 0xffffff00 | srcp[x];
+        alpha_mask_to_pixels(srcp, destp, cell_width, 0xffffff00);
     }
 }
 
@@ -1070,10 +1064,13 @@ render_box_cell(FontGroup *fg, RunFont rf, CPUCell *cpu_cell, GPUCell *gpu_cell,
         }
     }
     Region src = {.right = scaled_metrics.cell_width, .bottom = scaled_metrics.cell_height }, dest = src;
+    BoxSpriteSet *prerendered = scale == 1 ? box_sprite_set_for(src.right, src.bottom, fg->logical_dpi_x, fg->logical_dpi_y) : NULL;
     for (unsigned i = 0, cnum = 0; i < num_glyphs; i++) {
         unsigned int ch = global_glyph_render_scratch.lc->chars[cnum++];
         while (!ch) ch = global_glyph_render_scratch.lc->chars[cnum++];
-        render_box_char(ch, fg->canvas.alpha_mask, src.right, src.bottom, fg->logical_dpi_x, fg->logical_dpi_y, scale);
+        const uint8_t *mask = prerendered ? box_sprite_set_get(prerendered, ch) : NULL;
+        if (mask) memcpy(fg->canvas.alpha_mask, mask, (size_t)src.right * src.bottom);
+        else render_box_char(ch, fg->canvas.alpha_mask, src.right, src.bottom, fg->logical_dpi_x, fg->logical_dpi_y, scale);
         dest.left = i * scaled_metrics.cell_width + right_shift; dest.right = dest.left + scaled_metrics.cell_width;
         render_alpha_mask(fg->canvas.alpha_mask, fg->canvas.buf, &src, &dest, src.right, mask_stride, 0xffffff);
     }
@@ -2106,6 +2103,7 @@ finalize(void) {
     clear_symbol_maps();
     Py_CLEAR(descriptor_for_idx);
     free_font_groups();
+    free_box_sprite_sets();
     free(ligature_types);
     if (harfbuzz_buffer) { hb_buffer_destroy(harfbuzz_buffer); harfbuzz_buffer = NULL; }
     free(group_state.groups); group_state.groups = NULL; group_state.groups_capacity = 0;
@@ -2155,6 +2153,29 @@ test_render_line(PyObject UNUSED *self, PyObject *args) {
     Py_RETURN_NONE;
 }
 
+static PyObject*
+test_cell_data_row_extents(PyObject UNUSED *self, PyObject *args) {
+    Screen *screen;
+    if (!PyArg_ParseTuple(args, "O!", &Screen_Type, &screen)) return NULL;
+    if (!num_font_groups) { PyErr_SetString(PyExc_RuntimeError, "must create font group first"); return NULL; }
+    const unsigned render_lines = render_lines_for_screen(screen);
+    RAII_ALLOC(uint8_t, cell_data, malloc(sizeof(GPUCell) * render_lines * screen->columns));
+    RAII_ALLOC(uint8_t, selection_data, malloc((size_t)render_lines * screen->columns));
+    if (!cell_data || !selection_data) return PyErr_NoMemory();
+    screen_update_cell_data(screen, cell_data, (FONTS_DATA_HANDLE)font_groups, false);
+    screen_apply_selection(screen, selection_data, (size_t)render_lines * screen->columns);
+    const index_type *cells, *selection;
+    if (!screen_row_extents(screen, render_lines, &cells, &selection)) { PyErr_SetString(PyExc_RuntimeError, "row extents not available"); return NULL; }
+    RAII_PyObject(ans, PyTuple_New(render_lines));
+    if (!ans) return NULL;
+    for (unsigned y = 0; y < render_lines; y++) {
+        PyObject *t = Py_BuildValue("II", cells[y], selection[y]);
+        if (!t) return NULL;
+        PyTuple_SET_ITEM(ans, y, t);
+    }
+    return Py_NewRef(ans);
+}
+
 static uint32_t
 alpha_blend(uint32_t fg, uint32_t bg) {
     uint32_t r1 = (fg >> 16) & 0xFF, g1 = (fg >> 8) & 0xFF, b1 = fg & 0xFF, a = (fg >> 24) & 0xff;
@@ -2365,6 +2386,17 @@ parsed_font_feature_call(PyObject *s, PyObject *args, PyObject *kwargs UNUSED) {
     Py_RETURN_NONE;
 }
 
+static PyObject*
+parsed_font_feature_reduce(PyObject *self, PyObject *args UNUSED) {
+    RAII_PyObject(s, parsed_font_feature_str(self));
+    return s ? Py_BuildValue("O(O)", Py_TYPE(self), s) : NULL;
+}
+
+static PyMethodDef parsed_font_feature_methods[] = {
+    {"__reduce__", (PyCFunction)parsed_font_feature_reduce, METH_NOARGS, ""},
+    {NULL}  /* Sentinel */
+};
+
 PyTypeObject ParsedFontFeature_Type = {
     PyVarObject_HEAD_INIT(NULL, 0)
     .tp_name = "kitty.fast_data_types.ParsedFontFeature",
@@ -2377,6 +2409,7 @@ PyTypeObject ParsedFontFeature_Type = {
     .tp_richcompare = parsed_font_feature_cmp,
     .tp_hash = parsed_font_feature_hash,
     .tp_call = parsed_font_feature_call,
+    .tp_methods = parsed_font_feature_methods,
 };
 
 static PyObject*
@@ -2426,7 +2459,9 @@ static PyMethodDef module_methods[] = {
     METHODB(test_shape, METH_VARARGS),
     METHODB(current_fonts, METH_VARARGS),
     METHODB(test_render_line, METH_VARARGS),
+    METHODB(test_cell_data_row_extents, METH_VARARGS),
     METHODB(get_fallback_font, METH_VARARGS),
+    METHODB(test_box_sprite_cache, METH_VARARGS),
     {"specialize_font_descriptor", (PyCFunction)pyspecialize_font_descriptor, METH_VARARGS, ""},
     {"render_box_char", (PyCFunction)pyrender_box_char, METH_VARARGS, ""},
     {NULL, NULL, 0, NULL}        /* Sentinel */
@@ -1,12 +1,15 @@
 #!/usr/bin/env python
 # License: GPLv3 Copyright: 2024, Kovid Goyal <kovid at kovidgoyal.net>
 
+import os
+import pickle
 from typing import TYPE_CHECKING, Any, Literal, TypedDict, Union
 
 from kitty.constants import is_macos
 from kitty.fast_data_types import ParsedFontFeature
 from kitty.fonts import Descriptor, DescriptorVar, DesignAxis, FontSpec, NamedStyle, Scorer, VariableAxis, VariableData, family_name_to_key
 from kitty.options.types import Options
+from kitty.utils import log_error
 
 if TYPE_CHECKING:
     from kitty.fast_data_types import CTFace
@@ -367,7 +370,62 @@ def is_actually_variable_despite_fontconfigs_lies(d: Descriptor) -> bool:
     return False
 
 
+# Persistent cache of resolved font files {{{
+# Resolving the configured fonts needs the list of all installed fonts, which
+# is slow when there are many of them, so the result is stored in the cache
+# directory and re-used until the fontconfig configuration or installed fonts
+# change.
+
+FONT_FILES_CACHE_VERSION = 1
+
+
+def font_files_cache_path() -> str:
+    from kitty.constants import cache_dir
+    return os.path.join(cache_dir(), f'font-files-v{FONT_FILES_CACHE_VERSION}')
+
+
+def font_files_cache_key(opts: Options) -> str:
+    # different kitty versions can resolve the same options differently
+    from kitty.constants import str_version
+    return repr((str_version,) + tuple(getattr(opts, attr) for attr in attr_map.values()))
+
+
+def load_font_files_cache(generation: int) -> dict[str, FontFiles]:
+    try:
+        with open(font_files_cache_path(), 'rb') as f:
+            cached_generation, entries = pickle.load(f)
+    except FileNotFoundError:
+        return {}
+    except Exception as err:
+        log_error(f'Ignoring invalid font files cache with error: {err}')
+        return {}
+    return entries if cached_generation == generation and isinstance(entries, dict) else {}
+
+
+def save_font_files_cache(generation: int, entries: dict[str, FontFiles], max_entries: int = 16) -> None:
+    from kitty.config import atomic_save
+    while len(entries) > max_entries:
+        del entries[next(iter(entries))]
+    try:
+        atomic_save(pickle.dumps((generation, entries), protocol=pickle.HIGHEST_PROTOCOL), font_files_cache_path())
+    except Exception as err:
+        log_error(f'Failed to save font files cache with error: {err}')
+
+
 def get_font_files(opts: Options) -> FontFiles:
+    if is_macos:
+        return resolve_font_files(opts)
+    from kitty.fast_data_types import font_cache_generation
+    generation, key = font_cache_generation(), font_files_cache_key(opts)
+    entries = load_font_files_cache(generation)
+    if (ans := entries.get(key)) is None:
+        ans = entries[key] = resolve_font_files(opts)
+        save_font_files_cache(generation, entries)
+    return ans
+# }}}
+
+
+def resolve_font_files(opts: Options) -> FontFiles:
     ans: dict[str, Descriptor] = {}
     match_is_more_specific_than_family = Event()
     medium_font = get_font_from_spec(opts.font_family, match_is_more_specific_than_family=match_is_more_specific_than_family)
@@ -180,15 +180,43 @@ restore_viewport(void) {
     glViewport(saved_viewport[0], saved_viewport[1], saved_viewport[2], saved_viewport[3]);
 }
 
+static struct {
+    GLint x, y; GLsizei width, height;
+    bool active;
+} damage_clip;
+
+void
+set_damage_clip(Viewport vp, unsigned full_framebuffer_height) {
+    // All drawing is restricted to this region till clear_damage_clip() is called
+    damage_clip.x = vp.left; damage_clip.y = full_framebuffer_height - (vp.top + vp.height);
+    damage_clip.width = vp.width; damage_clip.height = vp.height;
+    damage_clip.active = true;
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(damage_clip.x, damage_clip.y, damage_clip.width, damage_clip.height);
+}
+
+void
+clear_damage_clip(void) {
+    if (damage_clip.active) { damage_clip.active = false; glDisable(GL_SCISSOR_TEST); }
+}
+
 void
 enable_scissor_using_top_left_origin(Viewport vp, unsigned full_framebuffer_height) {
     glEnable(GL_SCISSOR_TEST);
-    GLsizei newy = full_framebuffer_height - (vp.top + vp.height);
-    glScissor(vp.left, newy, vp.width, vp.height);
+    GLint x = vp.left, y = full_framebuffer_height - (vp.top + vp.height);
+    GLint right = x + vp.width, top = y + vp.height;
+    if (damage_clip.active) {
+        x = MAX(x, damage_clip.x); y = MAX(y, damage_clip.y);
+        right = MIN(right, damage_clip.x + damage_clip.width); top = MIN(top, damage_clip.y + damage_clip.height);
+    }
+    glScissor(x, y, MAX(0, right - x), MAX(0, top - y));
 }
 
 void
-disable_scissor(void) { glDisable(GL_SCISSOR_TEST); }
+disable_scissor(void) {
+    if (damage_clip.active) glScissor(damage_clip.x, damage_clip.y, damage_clip.width, damage_clip.height);
+    else glDisable(GL_SCISSOR_TEST);
+}
 
 static float
 linear_to_srgb(float c) { return (c <= 0.0031308f) ? 12.92f * c : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f; }
@@ -469,6 +497,15 @@ add_located_attribute_to_vao(ssize_t vao_idx, GLint aloc, GLint size, GLenum dat
 }
 
 
+void
+repoint_integer_attribute(ssize_t vao_idx, size_t bufnum, GLint aloc, GLint size, GLenum data_type, GLsizei stride, size_t offset) {
+    // The VAO must be bound
+    ssize_t buf = vaos[vao_idx].buffers[bufnum];
+    bind_buffer(buf);
+    glVertexAttribIPointer(aloc, size, data_type, stride, (void*)offset);
+    unbind_buffer(buf);
+}
+
 void
 add_attribute_to_vao(int p, ssize_t vao_idx, const char *name, GLint size, GLenum data_type, GLsizei stride, void *offset, GLuint divisor) {
     GLint aloc = attrib_location(p, name);
@@ -51,6 +51,7 @@ GLint attrib_location(int program, const char *name);
 ssize_t create_vao(void);
 size_t add_buffer_to_vao(ssize_t vao_idx, GLenum usage);
 void add_attribute_to_vao(int p, ssize_t vao_idx, const char *name, GLint size, GLenum data_type, GLsizei stride, void *offset, GLuint divisor);
+void repoint_integer_attribute(ssize_t vao_idx, size_t bufnum, GLint aloc, GLint size, GLenum data_type, GLsizei stride, size_t offset);
 ssize_t alloc_vao_buffer(ssize_t vao_idx, GLsizeiptr size, size_t bufnum, GLenum usage);
 void* alloc_and_map_vao_buffer(ssize_t vao_idx, GLsizeiptr size, size_t bufnum, bool frequently_updated);
 void unmap_vao_buffer(ssize_t vao_idx, size_t bufnum);
@@ -70,3 +71,5 @@ void bind_framebuffer_for_output(unsigned fbid);
 void set_framebuffer_to_use_for_output(unsigned fbid);
 void enable_scissor_using_top_left_origin(Viewport, unsigned);
 void disable_scissor(void);
+void set_damage_clip(Viewport vp, unsigned full_framebuffer_height);
+void clear_damage_clip(void);
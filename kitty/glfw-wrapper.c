@@ -428,6 +428,12 @@ load_glfw(const char* path) {
     *(void **) (&glfwSwapBuffers_impl) = dlsym(handle, "glfwSwapBuffers");
     if (glfwSwapBuffers_impl == NULL) fail("Failed to load glfw function glfwSwapBuffers with error: %s", dlerror());
 
+    *(void **) (&glfwSwapBuffersWithDamage_impl) = dlsym(handle, "glfwSwapBuffersWithDamage");
+    if (glfwSwapBuffersWithDamage_impl == NULL) fail("Failed to load glfw function glfwSwapBuffersWithDamage with error: %s", dlerror());
+
+    *(void **) (&glfwGetBufferAge_impl) = dlsym(handle, "glfwGetBufferAge");
+    if (glfwGetBufferAge_impl == NULL) fail("Failed to load glfw function glfwGetBufferAge with error: %s", dlerror());
+
     *(void **) (&glfwSwapInterval_impl) = dlsym(handle, "glfwSwapInterval");
     if (glfwSwapInterval_impl == NULL) fail("Failed to load glfw function glfwSwapInterval with error: %s", dlerror());
 
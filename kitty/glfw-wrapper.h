@@ -2382,6 +2382,14 @@ typedef void (*glfwSwapBuffers_func)(GLFWwindow*);
 GFW_EXTERN glfwSwapBuffers_func glfwSwapBuffers_impl;
 #define glfwSwapBuffers glfwSwapBuffers_impl
 
+typedef void (*glfwSwapBuffersWithDamage_func)(GLFWwindow*, const int*, int);
+GFW_EXTERN glfwSwapBuffersWithDamage_func glfwSwapBuffersWithDamage_impl;
+#define glfwSwapBuffersWithDamage glfwSwapBuffersWithDamage_impl
+
+typedef int (*glfwGetBufferAge_func)(GLFWwindow*);
+GFW_EXTERN glfwGetBufferAge_func glfwGetBufferAge_impl;
+#define glfwGetBufferAge glfwGetBufferAge_impl
+
 typedef void (*glfwSwapInterval_func)(int);
 GFW_EXTERN glfwSwapInterval_func glfwSwapInterval_impl;
 #define glfwSwapInterval glfwSwapInterval_impl
@@ -2304,9 +2304,42 @@ is_mouse_hidden(OSWindow *w) {
 void
 swap_window_buffers(OSWindow *os_window) {
     if (glfwAreSwapsAllowed(os_window->handle)) {
-        glfwSwapBuffers(os_window->handle);
+        const Region full = {.right=os_window->viewport_width, .bottom=os_window->viewport_height};
+        Region d = os_window->damage.frame;
+        d.right = MIN(d.right, full.right); d.bottom = MIN(d.bottom, full.bottom);
+        if (os_window->damage.is_full || os_window->damage.history_is_invalid || d.right <= d.left || d.bottom <= d.top) {
+            glfwSwapBuffers(os_window->handle);
+            d = full;
+        } else {
+            debug_rendering("Swapping window %llu with damage: left=%u top=%u right=%u bottom=%u\n", os_window->id, d.left, d.top, d.right, d.bottom);
+            const int rect[4] = {d.left, full.bottom - d.bottom, d.right - d.left, d.bottom - d.top};
+            glfwSwapBuffersWithDamage(os_window->handle, rect, 1);
+        }
+        const size_t n = arraysz(os_window->damage.history);
+        memmove(os_window->damage.history + 1, os_window->damage.history, sizeof(os_window->damage.history[0]) * (n - 1));
+        os_window->damage.history[0] = d;
+        os_window->damage.history_count = MIN(os_window->damage.history_count + 1, n);
+        os_window->damage.history_is_invalid = false;
         os_window->keep_rendering_till_swap = 0;
+    } else {
+        os_window->damage.history_count = 0;
+        os_window->damage.history_is_invalid = true;
     }
+    // swaps not preceded by damage tracking are of the full window
+    os_window->damage.frame = (Region){0}; os_window->damage.is_full = true;
+}
+
+bool
+os_window_damage_clip(OSWindow *w, Region *clip) {
+    // Rendering can be restricted to the damaged area only if the back buffer
+    // still holds an earlier frame and all damage since that frame is known
+    if (w->damage.is_full || w->needs_layers || w->live_resize.in_progress) return false;
+    const int age = glfwGetBufferAge(w->handle);
+    if (age < 1 || (unsigned)age - 1 > w->damage.history_count) return false;
+    *clip = w->damage.frame;
+    for (int i = 0; i < age - 1; i++) union_of_regions(clip, w->damage.history[i]);
+    clip->right = MIN(clip->right, (unsigned)w->viewport_width); clip->bottom = MIN(clip->bottom, (unsigned)w->viewport_height);
+    return clip->right > clip->left && clip->bottom > clip->top;
 }
 
 void
@@ -11,6 +11,9 @@
 #include "disk-cache.h"
 #include "iqsort.h"
 #include "safe-wrappers.h"
+#include "threading.h"
+#include "simd-string.h"
+#include "cleanup.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -20,6 +23,8 @@
 
 #include <zlib.h>
 #include <structmember.h>
+#include <openssl/evp.h>
+#include <openssl/sha.h>
 #include "png-reader.h"
 PyTypeObject GraphicsManager_Type;
 
@@ -78,6 +83,7 @@ grman_alloc(bool for_paused_rendering) {
     self->render_data.capacity = 64;
     self->render_data.item = calloc(self->render_data.capacity, sizeof(self->render_data.item[0]));
     self->storage_limit = DEFAULT_STORAGE_LIMIT;
+    self->cold_storage_limit = (size_t)OPT(image_cold_storage_limit) * 1024u * 1024u;
     if (self->render_data.item == NULL) {
         PyErr_NoMemory();
         Py_CLEAR(self); return NULL;
@@ -98,11 +104,20 @@ free_refs_data(Image *img) {
     vt_cleanup(&img->refs_by_internal_id);
 }
 
+static void
+release_mapped_file(LoadData *ld) {
+    if (ld->mapped_file && !ld->mapped_file_is_borrowed) munmap(ld->mapped_file, ld->mapped_file_sz);
+    ld->mapped_file = NULL; ld->mapped_file_sz = 0; ld->mapped_file_is_borrowed = false;
+}
+
+static void abandon_stream_job(DecodeJob *job);
+
 static void
 free_load_data(LoadData *ld) {
     free(ld->buf); ld->buf_used = 0; ld->buf_capacity = 0; ld->buf = NULL;
-    if (ld->mapped_file) munmap(ld->mapped_file, ld->mapped_file_sz);
-    ld->mapped_file = NULL; ld->mapped_file_sz = 0;
+    release_mapped_file(ld);
+    png_decoder_free(ld->png_decoder); ld->png_decoder = NULL; ld->streamed_sz = 0;
+    if (ld->stream_job) { abandon_stream_job(ld->stream_job); ld->stream_job = NULL; }
     ld->loading_for = (const ImageAndFrame){0};
 }
 
@@ -131,14 +146,144 @@ new_texture_ref(void) {
     return ans;
 }
 
+// Content addressed image data {{{
+// Root frames with identical pixel data share a single copy of the data, in a
+// process wide disk cache, and a single texture, regardless of which window
+// transmitted them. Images with frames get a private copy before their frames
+// are modified.
+
+// Smaller images are not worth the hashing and bookkeeping
+#define MIN_SHARED_IMAGE_SIZE 4096u
+
+// The SHA-256 digest of the data, collisions are not a concern, so the data
+// is never compared byte for byte
+typedef struct SharedImageKey { uint8_t digest[SHA256_DIGEST_LENGTH]; } SharedImageKey;
+
+struct SharedImageData {
+    SharedImageKey key;
+    uint32_t width, height, refcnt;
+    bool is_opaque;
+    size_t sz;
+    TextureRef *texture;
+};
+
+static uint64_t hash_shared_image_key(SharedImageKey k) { uint64_t ans; memcpy(&ans, k.digest, sizeof(ans)); return ans; }
+static bool cmpr_shared_image_key(SharedImageKey a, SharedImageKey b) { return memcmp(a.digest, b.digest, sizeof(a.digest)) == 0; }
+#define NAME shared_image_map
+#define KEY_TY SharedImageKey
+#define VAL_TY SharedImageData*
+#define HASH_FN hash_shared_image_key
+#define CMPR_FN cmpr_shared_image_key
+#include "kitty-verstable.h"
+
+static struct {
+    shared_image_map map;
+    PyObject *disk_cache;
+    bool finalized;
+} shared_images = {0};
+
+static bool
+read_shared_image_data(const SharedImageData *s, void **data, size_t *sz) {
+    if (!shared_images.disk_cache) return false;
+    return read_from_disk_cache_simple(shared_images.disk_cache, &s->key, sizeof(s->key), data, sz, false);
+}
+
+// Returns a new reference to the shared copy of the specified data or NULL if
+// it could not be shared
+static SharedImageData*
+acquire_shared_image_data(const void *data, size_t sz, uint32_t width, uint32_t height, bool is_opaque) {
+    if (shared_images.finalized) return NULL;
+    if (!shared_images.disk_cache) {
+        if (!(shared_images.disk_cache = create_disk_cache())) return NULL;
+        vt_init(&shared_images.map);
+    }
+    SharedImageKey key;
+    if (EVP_Digest(data, sz, key.digest, NULL, EVP_sha256(), NULL) != 1) return NULL;
+    shared_image_map_itr i = vt_get(&shared_images.map, key);
+    SharedImageData *s;
+    if (!vt_is_end(i)) {
+        s = i.data->val;
+        if (s->sz != sz || s->width != width || s->height != height || s->is_opaque != is_opaque) return NULL;
+        s->refcnt++;
+        return s;
+    }
+    if (!(s = calloc(1, sizeof(SharedImageData)))) return NULL;
+    *s = (SharedImageData){.key=key, .width=width, .height=height, .is_opaque=is_opaque, .sz=sz, .refcnt=1, .texture=new_texture_ref()};
+    if (!add_to_disk_cache(shared_images.disk_cache, &s->key, sizeof(s->key), data, sz) || vt_is_end(vt_insert(&shared_images.map, key, s))) {
+        remove_from_disk_cache(shared_images.disk_cache, &s->key, sizeof(s->key));
+        clear_texture_ref(&s->texture); free(s);
+        return NULL;
+    }
+    return s;
+}
+
+static void
+release_shared_image_data(SharedImageData **x) {
+    SharedImageData *s = *x;
+    *x = NULL;
+    if (!s || --s->refcnt) return;
+    if (shared_images.disk_cache) {
+        if (!remove_from_disk_cache(shared_images.disk_cache, &s->key, sizeof(s->key)) && PyErr_Occurred()) PyErr_Print();
+        vt_erase(&shared_images.map, s->key);
+    }
+    clear_texture_ref(&s->texture);
+    free(s);
+}
+
+static void
+finalize_shared_images(void) {
+    // Images still referring to shared data free it when they are released
+    shared_images.finalized = true;
+    if (shared_images.disk_cache) {
+        vt_cleanup(&shared_images.map);
+        Py_CLEAR(shared_images.disk_cache);
+    }
+}
+// }}}
+
 static uint32_t
 texture_id_for_img(Image *img) {
     return img->texture ? img->texture->id : 0;
 }
 
+static void forget_coalesced_frames(GraphicsManager *self, const Image *img);
+
+// Storage tiers {{{
+// Images whose textures are on the GPU are in the hot tier. When it exceeds
+// its quota the least recently used images have their textures released and
+// move to the cold tier, where their data is only in the disk cache, to be
+// reloaded when next placed or drawn. Only images that overflow the cold tier
+// are actually deleted. Each tier is kept as a list in least recently used
+// order so that updates and evictions are O(1).
+
+static void
+lru_unlink(GraphicsManager *self, Image *img) {
+    ImageLRUList *l = img->is_cold ? &self->cold_images : &self->hot_images;
+    if (img->lru.prev) img->lru.prev->lru.next = img->lru.next;
+    else if (l->oldest == img) l->oldest = img->lru.next;
+    if (img->lru.next) img->lru.next->lru.prev = img->lru.prev;
+    else if (l->newest == img) l->newest = img->lru.prev;
+    img->lru.prev = NULL; img->lru.next = NULL;
+}
+
+static void
+lru_append(ImageLRUList *l, Image *img) {
+    img->lru.prev = l->newest; img->lru.next = NULL;
+    if (l->newest) l->newest->lru.next = img;
+    else l->oldest = img;
+    l->newest = img;
+}
+
+static void touch_image(GraphicsManager *self, Image *img);
+// }}}
+
 static void
 free_image_resources(GraphicsManager *self, Image *img) {
+    // a pending decode still sends its response but its data is discarded
+    img->decode_job = NULL;
     clear_texture_ref(&img->texture);
+    release_shared_image_data(&img->shared);
+    forget_coalesced_frames(self, img);
     if (self->disk_cache) {
         ImageAndFrame key = { .image_id=img->internal_id, .frame_id = img->root_frame.id };
         if (!remove_from_cache(self, key) && PyErr_Occurred()) PyErr_Print();
@@ -152,12 +297,15 @@ free_image_resources(GraphicsManager *self, Image *img) {
         img->extra_frames = NULL;
     }
     free_refs_data(img);
-    self->used_storage = img->used_storage <= self->used_storage ? self->used_storage - img->used_storage : 0;
+    size_t *used = img->is_cold ? &self->cold_storage : &self->used_storage;
+    *used = img->used_storage <= *used ? *used - img->used_storage : 0;
+    img->used_storage = 0;
 }
 
 static void
 free_image(GraphicsManager *self, Image *img) {
     free_image_resources(self, img);
+    lru_unlink(self, img);
     free(img);
 }
 
@@ -167,12 +315,22 @@ static void
 free_all_images(GraphicsManager *self) {
     iter_images(self) free_image(self, i.data->val);
     vt_cleanup(&self->images_by_internal_id);
+    zero_at_ptr(&self->hot_images); zero_at_ptr(&self->cold_images);
 }
 
+static void orphan_decodes(GraphicsManager *self);
+static void free_persistent_shm(GraphicsManager *self);
+static void free_coalesced_frames(GraphicsManager *self);
+
 static void
 dealloc(GraphicsManager* self) {
+    orphan_decodes(self);
+    free_load_data(&self->currently_loading);
+    free_persistent_shm(self);
     free_all_images(self);
+    free_coalesced_frames(self);
     free(self->render_data.item);
+    free(self->layout.items);
     Py_CLEAR(self->disk_cache);
     Py_TYPE(self)->tp_free((PyObject*)self);
 }
@@ -216,12 +374,22 @@ ref_by_client_id(const Image *img, uint32_t id) {
 static void
 set_layers_dirty(GraphicsManager *self) {
     self->layers_dirty = true;
+    self->layout.valid = false;
+}
+
+static void
+set_refs_removed(GraphicsManager *self) {
+    // Removed refs only need to be dropped from the layout, unless some ref is
+    // positioned relative to another one, which might be among the removed
+    self->layers_dirty = true;
+    if (self->layout.has_child_refs) self->layout.valid = false;
+    else self->layout.needs_pruning = true;
 }
 
 static image_map_itr
 remove_image_itr(GraphicsManager *self, image_map_itr i) {
     free_image(self, i.data->val);
-    set_layers_dirty(self);
+    set_refs_removed(self);
     return vt_erase_itr(&self->images_by_internal_id, i);
 }
 
@@ -248,13 +416,16 @@ grman_pause_rendering(GraphicsManager *self, GraphicsManager *dest) {
     if (self == NULL) return;
     dest->window_id = self->window_id;
     dest->layers_dirty = true;
+    dest->layout.valid = false;
     dest->last_scrolled_by = 0;
     dest->last_scroll_offset_lines = 0.0f;
 
     iter_images(self) {
+        if (i.data->val->decode_job) continue;  // cannot be displayed yet
         Image *clone = calloc(1, sizeof(Image)), *img = i.data->val;
         if (!clone) continue;
         memcpy(clone, img, sizeof(*clone));
+        clone->shared = NULL;
         memset(&clone->refs_by_internal_id, 0, sizeof(clone->refs_by_internal_id));
         vt_init(&clone->refs_by_internal_id);
         clone->extra_frames = NULL;
@@ -266,6 +437,8 @@ grman_pause_rendering(GraphicsManager *self, GraphicsManager *dest) {
             }
         }
         clone->texture = incref_texture_ref(img->texture);
+        clone->lru.prev = NULL; clone->lru.next = NULL;
+        lru_append(img->is_cold ? &dest->cold_images : &dest->hot_images, clone);
         vt_insert(&dest->images_by_internal_id, clone->internal_id, clone);
     }
 }
@@ -277,25 +450,47 @@ trim_predicate(Image *img) {
     return !img->root_frame_data_loaded || !vt_size(&img->refs_by_internal_id);
 }
 
+static bool
+add_trim_predicate(Image *img) {
+    return !img->root_frame_data_loaded || (!img->client_id && !vt_size(&img->refs_by_internal_id));
+}
+
 static void
-apply_storage_quota(GraphicsManager *self, size_t storage_limit, id_type currently_added_image_internal_id) {
-    // First remove unreferenced images, even if they have an id
-    remove_images(self, trim_predicate, currently_added_image_internal_id);
-    if (self->used_storage < storage_limit) return;
-    size_t num_images = vt_size(&self->images_by_internal_id);
-    RAII_ALLOC(Image*, sorted, malloc(num_images * sizeof(Image*)));
-    if (!sorted) fatal("Out of memory");
-    Image **p = sorted;
-    iter_images(self) { *p++ = i.data->val; }
-#define oldest_img_first(a, b) ((*a)->atime < (*b)->atime)
-    QSORT(Image*, sorted, num_images, oldest_img_first);
-#undef oldest_img_first
+demote_image(GraphicsManager *self, Image *img) {
+    lru_unlink(self, img);
+    clear_texture_ref(&img->texture);
+    forget_coalesced_frames(self, img);
+    img->is_cold = true;
+    self->used_storage -= MIN(self->used_storage, img->used_storage);
+    self->cold_storage += img->used_storage;
+    lru_append(&self->cold_images, img);
+}
 
-    for (p = sorted; self->used_storage > storage_limit && num_images; p++, num_images--) remove_image(self, *p);
-    if (!num_images || !vt_size(&self->images_by_internal_id)) self->used_storage = 0;  // sanity check
+static void
+demote_images(GraphicsManager *self, size_t storage_limit, id_type skip_image_internal_id) {
+    // Move unplaced images and then the least recently used images to the cold
+    // tier, images on screen stay hot as they would just be reloaded when next drawn
+    for (unsigned pass = 0; pass < 2; pass++) {
+        for (Image *img = self->hot_images.oldest, *next; img && self->used_storage > storage_limit; img = next) {
+            next = img->lru.next;
+            if (!img->is_drawn && !img->decode_job && img->internal_id != skip_image_internal_id && (pass || !vt_size(&img->refs_by_internal_id))) demote_image(self, img);
+        }
+    }
+    // Then delete the least recently used images from the cold tier
+    while (self->cold_storage > self->cold_storage_limit && self->cold_images.oldest) remove_image(self, self->cold_images.oldest);
+    if (!vt_size(&self->images_by_internal_id)) self->used_storage = self->cold_storage = 0;  // sanity check
 }
 
-static char command_response[512] = {0};
+static void
+apply_storage_quota(GraphicsManager *self, size_t storage_limit, id_type currently_added_image_internal_id) {
+    // First remove images that can never be displayed, unplaced images with
+    // an id can still be placed later so they are only demoted
+    remove_images(self, add_trim_predicate, currently_added_image_internal_id);
+    demote_images(self, storage_limit, currently_added_image_internal_id);
+}
+
+// Thread local as image data is also decoded in worker threads
+static _Thread_local char command_response[512] = {0};
 
 static void
 set_command_failed_response(const char *code, const char *fmt, ...) {
@@ -330,7 +525,7 @@ err:
 static const char*
 zlib_strerror(int ret) {
 #define Z(x) case x: return #x;
-    static char buf[128];
+    static _Thread_local char buf[128];
     switch(ret) {
         case Z_ERRNO:
             return strerror(errno);
@@ -379,29 +574,38 @@ png_error_handler(png_read_data *d UNUSED, const char *code, const char *msg) {
     set_command_failed_response(code, "%s", msg);
 }
 
+static void
+adopt_decoded_png(LoadData *load_data, png_read_data *d) {
+    // d may be owned by load_data->png_decoder which is freed by free_load_data()
+    uint8_t *buf = d->decompressed; d->decompressed = NULL;
+    const size_t sz = d->sz; const uint32_t width = d->width, height = d->height;
+    free_load_data(load_data);
+    load_data->buf = buf;
+    load_data->buf_capacity = sz;
+    load_data->buf_used = sz;
+    load_data->data_sz = sz;
+    load_data->width = width; load_data->height = height;
+}
+
 static bool
 inflate_png(LoadData *load_data, uint8_t *buf, size_t bufsz) {
     png_read_data d = {.err_handler=png_error_handler};
     inflate_png_inner(&d, buf, bufsz, MAX_IMAGE_DIMENSION);
-    if (d.ok) {
-        free_load_data(load_data);
-        load_data->buf = d.decompressed;
-        load_data->buf_capacity = d.sz;
-        load_data->buf_used = d.sz;
-        load_data->data_sz = d.sz;
-        load_data->width = d.width; load_data->height = d.height;
-    }
+    if (d.ok) adopt_decoded_png(load_data, &d);
     else free(d.decompressed);
     free(d.row_pointers);
     return d.ok;
 }
-#undef ABRT
-// }}}
 
 static bool
-add_trim_predicate(Image *img) {
-    return !img->root_frame_data_loaded || (!img->client_id && !vt_size(&img->refs_by_internal_id));
+finish_streamed_png(LoadData *load_data) {
+    png_read_data *d = png_decoder_finish(load_data->png_decoder);
+    bool ok = d->ok;
+    if (ok) adopt_decoded_png(load_data, d);
+    return ok;
 }
+#undef ABRT
+// }}}
 
 static void
 print_png_read_error(png_read_data *d, const char *code, const char* msg) {
@@ -510,6 +714,7 @@ find_or_create_image(GraphicsManager *self, uint32_t id, bool *existing) {
     if (!ans) fatal("Out of memory allocating Image object");
     ans->internal_id = next_id(&self->image_id_counter);
     ans->texture = new_texture_ref();
+    lru_append(&self->hot_images, ans);
     vt_init(&ans->refs_by_internal_id);
     if (vt_is_end(vt_insert(&self->images_by_internal_id, ans->internal_id, ans))) fatal("Out of memory");
     return ans;
@@ -540,10 +745,128 @@ get_free_client_id(const GraphicsManager *self) {
     return ans;
 }
 
+// Persistent shared memory {{{
+// With t=S the shared memory object is not unlinked after reading, instead it
+// stays mapped so that clients streaming frames, such as video players, can
+// register a region once and then transmit frames by offset and size, without
+// the cost of opening, mapping and unlinking a new object per frame. A region
+// is dropped when the client unlinks it, when it is evicted by newer regions or
+// when the GraphicsManager is destroyed.
+
+#define MAX_PERSISTENT_SHM 8u
+
+struct PersistentShm {
+    char *name;
+    int fd;
+    uint8_t *addr;
+    size_t sz;
+};
+
+static void
+unmap_persistent_shm(PersistentShm *r) {
+    if (r->addr) munmap(r->addr, r->sz);
+    if (r->fd > -1) safe_close(r->fd, __FILE__, __LINE__);
+    free(r->name);
+    *r = (PersistentShm){.fd=-1};
+}
+
+static void
+remove_persistent_shm(GraphicsManager *self, size_t idx) {
+    unmap_persistent_shm(self->persistent_shm.items + idx);
+    remove_i_from_array(self->persistent_shm.items, idx, self->persistent_shm.count);
+}
+
+static void
+free_persistent_shm(GraphicsManager *self) {
+    for (size_t i = 0; i < self->persistent_shm.count; i++) unmap_persistent_shm(self->persistent_shm.items + i);
+    free(self->persistent_shm.items);
+    zero_at_ptr(&self->persistent_shm);
+}
+
+// Maps the object if it has been unlinked or resized since it was last used,
+// returns false if it is no longer usable
+static bool
+refresh_persistent_shm(PersistentShm *r) {
+    struct stat st;
+    if (fstat(r->fd, &st) != 0 || st.st_nlink == 0 || st.st_size <= 0) return false;
+    if ((size_t)st.st_size == r->sz) return true;
+    if (r->addr) munmap(r->addr, r->sz);
+    r->sz = st.st_size;
+    r->addr = mmap(NULL, r->sz, PROT_READ, MAP_SHARED, r->fd, 0);
+    if (r->addr == MAP_FAILED) { r->addr = NULL; return false; }
+    return true;
+}
+
+static PersistentShm*
+persistent_shm_for(GraphicsManager *self, const char *name) {
+    PersistentShm *ans = NULL;
+    // drop regions the client has unlinked, keeping the most recently used region last
+    for (size_t i = self->persistent_shm.count; i-- > 0;) {
+        PersistentShm *r = self->persistent_shm.items + i;
+        bool matches = strcmp(r->name, name) == 0;
+        if (!refresh_persistent_shm(r)) { remove_persistent_shm(self, i); continue; }
+        if (matches) {
+            PersistentShm found = *r;
+            remove_i_from_array(self->persistent_shm.items, i, self->persistent_shm.count);
+            self->persistent_shm.items[self->persistent_shm.count++] = found;
+            return self->persistent_shm.items + self->persistent_shm.count - 1;
+        }
+    }
+    PersistentShm r = {.fd=safe_shm_open(name, O_RDONLY, 0)};
+    if (r.fd < 0) return NULL;
+    if (!(r.name = strdup(name)) || !refresh_persistent_shm(&r)) {
+        int saved_errno = errno ? errno : EINVAL;
+        unmap_persistent_shm(&r);
+        errno = saved_errno;
+        return NULL;
+    }
+    if (self->persistent_shm.count >= MAX_PERSISTENT_SHM) remove_persistent_shm(self, 0);
+    ensure_space_for(&self->persistent_shm, items, PersistentShm, self->persistent_shm.count + 1, capacity, MAX_PERSISTENT_SHM, false);
+    ans = self->persistent_shm.items + self->persistent_shm.count++;
+    *ans = r;
+    return ans;
+}
+// }}}
+
 #define ABRT(code, ...) { set_command_failed_response(code, __VA_ARGS__); self->currently_loading.loading_completed_successfully = false; free_load_data(&self->currently_loading); return NULL; }
 
 #define MAX_DATA_SZ (4u * 100000000u)
 enum FORMATS { RGB=24, RGBA=32, PNG=100 };
+// Images whose decoded data is smaller than this are decoded synchronously
+#define ASYNC_DECODE_THRESHOLD (512u * 1024u)
+// The PNG signature and IHDR chunk up to the image height
+#define PNG_DIMENSIONS_SZ 24u
+
+static bool
+png_dimensions(const uint8_t *buf, size_t sz, uint32_t *width, uint32_t *height) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (!buf || sz < PNG_DIMENSIONS_SZ || memcmp(buf, signature, sizeof(signature)) != 0 || memcmp(buf + 12, "IHDR", 4) != 0) return false;
+#define be32(p) (((uint32_t)(p)[0] << 24) | ((uint32_t)(p)[1] << 16) | ((uint32_t)(p)[2] << 8) | (uint32_t)(p)[3])
+    *width = be32(buf + 16); *height = be32(buf + 20);
+#undef be32
+    return *width && *height && *width <= MAX_IMAGE_DIMENSION && *height <= MAX_IMAGE_DIMENSION;
+}
+
+// Directly transmitted PNG data is decoded as it arrives, in a worker thread
+// for images large enough to make that worthwhile, see start_streamed_decode()
+static bool
+decode_png_in_worker(const LoadData *ld, uint32_t *width, uint32_t *height) {
+    // animation frames and queries are always decoded synchronously
+    if (ld->start_command.action == 'f' || ld->start_command.action == 'q') return false;
+    return png_dimensions(ld->buf, ld->buf_used, width, height) && (size_t)4 * *width * *height >= ASYNC_DECODE_THRESHOLD;
+}
+
+static DecodeJob* start_streamed_decode(LoadData *ld, uint32_t width, uint32_t height);
+static bool stream_to_decode_job(DecodeJob *job, const uint8_t *data, size_t sz);
+
+static bool
+feed_png_decoder(LoadData *ld, const uint8_t *data, size_t sz) {
+    if (sz > MAX_DATA_SZ - ld->streamed_sz) return false;
+    ld->streamed_sz += sz;
+    // errors are reported once the last chunk has been received
+    png_decoder_feed(ld->png_decoder, data, sz);
+    return true;
+}
 
 static Image*
 load_image_data(GraphicsManager *self, Image *img, const GraphicsCommand *g, const unsigned char transmission_type, const uint32_t data_fmt, const uint8_t *payload) {
@@ -553,6 +876,18 @@ load_image_data(GraphicsManager *self, Image *img, const GraphicsCommand *g, con
 
     switch(transmission_type) {
         case 'd':  // direct
+            if (load_data->stream_job) {
+                if (g->payload_sz > MAX_DATA_SZ - load_data->streamed_sz) ABRT("EFBIG", "Too much data");
+                load_data->streamed_sz += g->payload_sz;
+                if (!stream_to_decode_job(load_data->stream_job, payload, g->payload_sz)) ABRT("ENOMEM", "Out of memory");
+                if (!g->more) { load_data->loading_completed_successfully = true; load_data->loading_for = (const ImageAndFrame){0}; }
+                break;
+            }
+            if (load_data->png_decoder) {
+                if (!feed_png_decoder(load_data, payload, g->payload_sz)) ABRT("EFBIG", "Too much data");
+                if (!g->more) { load_data->loading_completed_successfully = true; load_data->loading_for = (const ImageAndFrame){0}; }
+                break;
+            }
             if (load_data->buf_capacity - load_data->buf_used < g->payload_sz) {
                 if (load_data->buf_used + g->payload_sz > MAX_DATA_SZ || data_fmt != PNG) ABRT("EFBIG", "Too much data");
                 load_data->buf_capacity = MIN(2 * load_data->buf_capacity, MAX_DATA_SZ);
@@ -564,6 +899,18 @@ load_image_data(GraphicsManager *self, Image *img, const GraphicsCommand *g, con
             }
             memcpy(load_data->buf + load_data->buf_used, payload, g->payload_sz);
             load_data->buf_used += g->payload_sz;
+            if (data_fmt == PNG && !g->compressed && load_data->buf_used >= PNG_DIMENSIONS_SZ &&
+                    load_data->buf_used - g->payload_sz < PNG_DIMENSIONS_SZ) {
+                // Decode as the data arrives rather than accumulating all of it first
+                uint32_t width, height;
+                if (decode_png_in_worker(load_data, &width, &height)) {
+                    if (!(load_data->stream_job = start_streamed_decode(load_data, width, height))) ABRT("ENOMEM", "Out of memory");
+                } else {
+                    if (!(load_data->png_decoder = png_decoder_new(png_error_handler, MAX_IMAGE_DIMENSION))) ABRT("ENOMEM", "Out of memory");
+                    feed_png_decoder(load_data, load_data->buf, load_data->buf_used);
+                }
+                free(load_data->buf); load_data->buf = NULL; load_data->buf_used = 0; load_data->buf_capacity = 0;
+            }
             if (!g->more) { load_data->loading_completed_successfully = true; load_data->loading_for = (const ImageAndFrame){0}; }
             break;
         case 'f': // file
@@ -594,59 +941,86 @@ load_image_data(GraphicsManager *self, Image *img, const GraphicsCommand *g, con
             else if (transmission_type == 's') shm_unlink(fname);
             if (!load_data->loading_completed_successfully) return NULL;
             break;
+        case 'S': { // persistent POSIX shared memory
+            if (g->payload_sz > 2048) ABRT("EINVAL", "Filename too long");
+            snprintf(fname, sizeof(fname)/sizeof(fname[0]), "%.*s", (int)g->payload_sz, payload);
+            PersistentShm *r = persistent_shm_for(self, fname);
+            if (!r) ABRT("EBADF", "Failed to open shared memory object for graphics transmission with error: [%d] %s", errno, strerror(errno));
+            if (g->data_offset >= r->sz) ABRT("EINVAL", "Offset %u is outside the shared memory object of size %zu", g->data_offset, r->sz);
+            const size_t sz = g->data_sz ? g->data_sz : r->sz - g->data_offset;
+            if (sz > r->sz - g->data_offset) ABRT("EINVAL", "Size %zu at offset %u is outside the shared memory object of size %zu", sz, g->data_offset, r->sz);
+            release_mapped_file(load_data);
+            load_data->mapped_file = r->addr + g->data_offset;
+            load_data->mapped_file_sz = sz;
+            load_data->mapped_file_is_borrowed = true;
+            load_data->loading_completed_successfully = true;
+        } break;
         default:
             ABRT("EINVAL", "Unknown transmission type: %c", g->transmission_type);
     }
     return img;
 }
 
-static Image*
-process_image_data(GraphicsManager *self, Image* img, const GraphicsCommand *g, const unsigned char transmission_type, const uint32_t data_fmt) {
-    bool needs_processing = g->compressed || data_fmt == PNG;
+// Decompresses and decodes the loaded data, can be called from worker threads
+static bool
+decode_load_data(LoadData *ld, const unsigned char compressed, const unsigned char transmission_type, const uint32_t data_fmt) {
+#define FAIL(code, ...) { set_command_failed_response(code, __VA_ARGS__); ld->loading_completed_successfully = false; return false; }
+    bool needs_processing = compressed || data_fmt == PNG;
     if (needs_processing) {
         uint8_t *buf; size_t bufsz;
-#define IB { if (self->currently_loading.buf) { buf = self->currently_loading.buf; bufsz = self->currently_loading.buf_used; } else { buf = self->currently_loading.mapped_file; bufsz = self->currently_loading.mapped_file_sz; } }
-        switch(g->compressed) {
+#define IB { if (ld->buf) { buf = ld->buf; bufsz = ld->buf_used; } else { buf = ld->mapped_file; bufsz = ld->mapped_file_sz; } }
+        switch(compressed) {
             case 'z':
                 IB;
-                if (!inflate_zlib(&self->currently_loading, buf, bufsz)) {
-                    self->currently_loading.loading_completed_successfully = false; return NULL;
+                if (!inflate_zlib(ld, buf, bufsz)) {
+                    ld->loading_completed_successfully = false; return false;
                 }
                 break;
             case 0:
                 break;
             default:
-                ABRT("EINVAL", "Unknown image compression: %c", g->compressed);
+                FAIL("EINVAL", "Unknown image compression: %c", compressed);
         }
         switch(data_fmt) {
             case PNG:
+                if (ld->png_decoder) {
+                    if (!finish_streamed_png(ld)) { ld->loading_completed_successfully = false; return false; }
+                    break;
+                }
                 IB;
-                if (!inflate_png(&self->currently_loading, buf, bufsz)) {
-                    self->currently_loading.loading_completed_successfully = false; return NULL;
+                if (!inflate_png(ld, buf, bufsz)) {
+                    ld->loading_completed_successfully = false; return false;
                 }
                 break;
             default: break;
         }
 #undef IB
-        self->currently_loading.data = self->currently_loading.buf;
-        if (self->currently_loading.buf_used < self->currently_loading.data_sz) {
-            ABRT("ENODATA", "Insufficient image data: %zu < %zu", self->currently_loading.buf_used, self->currently_loading.data_sz);
-        }
-        if (self->currently_loading.mapped_file) {
-            munmap(self->currently_loading.mapped_file, self->currently_loading.mapped_file_sz);
-            self->currently_loading.mapped_file = NULL; self->currently_loading.mapped_file_sz = 0;
+        ld->data = ld->buf;
+        if (ld->buf_used < ld->data_sz) {
+            FAIL("ENODATA", "Insufficient image data: %zu < %zu", ld->buf_used, ld->data_sz);
         }
+        release_mapped_file(ld);
     } else {
         if (transmission_type == 'd') {
-            if (self->currently_loading.buf_used < self->currently_loading.data_sz) {
-                ABRT("ENODATA", "Insufficient image data: %zu < %zu",  self->currently_loading.buf_used, self->currently_loading.data_sz);
-            } else self->currently_loading.data = self->currently_loading.buf;
+            if (ld->buf_used < ld->data_sz) {
+                FAIL("ENODATA", "Insufficient image data: %zu < %zu",  ld->buf_used, ld->data_sz);
+            } else ld->data = ld->buf;
         } else {
-            if (self->currently_loading.mapped_file_sz < self->currently_loading.data_sz) {
-                ABRT("ENODATA", "Insufficient image data: %zu < %zu",  self->currently_loading.mapped_file_sz, self->currently_loading.data_sz);
-            } else self->currently_loading.data = self->currently_loading.mapped_file;
+            if (ld->mapped_file_sz < ld->data_sz) {
+                FAIL("ENODATA", "Insufficient image data: %zu < %zu",  ld->mapped_file_sz, ld->data_sz);
+            } else ld->data = ld->mapped_file;
         }
-        self->currently_loading.loading_completed_successfully = true;
+        ld->loading_completed_successfully = true;
+    }
+    return true;
+#undef FAIL
+}
+
+static Image*
+process_image_data(GraphicsManager *self, Image* img, const GraphicsCommand *g, const unsigned char transmission_type, const uint32_t data_fmt) {
+    if (!decode_load_data(&self->currently_loading, g->compressed, transmission_type, data_fmt)) {
+        free_load_data(&self->currently_loading);
+        return NULL;
     }
     return img;
 }
@@ -708,6 +1082,399 @@ upload_to_gpu(GraphicsManager *self, Image *img, const bool is_opaque, const boo
     }
 }
 
+// Stores the data of a newly loaded root frame, sharing it with identical
+// images if possible, and uploads it to the GPU
+static bool
+store_root_frame(GraphicsManager *self, Image *img, const uint8_t *data, size_t sz) {
+    bool needs_upload = true;
+    if (sz >= MIN_SHARED_IMAGE_SIZE && (img->shared = acquire_shared_image_data(data, sz, img->width, img->height, img->root_frame.is_opaque))) {
+        clear_texture_ref(&img->texture);
+        img->texture = incref_texture_ref(img->shared->texture);
+        needs_upload = !img->texture->id;
+    } else {
+        if (PyErr_Occurred()) PyErr_Print();
+        if (!add_to_cache(self, (const ImageAndFrame){.image_id=img->internal_id, .frame_id=img->root_frame.id}, data, sz)) return false;
+    }
+    if (needs_upload) upload_to_gpu(self, img, img->root_frame.is_opaque, img->root_frame.is_4byte_aligned, data);
+    return true;
+}
+
+// Gives the image private copies of its root frame data and texture, must be
+// called before any of its frames are modified
+static bool
+unshare_image(GraphicsManager *self, Image *img) {
+    if (!img->shared) return true;
+    void *data; size_t sz;
+    if (!read_shared_image_data(img->shared, &data, &sz)) return false;
+    bool ok = add_to_cache(self, (const ImageAndFrame){.image_id=img->internal_id, .frame_id=img->root_frame.id}, data, sz);
+    if (ok) {
+        release_shared_image_data(&img->shared);
+        clear_texture_ref(&img->texture);
+        if (!img->is_cold) {  // cold images get a texture when they are next used
+            img->texture = new_texture_ref();
+            upload_to_gpu(self, img, img->root_frame.is_opaque, img->root_frame.is_4byte_aligned, data);
+        }
+    } else if (PyErr_Occurred()) PyErr_Print();
+    free(data);
+    return ok;
+}
+
+// Asynchronous decoding {{{
+// Decoding large compressed or PNG images is done in worker threads so as not
+// to block the main thread. The image gets its final dimensions immediately so
+// that it can be placed, it is displayed once its data has been decoded and
+// uploaded. Responses are sent in the order the commands were received, the
+// responses of other commands are queued behind those of pending decodes.
+// Directly transmitted PNG data is handed to the worker chunk by chunk as it
+// arrives, so that the compressed data is never accumulated.
+
+#define MAX_DECODE_WORKERS 4u
+
+struct DecodeJob {
+    LoadData load_data;
+    GraphicsCommand start_command;
+    unsigned char compressed, transmission_type;
+    uint32_t format, width, height;
+    id_type image_id;
+    char response[sizeof(command_response)];
+    // set for jobs that only hold the response of a command that is queued
+    // behind earlier decodes
+    char *queued_response;
+    // The fields below are protected by decoder.lock
+    bool ok, done, orphaned, wakeup_main_loop;
+    // streaming jobs have their data appended to pending as it arrives and
+    // are queued whenever there is pending data that no worker is consuming
+    bool streaming, queued, input_complete;
+    struct { uint8_t *buf; size_t used; } pending;
+    struct DecodeJob *next;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work_available, work_done;
+    DecodeJob *head, *tail;
+    unsigned num_workers, num_idle_workers;
+} decoder = {.lock = PTHREAD_MUTEX_INITIALIZER, .work_available = PTHREAD_COND_INITIALIZER, .work_done = PTHREAD_COND_INITIALIZER};
+
+static void
+free_decode_job(DecodeJob *job) {
+    free_load_data(&job->load_data);
+    free(job->queued_response);
+    free(job->pending.buf);
+    free(job);
+}
+
+// Feeds the pending data of a streaming job to its PNG decoder. Called with
+// decoder.lock held, returns true once all the data has been fed.
+static bool
+consume_pending_data(DecodeJob *job) {
+    while (job->pending.used && !job->orphaned) {
+        uint8_t *buf = job->pending.buf; size_t sz = job->pending.used;
+        job->pending.buf = NULL; job->pending.used = 0;
+        pthread_mutex_unlock(&decoder.lock);
+        // errors are reported by png_decoder_finish()
+        png_decoder_feed(job->load_data.png_decoder, buf, sz);
+        free(buf);
+        pthread_mutex_lock(&decoder.lock);
+    }
+    if (job->input_complete) return true;
+    job->queued = false;
+    return false;
+}
+
+static void*
+decode_worker(void *x UNUSED) {
+    set_thread_name("ImageDecoder");
+    pthread_mutex_lock(&decoder.lock);
+    while (true) {
+        decoder.num_idle_workers++;
+        while (!decoder.head) pthread_cond_wait(&decoder.work_available, &decoder.lock);
+        decoder.num_idle_workers--;
+        DecodeJob *job = decoder.head;
+        decoder.head = job->next;
+        if (!decoder.head) decoder.tail = NULL;
+        if (job->streaming && !consume_pending_data(job)) continue;
+        bool orphaned = job->orphaned;
+        pthread_mutex_unlock(&decoder.lock);
+
+        command_response[0] = 0;
+        bool ok = !orphaned && decode_load_data(&job->load_data, job->compressed, job->transmission_type, job->format);
+        if (!ok) memcpy(job->response, command_response, sizeof(job->response));
+
+        pthread_mutex_lock(&decoder.lock);
+        job->ok = ok; job->done = true;
+        bool wakeup = job->wakeup_main_loop;
+        if (job->orphaned) { free_decode_job(job); wakeup = false; }
+        else pthread_cond_broadcast(&decoder.work_done);
+        pthread_mutex_unlock(&decoder.lock);
+        if (wakeup) wakeup_main_loop();
+        pthread_mutex_lock(&decoder.lock);
+    }
+    return NULL;
+}
+
+// Must be called with decoder.lock held
+static void
+queue_decode_job_locked(DecodeJob *job) {
+    job->next = NULL;
+    if (decoder.tail) decoder.tail->next = job;
+    else decoder.head = job;
+    decoder.tail = job;
+    if (!decoder.num_idle_workers && decoder.num_workers < MAX_DECODE_WORKERS) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        pthread_t worker;
+        if ((!decoder.num_workers || ncpu - 1 > (long)decoder.num_workers) && pthread_create(&worker, NULL, decode_worker, NULL) == 0) {
+            pthread_detach(worker);
+            decoder.num_workers++;
+        }
+    }
+    pthread_cond_signal(&decoder.work_available);
+}
+
+static void
+queue_decode_job(DecodeJob *job) {
+    pthread_mutex_lock(&decoder.lock);
+    queue_decode_job_locked(job);
+    pthread_mutex_unlock(&decoder.lock);
+}
+
+// Creates a job that decodes the directly transmitted PNG data of ld in a
+// worker thread as it arrives, starting with the data received so far
+static DecodeJob*
+start_streamed_decode(LoadData *ld, uint32_t width, uint32_t height) {
+    DecodeJob *job = calloc(1, sizeof(DecodeJob));
+    if (!job) return NULL;
+    if (!(job->load_data.png_decoder = png_decoder_new(png_error_handler, MAX_IMAGE_DIMENSION)) || !(job->pending.buf = malloc(ld->buf_used))) {
+        free_decode_job(job);
+        return NULL;
+    }
+    memcpy(job->pending.buf, ld->buf, ld->buf_used);
+    job->pending.used = ld->buf_used;
+    ld->streamed_sz = ld->buf_used;
+    job->load_data.is_4byte_aligned = true;
+    job->start_command = ld->start_command;
+    job->transmission_type = 'd'; job->format = PNG;
+    job->width = width; job->height = height;
+    job->wakeup_main_loop = global_state.boss != NULL;
+    job->streaming = true; job->queued = true;
+    queue_decode_job(job);
+    return job;
+}
+
+static bool
+stream_to_decode_job(DecodeJob *job, const uint8_t *data, size_t sz) {
+    if (!sz) return true;
+    bool ok = false;
+    pthread_mutex_lock(&decoder.lock);
+    uint8_t *buf = realloc(job->pending.buf, job->pending.used + sz);
+    if (buf) {
+        memcpy(buf + job->pending.used, data, sz);
+        job->pending.buf = buf; job->pending.used += sz;
+        if (!job->queued) { job->queued = true; queue_decode_job_locked(job); }
+        ok = true;
+    }
+    pthread_mutex_unlock(&decoder.lock);
+    return ok;
+}
+
+// Called when the transmission of the data of a streaming job is aborted
+static void
+abandon_stream_job(DecodeJob *job) {
+    pthread_mutex_lock(&decoder.lock);
+    job->orphaned = true; job->input_complete = true;
+    // a queued job is freed by the worker that consumes it
+    bool queued = job->queued;
+    pthread_mutex_unlock(&decoder.lock);
+    if (!queued) free_decode_job(job);
+}
+
+// Transmitted data that has not yet been consumed by a decoder
+static size_t
+pending_decode_input(const GraphicsManager *self) {
+    const LoadData *ld = &self->currently_loading;
+    size_t ans = ld->buf_used;
+    if (ld->stream_job) {
+        pthread_mutex_lock(&decoder.lock);
+        ans += ld->stream_job->pending.used;
+        pthread_mutex_unlock(&decoder.lock);
+    }
+    return ans;
+}
+
+// Gives img the dimensions of the image being decoded by job, it is displayed
+// once the job is done, see apply_decoded_image()
+static void
+register_decode_job(GraphicsManager *self, Image *img, DecodeJob *job, const LoadData *ld) {
+    job->image_id = img->internal_id;
+    ensure_space_for(&self->decodes, items, DecodeJob*, self->decodes.count + 1, capacity, 8, false);
+    self->decodes.items[self->decodes.count++] = job;
+
+    img->width = job->width; img->height = job->height;
+    if (img->root_frame.id) remove_from_cache(self, (const ImageAndFrame){.image_id=img->internal_id, .frame_id=img->root_frame.id});
+    img->root_frame = (const Frame){
+        .id = ++img->frame_id_counter,
+        .is_opaque = ld->is_opaque,
+        .is_4byte_aligned = ld->is_4byte_aligned,
+        .width = job->width, .height = job->height,
+    };
+    img->root_frame_data_loaded = true;
+    img->decode_job = job;
+}
+
+// Hands the fully loaded data in currently_loading over to a worker thread if
+// it needs decoding and is large enough to make that worthwhile
+static bool
+start_async_decode(GraphicsManager *self, Image *img, const GraphicsCommand *g, const unsigned char transmission_type, const uint32_t data_fmt) {
+    LoadData *ld = &self->currently_loading;
+    DecodeJob *job = ld->stream_job;
+    if (job) {
+        // all the data has been handed to the worker, let it finish decoding
+        ld->stream_job = NULL;
+        register_decode_job(self, img, job, ld);
+        pthread_mutex_lock(&decoder.lock);
+        job->input_complete = true;
+        if (!job->queued) { job->queued = true; queue_decode_job_locked(job); }
+        pthread_mutex_unlock(&decoder.lock);
+        return true;
+    }
+    // the mapping can be evicted or rewritten by the client while a worker reads it
+    if (ld->mapped_file_is_borrowed) return false;
+    uint32_t width = ld->width, height = ld->height;
+    size_t decoded_sz = ld->data_sz;
+    switch (data_fmt) {
+        case PNG:
+            // compressed PNG data is rare, let the synchronous code deal with it
+            if (g->compressed || !png_dimensions(ld->buf ? ld->buf : ld->mapped_file, ld->buf ? ld->buf_used : ld->mapped_file_sz, &width, &height)) return false;
+            decoded_sz = (size_t)4 * width * height;
+            break;
+        case RGB: case RGBA:
+            if (g->compressed != 'z') return false;
+            break;
+        default: return false;
+    }
+    if (decoded_sz < ASYNC_DECODE_THRESHOLD) return false;
+    job = calloc(1, sizeof(DecodeJob));
+    if (!job) return false;
+    job->load_data = *ld;
+    ld->buf = NULL; ld->buf_used = 0; ld->buf_capacity = 0;
+    ld->mapped_file = NULL; ld->mapped_file_sz = 0; ld->png_decoder = NULL;
+    job->start_command = ld->start_command;
+    job->compressed = g->compressed; job->transmission_type = transmission_type; job->format = data_fmt;
+    job->width = width; job->height = height;
+    job->wakeup_main_loop = global_state.boss != NULL;
+    register_decode_job(self, img, job, ld);
+    queue_decode_job(job);
+    return true;
+}
+
+static const char* finish_command_response(const GraphicsCommand *g, bool data_loaded);
+
+static const char*
+apply_decoded_image(GraphicsManager *self, DecodeJob *job, bool *is_dirty) {
+    if (job->queued_response) return job->queued_response;
+    LoadData *ld = &job->load_data;
+    command_response[0] = 0;
+    if (!job->ok) memcpy(command_response, job->response, sizeof(command_response));
+    else {
+        size_t required_sz = (size_t)(ld->is_opaque ? 3 : 4) * job->width * job->height;
+        if (ld->width != job->width || ld->height != job->height || ld->data_sz != required_sz) set_command_failed_response(
+            "EINVAL", "Image dimensions: %ux%u do not match data size: %zu, expected size: %zu", ld->width, ld->height, ld->data_sz, required_sz);
+    }
+    Image *img = img_by_internal_id(self, job->image_id);
+    if (img && img->decode_job == job) {
+        img->decode_job = NULL;
+        if (!command_response[0] && !store_root_frame(self, img, ld->data, ld->data_sz)) {
+            if (PyErr_Occurred()) PyErr_Print();
+            set_command_failed_response("ENOSPC", "Failed to store image data in disk cache");
+        }
+        if (command_response[0]) remove_image(self, img);
+        else {
+            self->used_storage += ld->data_sz;
+            img->used_storage = ld->data_sz;
+            set_layers_dirty(self);
+        }
+        *is_dirty = true;
+    }
+    return finish_command_response(&job->start_command, !command_response[0]);
+}
+
+// Returns NULL if the response has to wait for the responses of earlier
+// commands whose images are still decoding
+static const char*
+queue_response_behind_decodes(GraphicsManager *self, const char *response) {
+    if (!response || !self->decodes.count) return response;
+    DecodeJob *job = calloc(1, sizeof(DecodeJob));
+    if (!job || !(job->queued_response = strdup(response))) { free(job); return response; }
+    // never seen by the workers, so no need for the lock
+    job->ok = true; job->done = true;
+    ensure_space_for(&self->decodes, items, DecodeJob*, self->decodes.count + 1, capacity, 8, false);
+    self->decodes.items[self->decodes.count++] = job;
+    return NULL;
+}
+
+bool
+grman_needs_decodes_finished(const GraphicsManager *self, const GraphicsCommand *g) {
+    if (!self->decodes.count) return false;
+    const Image *img = NULL;
+    switch (g->action) {
+        case 'f': case 'a': case 'c':
+            // these commands need the pixel data of images that might still be decoding
+        case 'd':
+            // and these can refer to any image, by id, number, position, etc.
+            return true;
+        case 'q':
+            return false;
+        case 'p':
+            img = g->id ? img_by_client_id(self, g->id) : (g->image_number ? img_by_client_number(self, g->image_number) : NULL);
+            break;
+        default:
+            // transmitting with an image number always creates a new image
+            if (g->id && !self->currently_loading.loading_for.image_id) img = img_by_client_id(self, g->id);
+            break;
+    }
+    // the command must see the result of the decode, including its failure
+    return img && img->decode_job;
+}
+
+bool
+grman_finish_decodes(GraphicsManager *self, bool wait, bool *is_dirty, void (*write_response)(void *data, const char *response), void *data) {
+    if (!self->decodes.count) return false;
+    size_t num_done = 0;
+    pthread_mutex_lock(&decoder.lock);
+    while (num_done < self->decodes.count) {
+        if (self->decodes.items[num_done]->done) num_done++;
+        else if (wait) pthread_cond_wait(&decoder.work_done, &decoder.lock);
+        else break;
+    }
+    pthread_mutex_unlock(&decoder.lock);
+    if (!num_done) return false;
+    self->context_made_current_for_this_command = false;
+    for (size_t i = 0; i < num_done; i++) {
+        DecodeJob *job = self->decodes.items[i];
+        const char *response = apply_decoded_image(self, job, is_dirty);
+        if (response) write_response(data, response);
+        free_decode_job(job);
+    }
+    self->decodes.count -= num_done;
+    memmove(self->decodes.items, self->decodes.items + num_done, sizeof(self->decodes.items[0]) * self->decodes.count);
+    if (self->used_storage > self->storage_limit) apply_storage_quota(self, self->storage_limit, 0);
+    return true;
+}
+
+static void
+orphan_decodes(GraphicsManager *self) {
+    pthread_mutex_lock(&decoder.lock);
+    for (size_t i = 0; i < self->decodes.count; i++) {
+        DecodeJob *job = self->decodes.items[i];
+        if (job->done) free_decode_job(job);
+        else job->orphaned = true;
+    }
+    pthread_mutex_unlock(&decoder.lock);
+    free(self->decodes.items); self->decodes.items = NULL;
+    self->decodes.count = 0; self->decodes.capacity = 0;
+}
+// }}}
+
 static Image*
 handle_add_command(GraphicsManager *self, const GraphicsCommand *g, const uint8_t *payload, bool *is_dirty, uint32_t iid, bool is_query) {
     bool existing, init_img = true;
@@ -741,7 +1508,7 @@ handle_add_command(GraphicsManager *self, const GraphicsCommand *g, const uint8_
                 iid = img->client_id;
             }
         }
-        img->atime = monotonic(); img->used_storage = 0;
+        touch_image(self, img);
         if (!initialize_load_data(self, g, img, tt, fmt, 0)) return NULL;
         self->currently_loading.start_command.id = iid;
     } else {
@@ -755,6 +1522,7 @@ handle_add_command(GraphicsManager *self, const GraphicsCommand *g, const uint8_
     img = load_image_data(self, img, g, tt, fmt, payload);
     if (!img || !self->currently_loading.loading_completed_successfully) return NULL;
         self->currently_loading.loading_for = (const ImageAndFrame){0};
+    if (!is_query && start_async_decode(self, img, g, tt, fmt)) return img;
     img = process_image_data(self, img, g, tt, fmt);
     if (!img) return NULL;
     size_t required_sz = (size_t)(self->currently_loading.is_opaque ? 3 : 4) * self->currently_loading.width * self->currently_loading.height;
@@ -770,11 +1538,10 @@ handle_add_command(GraphicsManager *self, const GraphicsCommand *g, const uint8_
             .width = img->width, .height = img->height,
         };
         if (!is_query) {
-            if (!add_to_cache(self, (const ImageAndFrame){.image_id = img->internal_id, .frame_id=img->root_frame.id}, self->currently_loading.data, self->currently_loading.data_sz)) {
+            if (!store_root_frame(self, img, self->currently_loading.data, self->currently_loading.data_sz)) {
                 if (PyErr_Occurred()) PyErr_Print();
                 ABRT("ENOSPC", "Failed to store image data in disk cache");
             }
-            upload_to_gpu(self, img, img->root_frame.is_opaque, img->root_frame.is_4byte_aligned, self->currently_loading.data);
             self->used_storage += required_sz;
             img->used_storage = required_sz;
         }
@@ -1021,7 +1788,8 @@ void grman_put_cell_image(GraphicsManager *self, uint32_t screen_row,
     // Create a real ref.
     ImageRef *real_ref = create_ref(img, &ref);
 
-    img->atime = monotonic();
+    touch_image(self, img);
+    if (self->used_storage > self->storage_limit) demote_images(self, self->storage_limit, img->internal_id);
     set_layers_dirty(self);
 
     update_src_rect(real_ref, img);
@@ -1116,7 +1884,7 @@ handle_put_command(GraphicsManager *self, const GraphicsCommand *g, Cursor *c, b
 
     *is_dirty = true;
     set_layers_dirty(self);
-    img->atime = monotonic();
+    touch_image(self, img);
     ref->src_x = g->x_offset; ref->src_y = g->y_offset; ref->src_width = g->width ? g->width : img->width; ref->src_height = g->height ? g->height : img->height;
     ref->src_width = MIN(ref->src_width, img->width - ((float)img->width > ref->src_x ? ref->src_x : (float)img->width));
     ref->src_height = MIN(ref->src_height, img->height - ((float)img->height > ref->src_y ? ref->src_y : (float)img->height));
@@ -1202,37 +1970,29 @@ resolve_parent_offset(const GraphicsManager *self, const ImageRef *ref, int32_t
 }
 
 
-bool
-grman_update_layers(GraphicsManager *self, unsigned int scrolled_by, float scroll_offset_lines, float screen_left, float screen_top, float dx, float dy, unsigned int num_cols, unsigned int num_rows, CellPixelSize cell) {
-    if (self->last_scrolled_by != scrolled_by || self->last_scroll_offset_lines != scroll_offset_lines) set_layers_dirty(self);
-    self->last_scrolled_by = scrolled_by;
-    self->last_scroll_offset_lines = scroll_offset_lines;
-    if (!self->layers_dirty) return false;
-    self->layers_dirty = false;
-    size_t i;
-    self->num_of_below_refs = 0;
-    self->num_of_negative_refs = 0;
-    self->num_of_positive_refs = 0;
+static void
+build_layout(GraphicsManager *self) {
+    const LayerGeometry *g = &self->layout.geometry;
     ImageRect r;
-    float screen_width = dx * num_cols, screen_height = dy * num_rows;
-    float screen_bottom = screen_top - screen_height;
-    float screen_width_px = num_cols * cell.width;
-    float screen_height_px = num_rows * cell.height;
-    float y0 = screen_top - dy * ((float)scrolled_by + scroll_offset_lines);
-
-    // Iterate over all visible refs and create render data
-    self->render_data.count = 0;
+    const float screen_width = g->dx * g->num_cols, screen_height = g->dy * g->num_rows;
+    const float screen_right = g->screen_left + screen_width;
+    const float screen_width_px = g->num_cols * g->cell.width;
+    const float screen_height_px = g->num_rows * g->cell.height;
+    const float y0 = g->screen_top, dx = g->dx, dy = g->dy;
+    self->layout.count = 0;
+    self->layout.has_child_refs = false;
 
     for (image_map_itr imgitr = vt_first(&self->images_by_internal_id); !vt_is_end(imgitr); ) {
         Image *img = imgitr.data->val;
-        bool was_drawn = img->is_drawn, ref_removed = false;
-        img->is_drawn = false;
+        bool ref_removed = false;
+        if (img->decode_job) { imgitr = vt_next(imgitr); continue; }  // no data to display yet
 
         for (ref_map_itr refitr = vt_first(&img->refs_by_internal_id); !vt_is_end(refitr); ) {
             ImageRef *ref = refitr.data->val;
             if (ref->is_virtual_ref) { refitr = vt_next(refitr); continue; }
             int32_t start_row = ref->start_row, start_column = ref->start_column;
             if (ref->parent.img) {
+                self->layout.has_child_refs = true;
                 bool has_virtual_ancestor;
                 if (!resolve_parent_offset(self, ref, &start_row, &start_column, &has_virtual_ancestor)) {
                     if (!has_virtual_ancestor) {
@@ -1242,62 +2002,111 @@ grman_update_layers(GraphicsManager *self, unsigned int scrolled_by, float scrol
                     continue;
                 }
             }
-            r.top = y0 - start_row * dy - dy * (float)ref->cell_y_offset / (float)cell.height;
-            r.left = screen_left + start_column * dx + dx * (float)ref->cell_x_offset / (float) cell.width;
+            r.top = y0 - start_row * dy - dy * (float)ref->cell_y_offset / (float)g->cell.height;
+            r.left = g->screen_left + start_column * dx + dx * (float)ref->cell_x_offset / (float)g->cell.width;
 
             int32_t nr = ref->num_rows, nc = ref->num_cols;
             if (nr) {
                 r.bottom = y0 - (start_row + nr) * dy;
-                if (nc) r.right = screen_left + (start_column + nc) * dx;
+                if (nc) r.right = g->screen_left + (start_column + nc) * dx;
                 else {
                     double height_px = (((double)r.top - r.bottom) / screen_height) * screen_height_px;
                     double width_px = height_px * ref->src_width / (double) ref->src_height;
                     r.right = r.left + (float)((width_px / screen_width_px) * screen_width);
                 }
             } else {
-                if (nc) r.right = screen_left + (start_column + nc) * dx;
+                if (nc) r.right = g->screen_left + (start_column + nc) * dx;
                 else r.right = r.left + screen_width * (float)ref->src_width / screen_width_px;
                 double width_px = (((double)r.right - r.left) / screen_width) * screen_width_px;
                 double height_px = width_px * ref->src_height / (double)ref->src_width;
                 r.bottom = r.top - (float)((height_px / screen_height_px) * screen_height);
             }
+            // Horizontal visibility does not depend on scrolling, so such refs can be dropped here
+            if (r.right <= g->screen_left || r.left >= screen_right) { refitr = vt_next(refitr); continue; }
 
-            if (r.top <= screen_bottom || r.bottom >= screen_top) { refitr = vt_next(refitr); continue; }  // not visible
-
-            if (ref->z_index < ((int32_t)INT32_MIN/2))
-                self->num_of_below_refs++;
-            else if (ref->z_index < 0)
-                self->num_of_negative_refs++;
-            else
-                self->num_of_positive_refs++;
-            ensure_space_for(&(self->render_data), item, ImageRenderData, self->render_data.count + 1, capacity, 64, true);
-            ImageRenderData *rd = self->render_data.item + self->render_data.count;
+            ensure_space_for(&(self->layout), items, ImageRenderData, self->layout.count + 1, capacity, 64, true);
+            ImageRenderData *rd = self->layout.items + self->layout.count++;
             zero_at_ptr(rd);
             rd->dest_rect = r; rd->src_rect = ref->src_rect;
-            self->render_data.count++;
             rd->z_index = ref->z_index; rd->image_id = img->internal_id; rd->ref_id = ref->internal_id;
-            rd->texture_id = texture_id_for_img(img);
-            img->is_drawn = true;
             refitr = vt_next(refitr);
         }
         if (ref_removed && !vt_size(&img->refs_by_internal_id)) {
             imgitr = remove_image_itr(self, imgitr);
             continue;
         }
-        if (img->is_drawn && !was_drawn && img->animation_state != ANIMATION_STOPPED && img->extra_framecnt && img->animation_duration) {
-            self->has_images_needing_animation = true;
-            global_state.check_for_active_animated_images = true;
-        }
         imgitr = vt_next(imgitr);
     }
-    if (!self->render_data.count) return false;
-    // Sort visible refs in draw order (z-index, img, ref)
+    // Sort refs in draw order (z-index, img, ref)
 #define lt(a, b) ( (a)->z_index < (b)->z_index || ((a)->z_index == (b)->z_index && ( \
                 (a)->image_id < (b)->image_id || ((a)->image_id == (b)->image_id && a->ref_id < b->ref_id))) )
-    QSORT(ImageRenderData, self->render_data.item, self->render_data.count, lt);
+    QSORT(ImageRenderData, self->layout.items, self->layout.count, lt);
 #undef lt
+    // set after the loop as remove_image_itr() invalidates the layout
+    self->layout.valid = true;
+    self->layout.needs_pruning = false;
+}
+
+static void
+prune_layout(GraphicsManager *self) {
+    // drop the entries of deleted refs, keeping the draw order of the rest
+    size_t count = 0;
+    Image *img = NULL;
+    for (size_t i = 0; i < self->layout.count; i++) {
+        const ImageRenderData *src = self->layout.items + i;
+        if (!img || img->internal_id != src->image_id) img = img_by_internal_id(self, src->image_id);
+        if (!img || !ref_by_internal_id(img, src->ref_id)) continue;
+        if (count != i) self->layout.items[count] = *src;
+        count++;
+    }
+    self->layout.count = count;
+    self->layout.needs_pruning = false;
+}
+
+static void
+cull_layout(GraphicsManager *self, unsigned int scrolled_by, float scroll_offset_lines) {
+    const LayerGeometry *g = &self->layout.geometry;
+    const float shift = -g->dy * ((float)scrolled_by + scroll_offset_lines);
+    const float screen_top = g->screen_top, screen_bottom = screen_top - g->dy * g->num_rows;
+    self->num_of_below_refs = 0;
+    self->num_of_negative_refs = 0;
+    self->num_of_positive_refs = 0;
+    self->render_data.count = 0;
+    iter_images(self) { Image *img = i.data->val; img->was_drawn = img->is_drawn; img->is_drawn = false; }
+
+    Image *img = NULL;
+    for (size_t i = 0; i < self->layout.count; i++) {
+        const ImageRenderData *src = self->layout.items + i;
+        const float top = src->dest_rect.top + shift, bottom = src->dest_rect.bottom + shift;
+        if (top <= screen_bottom || bottom >= screen_top) continue;  // not visible
+        if (!img || img->internal_id != src->image_id) img = img_by_internal_id(self, src->image_id);
+        if (!img) continue;
+        if (img->is_cold && self->disk_cache) touch_image(self, img);
+
+        if (src->z_index < ((int32_t)INT32_MIN/2))
+            self->num_of_below_refs++;
+        else if (src->z_index < 0)
+            self->num_of_negative_refs++;
+        else
+            self->num_of_positive_refs++;
+        ensure_space_for(&(self->render_data), item, ImageRenderData, self->render_data.count + 1, capacity, 64, true);
+        ImageRenderData *rd = self->render_data.item + self->render_data.count++;
+        *rd = *src;
+        rd->dest_rect.top = top; rd->dest_rect.bottom = bottom;
+        // textures are created lazily so pick up the current one rather than the one at layout time
+        rd->texture_id = texture_id_for_img(img);
+        if (!img->is_drawn) {
+            img->is_drawn = true;
+            if (!img->was_drawn && img->animation_state != ANIMATION_STOPPED && img->extra_framecnt && img->animation_duration) {
+                self->has_images_needing_animation = true;
+                global_state.check_for_active_animated_images = true;
+            }
+        }
+    }
+    // reloading cold images can push the hot tier over its limit
+    if (self->used_storage > self->storage_limit) demote_images(self, self->storage_limit, 0);
     // Calculate the group counts
-    i = 0;
+    size_t i = 0;
     while (i < self->render_data.count) {
         id_type num_identical = 1, image_id = self->render_data.item[i].image_id, start = i;
         while (++i < self->render_data.count) {
@@ -1308,7 +2117,26 @@ grman_update_layers(GraphicsManager *self, unsigned int scrolled_by, float scrol
             self->render_data.item[start++].group_count = num_identical--;
         }
     }
-    return true;
+}
+
+bool
+grman_update_layers(GraphicsManager *self, unsigned int scrolled_by, float scroll_offset_lines, float screen_left, float screen_top, float dx, float dy, unsigned int num_cols, unsigned int num_rows, CellPixelSize cell) {
+    // A change in scroll position alone only needs the existing layout to be culled again
+    if (self->last_scrolled_by != scrolled_by || self->last_scroll_offset_lines != scroll_offset_lines) self->layers_dirty = true;
+    self->last_scrolled_by = scrolled_by;
+    self->last_scroll_offset_lines = scroll_offset_lines;
+    const LayerGeometry geometry = {
+        .screen_left=screen_left, .screen_top=screen_top, .dx=dx, .dy=dy, .num_cols=num_cols, .num_rows=num_rows, .cell=cell};
+    if (memcmp(&geometry, &self->layout.geometry, sizeof(geometry)) != 0) {
+        self->layout.geometry = geometry;
+        set_layers_dirty(self);
+    }
+    if (!self->layers_dirty) return false;
+    self->layers_dirty = false;
+    if (!self->layout.valid) build_layout(self);
+    else if (self->layout.needs_pruning) prune_layout(self);
+    cull_layout(self, scrolled_by, scroll_offset_lines);
+    return self->render_data.count > 0;
 }
 
 // }}}
@@ -1357,24 +2185,6 @@ typedef struct {
     bool is_4byte_aligned, is_opaque;
 } CoalescedFrameData;
 
-static void
-blend_on_opaque(uint8_t *under_px, const uint8_t *over_px) {
-    const float alpha = (float)over_px[3] / 255.f;
-    const float alpha_op = 1.f - alpha;
-    for (unsigned i = 0; i < 3; i++) under_px[i] = (uint8_t)(over_px[i] * alpha + under_px[i] * alpha_op);
-}
-
-static void
-alpha_blend(uint8_t *dest_px, const uint8_t *src_px) {
-    if (src_px[3]) {
-        const float dest_a = (float)dest_px[3] / 255.f, src_a = (float)src_px[3] / 255.f;
-        const float alpha = src_a + dest_a * (1.f - src_a);
-        dest_px[3] = (uint8_t)(255 * alpha);
-        if (!dest_px[3]) { dest_px[0] = 0; dest_px[1] = 0; dest_px[2] = 0; return; }
-        for (unsigned i = 0; i < 3; i++) dest_px[i] = (uint8_t)((src_px[i] * src_a + dest_px[i] * dest_a * (1.f - src_a))/alpha);
-    }
-}
-
 typedef struct {
     bool needs_blending;
     uint32_t over_px_sz, under_px_sz;
@@ -1383,12 +2193,13 @@ typedef struct {
 } ComposeData;
 
 #define COPY_RGB under_px[0] = over_px[0]; under_px[1] = over_px[1]; under_px[2] = over_px[2];
+// blending is only needed when the over pixels have an alpha channel
 #define COPY_PIXELS \
     if (d.needs_blending) { \
         if (d.under_px_sz == 3) { \
-            ROW_ITER PIX_ITER blend_on_opaque(under_px, over_px); }} \
+            ROW_ITER blend_rgba_onto_rgb(under_row, over_row, ROW_WIDTH); } \
         } else { \
-            ROW_ITER PIX_ITER alpha_blend(under_px, over_px); }} \
+            ROW_ITER blend_rgba_onto_rgba(under_row, over_row, ROW_WIDTH); } \
         } \
     } else { \
         if (d.under_px_sz == 4) { \
@@ -1419,7 +2230,9 @@ compose_rectangles(const ComposeData d, uint8_t *under_data, const uint8_t *over
 #define PIX_ITER for (unsigned x = 0; x < min_width; x++) { \
         uint8_t *under_px = under_row + (d.under_px_sz * x); \
         const uint8_t *over_px = over_row + (d.over_px_sz * x);
+#define ROW_WIDTH min_width
     COPY_PIXELS
+#undef ROW_WIDTH
 #undef PIX_ITER
 #undef ROW_ITER
 }
@@ -1440,7 +2253,9 @@ compose(const ComposeData d, uint8_t *under_data, const uint8_t *over_data) {
 #define PIX_ITER for (unsigned x = 0; x < min_row_sz; x++) { \
         uint8_t *under_px = under_row + (d.under_px_sz * x); \
         const uint8_t *over_px = over_row + (d.over_px_sz * x);
+#define ROW_WIDTH min_row_sz
     COPY_PIXELS
+#undef ROW_WIDTH
 #undef COPY_RGB
 #undef PIX_ITER
 #undef ROW_ITER
@@ -1492,13 +2307,108 @@ get_coalesced_frame_data_standalone(const Image *img, const Frame *f, uint8_t *f
 }
 
 
+// Coalesced frame cache {{{
+// Coalescing a frame means reading and blending every frame in its reference
+// chain, so the results are kept in an LRU cache. During playback the frame
+// being coalesced is usually based on the previously shown frame, which is
+// then in the cache, making each animation tick cost a single blend
+// regardless of the length of the chain. Intermediate results of long chains
+// are also cached as key frames.
+
+#define MAX_CACHED_COALESCED_FRAMES 64u
+#define MAX_COALESCED_FRAMES_CACHE_SIZE (64u * 1024u * 1024u)
+#define COALESCED_KEY_FRAME_INTERVAL 4u
+
+struct CachedCoalescedFrame {
+    id_type image_id;
+    uint32_t frame_id;
+    CoalescedFrameData data;
+    size_t sz;
+    uint64_t last_used;
+};
+
+static size_t
+coalesced_frame_size(const Image *img, const CoalescedFrameData *d) {
+    return (size_t)img->width * img->height * (d->is_opaque ? 3 : 4);
+}
+
+static void
+remove_cached_coalesced_frame(GraphicsManager *self, size_t i) {
+    CachedCoalescedFrame *c = self->coalesced_frames.items + i;
+    free(c->data.buf);
+    self->coalesced_frames.total_size -= c->sz;
+    remove_i_from_array(self->coalesced_frames.items, i, self->coalesced_frames.count);
+}
+
+static void
+forget_coalesced_frames(GraphicsManager *self, const Image *img) {
+    for (size_t i = self->coalesced_frames.count; i-- > 0;) {
+        if (self->coalesced_frames.items[i].image_id == img->internal_id) remove_cached_coalesced_frame(self, i);
+    }
+}
+
+static void
+free_coalesced_frames(GraphicsManager *self) {
+    while (self->coalesced_frames.count) remove_cached_coalesced_frame(self, self->coalesced_frames.count - 1);
+    free(self->coalesced_frames.items);
+    zero_at_ptr(&self->coalesced_frames);
+}
+
+// Returns a copy of the cached coalesced data for the frame, if any
 static CoalescedFrameData
-get_coalesced_frame_data_impl(GraphicsManager *self, Image *img, const Frame *f, unsigned count) {
+cached_coalesced_frame(GraphicsManager *self, const Image *img, const Frame *f) {
     CoalescedFrameData ans = {0};
-    if (count > 32) return ans;  // prevent stack overflows, infinite recursion
+    for (size_t i = 0; i < self->coalesced_frames.count; i++) {
+        CachedCoalescedFrame *c = self->coalesced_frames.items + i;
+        if (c->image_id == img->internal_id && c->frame_id == f->id) {
+            if ((ans.buf = malloc(c->sz))) {
+                memcpy(ans.buf, c->data.buf, c->sz);
+                ans.is_opaque = c->data.is_opaque; ans.is_4byte_aligned = c->data.is_4byte_aligned;
+                c->last_used = ++self->coalesced_frames.tick;
+            }
+            break;
+        }
+    }
+    return ans;
+}
+
+static void
+cache_coalesced_frame(GraphicsManager *self, const Image *img, const Frame *f, const CoalescedFrameData *d) {
+    const size_t sz = coalesced_frame_size(img, d);
+    if (sz > MAX_COALESCED_FRAMES_CACHE_SIZE / 4) return;
+    for (size_t i = 0; i < self->coalesced_frames.count; i++) {
+        CachedCoalescedFrame *c = self->coalesced_frames.items + i;
+        if (c->image_id == img->internal_id && c->frame_id == f->id) { c->last_used = ++self->coalesced_frames.tick; return; }
+    }
+    while (self->coalesced_frames.count && (
+        self->coalesced_frames.count >= MAX_CACHED_COALESCED_FRAMES || self->coalesced_frames.total_size + sz > MAX_COALESCED_FRAMES_CACHE_SIZE)) {
+        size_t lru = 0;
+        for (size_t i = 1; i < self->coalesced_frames.count; i++) {
+            if (self->coalesced_frames.items[i].last_used < self->coalesced_frames.items[lru].last_used) lru = i;
+        }
+        remove_cached_coalesced_frame(self, lru);
+    }
+    uint8_t *buf = malloc(sz);
+    if (!buf) return;
+    memcpy(buf, d->buf, sz);
+    ensure_space_for(&self->coalesced_frames, items, CachedCoalescedFrame, self->coalesced_frames.count + 1, capacity, 8, false);
+    self->coalesced_frames.items[self->coalesced_frames.count++] = (CachedCoalescedFrame){
+        .image_id=img->internal_id, .frame_id=f->id, .sz=sz, .last_used=++self->coalesced_frames.tick,
+        .data={.buf=buf, .is_opaque=d->is_opaque, .is_4byte_aligned=d->is_4byte_aligned},
+    };
+    self->coalesced_frames.total_size += sz;
+}
+// }}}
+
+static CoalescedFrameData
+get_coalesced_frame_data_impl(GraphicsManager *self, Image *img, const Frame *f, unsigned count) {
+    CoalescedFrameData ans = cached_coalesced_frame(self, img, f);
+    if (ans.buf || count > 32) return ans;  // prevent stack overflows, infinite recursion
     size_t frame_data_sz; void *frame_data;
     ImageAndFrame key = {.image_id = img->internal_id, .frame_id = f->id};
-    if (!read_from_cache(self, key, &frame_data, &frame_data_sz)) return ans;
+    if (img->shared && f->id == img->root_frame.id) {
+        if (!read_shared_image_data(img->shared, &frame_data, &frame_data_sz)) return ans;
+    } else if (!read_from_cache(self, key, &frame_data, &frame_data_sz)) return ans;
     if (!f->base_frame_id) return get_coalesced_frame_data_standalone(img, f, frame_data);
     Frame *base = frame_for_id(img, f->base_frame_id);
     if (!base) { free(frame_data); return ans; }
@@ -1513,12 +2423,15 @@ get_coalesced_frame_data_impl(GraphicsManager *self, Image *img, const Frame *f,
     };
     compose(d, base_data.buf, frame_data);
     free(frame_data);
+    if (count && count % COALESCED_KEY_FRAME_INTERVAL == 0) cache_coalesced_frame(self, img, f, &base_data);
     return base_data;
 }
 
 static CoalescedFrameData
 get_coalesced_frame_data(GraphicsManager *self, Image *img, const Frame *f) {
-    return get_coalesced_frame_data_impl(self, img, f, 0);
+    CoalescedFrameData ans = get_coalesced_frame_data_impl(self, img, f, 0);
+    if (ans.buf && img->extra_framecnt) cache_coalesced_frame(self, img, f, &ans);
+    return ans;
 }
 
 static void
@@ -1540,6 +2453,22 @@ update_current_frame(GraphicsManager *self, Image *img, const CoalescedFrameData
     img->current_frame_shown_at = monotonic();
 }
 
+// Marks the image as the most recently used one in the hot tier, reloading its
+// texture if it was in the cold tier
+static void
+touch_image(GraphicsManager *self, Image *img) {
+    img->atime = monotonic();
+    lru_unlink(self, img);
+    if (img->is_cold) {
+        img->is_cold = false;
+        self->cold_storage -= MIN(self->cold_storage, img->used_storage);
+        self->used_storage += img->used_storage;
+        if (!img->texture) img->texture = img->shared ? incref_texture_ref(img->shared->texture) : new_texture_ref();
+        if (img->root_frame_data_loaded && !img->texture->id && self->disk_cache) update_current_frame(self, img, NULL);
+    }
+    lru_append(&self->hot_images, img);
+}
+
 static bool
 reference_chain_too_large(Image *img, const Frame *frame) {
     uint32_t limit = img->width * img->height * 2;
@@ -1556,6 +2485,7 @@ reference_chain_too_large(Image *img, const Frame *frame) {
 static Image*
 handle_animation_frame_load_command(GraphicsManager *self, GraphicsCommand *g, Image *img, const uint8_t *payload, bool *is_dirty) {
     uint32_t frame_number = g->frame_number, fmt = g->format ? g->format : RGBA;
+    if (!unshare_image(self, img)) ABRT("ENOSPC", "Failed to store image data in disk cache");
     if (!frame_number || frame_number > img->extra_framecnt + 2) frame_number = img->extra_framecnt + 2;
     bool is_new_frame = frame_number == img->extra_framecnt + 2;
     g->frame_number = frame_number;
@@ -1581,9 +2511,10 @@ handle_animation_frame_load_command(GraphicsManager *self, GraphicsCommand *g, I
         ABRT("EINVAL", "Frame width %u larger than image width: %u", load_data->width, img->width);
     if (load_data->height > img->height)
         ABRT("EINVAL", "Frame height %u larger than image height: %u", load_data->height, img->height);
-    if (is_new_frame && cache_size(self) + load_data->data_sz > self->storage_limit * 5) {
+    const size_t max_cache_size = self->storage_limit * 5 + self->cold_storage_limit;
+    if (is_new_frame && cache_size(self) + load_data->data_sz > max_cache_size) {
         remove_images(self, trim_predicate, img->internal_id);
-        if (cache_size(self) + load_data->data_sz > self->storage_limit * 5)
+        if (cache_size(self) + load_data->data_sz > max_cache_size)
             ABRT("ENOSPC", "Cache size exceeded cannot add new frames");
     }
 
@@ -1651,6 +2582,8 @@ handle_animation_frame_load_command(GraphicsManager *self, GraphicsCommand *g, I
         if (g->gap != 0) change_gap(img, frame, transmitted_frame.gap);
         CoalescedFrameData cfd = get_coalesced_frame_data(self, img, frame);
         if (!cfd.buf) ABRT("EINVAL", "No data associated with frame number: %u", frame_number);
+        // frames based on this frame change as well
+        forget_coalesced_frames(self, img);
         frame->alpha_blend = false; frame->base_frame_id = 0; frame->bgcolor = 0;
         frame->is_opaque = cfd.is_opaque; frame->is_4byte_aligned = cfd.is_4byte_aligned;
         frame->x = 0; frame->y = 0; frame->width = img->width; frame->height = img->height;
@@ -1695,6 +2628,7 @@ handle_delete_frame_command(GraphicsManager *self, const GraphicsCommand *g, boo
     if (!frame_number) frame_number = 1;
     if (!img->extra_framecnt) return g->delete_action == 'F' ? img : NULL;
     *is_dirty = true;
+    forget_coalesced_frames(self, img);
     ImageAndFrame key = {.image_id=img->internal_id};
     bool remove_root = frame_number == 1;
     uint32_t removed_gap = 0;
@@ -1817,6 +2751,10 @@ cfd_free(CoalescedFrameData *p) { free((p)->buf); p->buf = NULL; }
 
 static void
 handle_compose_command(GraphicsManager *self, bool *is_dirty, const GraphicsCommand *g, Image *img) {
+    if (!unshare_image(self, img)) {
+        set_command_failed_response("ENOSPC", "Failed to store image data in disk cache");
+        return;
+    }
     Frame *src_frame = frame_for_number(img, g->frame_number);
     if (!src_frame) {
         set_command_failed_response("ENOENT", "No source frame number %u exists in image id: %u\n", g->frame_number, img->client_id);
@@ -1866,6 +2804,7 @@ handle_compose_command(GraphicsManager *self, bool *is_dirty, const GraphicsComm
         .stride = img->width
     };
     compose_rectangles(d, dest_data.buf, src_data.buf);
+    forget_coalesced_frames(self, img);
     const ImageAndFrame key = { .image_id = img->internal_id, .frame_id = dest_frame->id };
     if (!add_to_cache(self, key, dest_data.buf, ((size_t)(dest_data.is_opaque ? 3 : 4)) * img->width * img->height)) {
         if (PyErr_Occurred()) PyErr_Print();
@@ -1902,7 +2841,7 @@ filter_refs(GraphicsManager *self, const void* data, bool free_images, bool (*fi
         for (ref_map_itr ri = vt_first(&img->refs_by_internal_id); !vt_is_end(ri); ) { ImageRef *ref = ri.data->val;
             if (filter_func(ref, img, data, cell)) {
                 ri = remove_ref_itr(img, ri);
-                set_layers_dirty(self);
+                set_refs_removed(self);
                 matched = true;
             } else ri = vt_next(ri);
         }
@@ -2133,7 +3072,7 @@ handle_delete_command(GraphicsManager *self, const GraphicsCommand *g, Cursor *c
                 for (ref_map_itr ri = vt_first(&img->refs_by_internal_id); !vt_is_end(ri); ) { ImageRef *ref = ri.data->val;
                     if (!g->placement_id || g->placement_id == ref->client_id) {
                         ri = remove_ref_itr(img, ri);
-                        set_layers_dirty(self);
+                        set_refs_removed(self);
                     } else ri = vt_next(ri);
                 }
                 if (!vt_size(&img->refs_by_internal_id) && (g->delete_action == 'N' || img->client_id == 0)) remove_image(self, img);
@@ -2198,7 +3137,7 @@ grman_handle_command(GraphicsManager *self, const GraphicsCommand *g, const uint
 
     if (g->id && g->image_number) {
         set_command_failed_response("EINVAL", "Must not specify both image id and image number");
-        return finish_command_response(g, false);
+        return queue_response_behind_decodes(self, finish_command_response(g, false));
     }
 
     switch(g->action) {
@@ -2214,6 +3153,7 @@ grman_handle_command(GraphicsManager *self, const GraphicsCommand *g, const uint
             GraphicsCommand *lg = &self->currently_loading.start_command;
             if (g->quiet) lg->quiet = g->quiet;
             if (is_query) ret = finish_command_response(&(const GraphicsCommand){.id=q_iid, .quiet=g->quiet}, image != NULL);
+            else if (image && image->decode_job) image->decode_job->start_command.quiet = lg->quiet;  // responded to once decoded
             else ret = finish_command_response(lg, image != NULL);
             if (lg->action == 'T' && image && image->root_frame_data_loaded) handle_put_command(self, lg, c, is_dirty, image, cell);
             id_type added_image_id = image ? image->internal_id : 0;
@@ -2255,6 +3195,8 @@ grman_handle_command(GraphicsManager *self, const GraphicsCommand *g, const uint
             uint32_t image_id = handle_put_command(self, g, c, is_dirty, NULL, cell);
             GraphicsCommand rg = *g; rg.id = image_id;
             ret = finish_command_response(&rg, true);
+            // placing a cold image makes it hot, and the most recently used
+            if (self->used_storage > self->storage_limit) apply_storage_quota(self, self->storage_limit, self->hot_images.newest ? self->hot_images.newest->internal_id : 0);
             break;
         }
         case 'd':
@@ -2278,7 +3220,7 @@ grman_handle_command(GraphicsManager *self, const GraphicsCommand *g, const uint
             REPORT_ERROR("Unknown graphics command action: %c", g->action);
             break;
     }
-    return ret;
+    return queue_response_behind_decodes(self, ret);
 }
 
 
@@ -2310,11 +3252,12 @@ image_as_dict(GraphicsManager *self, Image *img) {
     }
     CoalescedFrameData cfd = get_coalesced_frame_data(self, img, &img->root_frame);
     if (!cfd.buf) { PyErr_SetString(PyExc_RuntimeError, "Failed to get data for root frame"); return NULL; }
-    PyObject *ans = Py_BuildValue("{sI sI sI sI sI sI sI " "sO sI sO " "sI sI sI " "sI sy# sN}",
+    PyObject *ans = Py_BuildValue("{sI sI sI sI sI sI sI sI " "sO sI sO sO " "sI sI sI " "sI sy# sN}",
         "texture_id", texture_id_for_img(img), U(client_id), U(width), U(height), U(internal_id),
         "refs.count", (unsigned int)vt_size(&img->refs_by_internal_id), U(client_number),
+        "shared_refcount", img->shared ? img->shared->refcnt : 0u,
 
-        B(root_frame_data_loaded), U(animation_state), "is_4byte_aligned", img->root_frame.is_4byte_aligned ? Py_True : Py_False,
+        B(root_frame_data_loaded), U(animation_state), "is_4byte_aligned", img->root_frame.is_4byte_aligned ? Py_True : Py_False, B(is_cold),
 
         U(current_frame_index), "root_frame_gap", img->root_frame.gap, U(current_frame_index),
 
@@ -2399,14 +3342,24 @@ get_image_count(GraphicsManager *self, void* closure UNUSED) {
     return PyLong_FromSize_t(vt_size(&self->images_by_internal_id));
 }
 
+static PyObject*
+get_pending_decode_input(GraphicsManager *self, void* closure UNUSED) {
+    return PyLong_FromSize_t(pending_decode_input(self));
+}
+
 static PyGetSetDef getsets[] = {
     {"image_count", (getter)get_image_count, NULL, NULL, NULL},
+    {"pending_decode_input", (getter)get_pending_decode_input, NULL, NULL, NULL},
     {NULL},
 };
 
 static PyMemberDef members[] = {
     {"storage_limit", T_PYSSIZET, offsetof(GraphicsManager, storage_limit), 0, "storage_limit"},
+    {"cold_storage_limit", T_PYSSIZET, offsetof(GraphicsManager, cold_storage_limit), 0, "cold_storage_limit"},
+    {"used_storage", T_PYSSIZET, offsetof(GraphicsManager, used_storage), READONLY, "used_storage"},
+    {"cold_storage", T_PYSSIZET, offsetof(GraphicsManager, cold_storage), READONLY, "cold_storage"},
     {"disk_cache", T_OBJECT_EX, offsetof(GraphicsManager, disk_cache), READONLY, "disk_cache"},
+    {"coalesced_frames_cached", T_PYSSIZET, offsetof(GraphicsManager, coalesced_frames.count), READONLY, "coalesced_frames_cached"},
     {NULL},
 };
 
@@ -2463,6 +3416,7 @@ init_graphics(PyObject *module) {
     if (PyModule_AddFunctions(module, module_methods) != 0) return false;
     if (PyModule_AddIntMacro(module, IMAGE_PLACEHOLDER_CHAR) != 0) return false;
     Py_INCREF(&GraphicsManager_Type);
+    register_at_exit_cleanup_func(GRAPHICS_CLEANUP_FUNC, finalize_shared_images);
     return true;
 }
 
@@ -69,6 +69,12 @@ typedef struct {
     id_type internal_id;
 } ImageRef;
 
+typedef struct {
+    float screen_left, screen_top, dx, dy;
+    unsigned int num_cols, num_rows;
+    CellPixelSize cell;
+} LayerGeometry;
+
 typedef struct {
     uint32_t gap, id, width, height, x, y, base_frame_id, bgcolor;
     bool is_opaque, is_4byte_aligned, alpha_blend;
@@ -85,9 +91,18 @@ typedef struct TextureRef {
 #define VAL_TY ImageRef*
 #include "kitty-verstable.h"
 
-typedef struct {
+typedef struct DecodeJob DecodeJob;
+typedef struct SharedImageData SharedImageData;
+typedef struct PersistentShm PersistentShm;
+typedef struct CachedCoalescedFrame CachedCoalescedFrame;
+
+typedef struct Image {
     uint32_t client_id, client_number, width, height;
     TextureRef *texture;
+    // Non-NULL while the root frame data is being decoded in a worker thread
+    DecodeJob *decode_job;
+    // Non-NULL when the root frame data and texture are shared with identical images
+    SharedImageData *shared;
     id_type internal_id;
 
     bool root_frame_data_loaded;
@@ -98,13 +113,21 @@ typedef struct {
     size_t extra_framecnt;
     monotonic_t atime;
     size_t used_storage;
-    bool is_drawn;
+    bool is_drawn, was_drawn;
+    // Cold images have no texture, their data is only in the disk cache
+    bool is_cold;
+    // Neighbours in the least recently used list of the tier the image is in
+    struct { struct Image *prev, *next; } lru;
     AnimationState animation_state;
     uint32_t max_loops, current_loop;
     monotonic_t current_frame_shown_at;
     ref_map refs_by_internal_id;
 } Image;
 
+typedef struct {
+    Image *oldest, *newest;
+} ImageLRUList;
+
 typedef struct {
     id_type image_id;
     uint32_t frame_id;
@@ -116,6 +139,8 @@ typedef struct {
 
     uint8_t *mapped_file;
     size_t mapped_file_sz;
+    // true when mapped_file points into a persistent shared memory mapping owned by the GraphicsManager
+    bool mapped_file_is_borrowed;
 
     size_t data_sz;
     uint8_t *data;
@@ -124,6 +149,13 @@ typedef struct {
     uint32_t width, height;
     GraphicsCommand start_command;
     ImageAndFrame loading_for;
+    // decodes directly transmitted PNG data chunk by chunk as it arrives
+    struct png_decoder *png_decoder;
+    // decodes the directly transmitted data of large PNG images chunk by chunk
+    // in a worker thread as it arrives
+    DecodeJob *stream_job;
+    // number of bytes fed to png_decoder or stream_job
+    size_t streamed_sz;
 } LoadData;
 
 #define NAME image_map
@@ -134,23 +166,51 @@ typedef struct {
 typedef struct {
     PyObject_HEAD
 
-    size_t storage_limit;
+    // Limits on the total data size of images in the hot and cold storage tiers
+    size_t storage_limit, cold_storage_limit;
     LoadData currently_loading;
     id_type image_id_counter;
     struct {
         size_t count, capacity;
         ImageRenderData *item;
     } render_data;
+    // All displayable refs in draw order, positioned as if scrolled_by were
+    // zero. Rebuilt only when refs are added or moved, deleted refs are just
+    // pruned from it and scrolling just culls it against the viewport.
+    struct {
+        ImageRenderData *items;
+        size_t count, capacity;
+        bool valid, needs_pruning, has_child_refs;
+        LayerGeometry geometry;
+    } layout;
     bool layers_dirty;
     // The number of images below MIN_ZINDEX / 2, then the number of refs between MIN_ZINDEX / 2 and -1 inclusive, then the number of refs above 0 inclusive.
     size_t num_of_below_refs, num_of_negative_refs, num_of_positive_refs;
     unsigned int last_scrolled_by;
     float last_scroll_offset_lines;
-    size_t used_storage;
+    size_t used_storage, cold_storage;
+    // Images in each storage tier, least recently used first
+    ImageLRUList hot_images, cold_images;
     PyObject *disk_cache;
     bool has_images_needing_animation, context_made_current_for_this_command;
     id_type window_id;
     image_map images_by_internal_id;
+    // Decodes started by this manager, in the order their commands were received
+    struct {
+        DecodeJob **items;
+        size_t count, capacity;
+    } decodes;
+    // Shared memory objects that stay mapped across t=S transmissions, most recently used last
+    struct {
+        PersistentShm *items;
+        size_t count, capacity;
+    } persistent_shm;
+    // Recently used fully coalesced animation frames
+    struct {
+        CachedCoalescedFrame *items;
+        size_t count, capacity, total_size;
+        uint64_t tick;
+    } coalesced_frames;
 } GraphicsManager;
 #else
 typedef struct {int x;} *GraphicsManager;
@@ -220,3 +280,5 @@ void grman_mark_layers_dirty(GraphicsManager *self);
 void grman_set_window_id(GraphicsManager *self, id_type id);
 bool grman_has_images(GraphicsManager *self);
 GraphicsRenderData grman_render_data(GraphicsManager *self);
+bool grman_needs_decodes_finished(const GraphicsManager *self, const GraphicsCommand *g);
+bool grman_finish_decodes(GraphicsManager *self, bool wait, bool *is_dirty, void (*write_response)(void *data, const char *response), void *data);
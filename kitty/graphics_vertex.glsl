@@ -1,2 +1,4 @@
-uniform vec4 src_rect, dest_rect;
+uniform vec4 src_rects[{GRAPHICS_BATCH_SIZE}], dest_rects[{GRAPHICS_BATCH_SIZE}];
+#define src_rect src_rects[gl_InstanceID]
+#define dest_rect dest_rects[gl_InstanceID]
 #pragma kitty_include_shader <blit_common.glsl>
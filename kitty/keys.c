@@ -591,8 +591,14 @@ SingleKey_replace(SingleKey *self, PyObject *args, PyObject *kw) {
     return (PyObject*)ans;
 }
 
+static PyObject*
+SingleKey_reduce(SingleKey *self, PyObject *args UNUSED) {
+    return Py_BuildValue("O(kOK)", Py_TYPE(self), (unsigned long)self->key.mods, self->key.is_native ? Py_True : Py_False, (unsigned long long)self->key.key);
+}
+
 static PyMethodDef SingleKey_methods[] = {
     {"_replace", (PyCFunction)(void (*) (void))SingleKey_replace, METH_VARARGS | METH_KEYWORDS, ""},
+    {"__reduce__", (PyCFunction)SingleKey_reduce, METH_NOARGS, ""},
     {"resolve_kitty_mod", (PyCFunction)SingleKey_resolve_kitty_mod, METH_O, ""},
     {NULL}  /* Sentinel */
 };
@@ -0,0 +1,294 @@
+/*
+ * spawn-helper.c
+ * Copyright (C) 2026 Kovid Goyal <kovid at kovidgoyal.net>
+ *
+ * Distributed under terms of the GPL3 license.
+ */
+
+// A tiny program that kitty runs via posix_spawn() to launch child processes.
+// It performs the parts of child setup that posix_spawn() cannot: changing
+// the working directory with a fallback, creating a new session, acquiring
+// the controlling terminal, closing inherited fds and waiting for kitty to
+// signal that the terminal is ready. It then execs the actual child. It must
+// not link against libpython so that it is as cheap as possible to exec.
+//
+// Usage: kitty-spawn-helper cwd tty_name ready_fd preserved_fds kitten_exe exe argv0 [args...]
+// preserved_fds is a comma separated list of fds to not close, it may be empty.
+// stdin/stdout/stderr, signal dispositions, the signal mask and the
+// environment must already be setup by the caller.
+//
+// On Linux it can also run as a zygote with: kitty-spawn-helper --zygote fd
+// In this mode it reads launch requests from the socket fd (see
+// spawn-helper.h) and launches each child with clone(CLONE_PARENT) from its
+// own small address space, so the children are still children of kitty.
+
+#define _GNU_SOURCE
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+#include "spawn-helper.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/select.h>
+#include <termios.h>
+#ifdef __linux__
+#include <sched.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#endif
+
+static void
+write_to_stderr(const char *text) {
+    size_t sz = strlen(text);
+    size_t written = 0;
+    while(written < sz) {
+        ssize_t amt = write(2, text + written, sz - written);
+        if (amt == 0) break;
+        if (amt < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            break;
+        }
+        written += amt;
+    }
+}
+
+#define exit_on_err(m) { write_to_stderr(m); write_to_stderr(": "); write_to_stderr(strerror(errno)); write_to_stderr("\n"); exit(EXIT_FAILURE); }
+
+static int
+parse_fd(const char *src, char **end) {
+    errno = 0;
+    long ans = strtol(src, end, 10);
+    if (errno || *end == src || ans < 0 || ans >= FD_SETSIZE) return -1;
+    return (int)ans;
+}
+
+static void
+close_fd(int fd) {
+    while (close(fd) != 0 && errno == EINTR);
+}
+
+// args is: cwd tty_name ready_fd preserved_fds kitten_exe exe argv0 [args...]
+static int
+setup_and_exec(char *args[]) {
+    const char *cwd = args[0], *tty_name = args[1], *kitten_exe = args[4], *exe = args[5];
+    char *end;
+    int ready_fd = parse_fd(args[2], &end);
+    fd_set preserved_fds; FD_ZERO(&preserved_fds);
+    for (const char *p = args[3]; *p; p = *end ? end + 1 : end) {
+        int fd = parse_fd(p, &end);
+        if (fd < 0 || (*end && *end != ',')) { write_to_stderr("Invalid list of preserved fds\n"); return EXIT_FAILURE; }
+        FD_SET(fd, &preserved_fds);
+    }
+
+    if (chdir(cwd) != 0) {
+        if (access(".", X_OK) != 0) { // existing cwd does not exist or dont have permissions for it
+            if (chdir("/") != 0) {} // ignore failure to chdir to /
+        }
+    };
+    if (setsid() == -1) exit_on_err("setsid() in child process failed");
+
+    // Establish the controlling terminal (see man 7 credentials)
+    int tfd;
+    while ((tfd = open(tty_name, O_RDWR | O_CLOEXEC)) == -1 && errno == EINTR);
+    if (tfd == -1) exit_on_err("Failed to open controlling terminal");
+    // On BSD open() does not establish the controlling terminal
+    if (ioctl(tfd, TIOCSCTTY, 0) == -1) exit_on_err("Failed to set controlling terminal with TIOCSCTTY");
+    close_fd(tfd);
+
+    // Close any extra fds inherited from parent, this includes the write end
+    // of the ready pipe, if it was not already close on exec
+    for (int c = 3; c < 256; c++) { if (c != ready_fd && !FD_ISSET(c, &preserved_fds)) close_fd(c); }
+
+    // Wait for READY_SIGNAL which indicates kitty has setup the screen object
+    if (ready_fd > -1) {
+        char data;
+        while (read(ready_fd, &data, 1) == -1 && (errno == EINTR || errno == EAGAIN));
+        close_fd(ready_fd);
+    }
+
+    execvp(exe, args + 6);
+    // Report the failure and exec kitten instead, so that we are not left
+    // with a spawned but not exec'ed process
+    write_to_stderr("Failed to launch child: ");
+    write_to_stderr(exe);
+    write_to_stderr("\nWith error: ");
+    write_to_stderr(strerror(errno));
+    write_to_stderr("\n");
+    execlp(kitten_exe, "kitten", "__hold_till_enter__", NULL);
+    return EXIT_FAILURE;
+}
+
+#ifdef __linux__
+// Zygote {{{
+typedef struct LaunchRequest {
+    ZygoteRequest header;
+    int fds[ZYGOTE_MAX_FDS];
+    char *payload, **args, **env;
+} LaunchRequest;
+
+static bool
+read_fully(int fd, void *buf, size_t sz) {
+    char *p = buf;
+    while (sz) {
+        ssize_t n = read(fd, p, sz);
+        if (n < 0) { if (errno == EINTR || errno == EAGAIN) continue; return false; }
+        if (n == 0) return false;
+        p += n; sz -= n;
+    }
+    return true;
+}
+
+static bool
+write_fully(int fd, const void *buf, size_t sz) {
+    const char *p = buf;
+    while (sz) {
+        ssize_t n = write(fd, p, sz);
+        if (n < 0) { if (errno == EINTR || errno == EAGAIN) continue; return false; }
+        if (n == 0) return false;
+        p += n; sz -= n;
+    }
+    return true;
+}
+
+static void
+free_request(LaunchRequest *r) {
+    for (unsigned i = 0; i < r->header.num_fds && i < ZYGOTE_MAX_FDS; i++) if (r->fds[i] > -1) close_fd(r->fds[i]);
+    free(r->payload); free(r->args);
+    memset(r, 0, sizeof(*r));
+}
+
+// Returns 1 on success, 0 on EOF and -1 on a malformed request
+static int
+read_request(int sock, LaunchRequest *r) {
+    memset(r, 0, sizeof(*r));
+    for (unsigned i = 0; i < ZYGOTE_MAX_FDS; i++) r->fds[i] = -1;
+    union { char buf[CMSG_SPACE(sizeof(int) * ZYGOTE_MAX_FDS)]; struct cmsghdr align; } control;
+    struct iovec iov = {.iov_base=&r->header, .iov_len=sizeof(r->header)};
+    struct msghdr msg = {.msg_iov=&iov, .msg_iovlen=1, .msg_control=control.buf, .msg_controllen=sizeof(control.buf)};
+    ssize_t n;
+    while ((n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) < 0 && (errno == EINTR || errno == EAGAIN));
+    if (n <= 0) return 0;
+    unsigned num_received = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++) {
+            int fd; memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (num_received < ZYGOTE_MAX_FDS) r->fds[num_received++] = fd;
+            else close_fd(fd);
+        }
+    }
+    if ((size_t)n < sizeof(r->header) && !read_fully(sock, (char*)&r->header + n, sizeof(r->header) - n)) return 0;
+    if (r->header.num_fds != num_received || r->header.argc < 7 || r->header.payload_size > 64u * 1024u * 1024u) return -1;
+    if (!(r->payload = malloc(r->header.payload_size + 1)) || !(r->args = calloc(r->header.argc + r->header.envc + 2, sizeof(char*)))) return -1;
+    if (!read_fully(sock, r->payload, r->header.payload_size)) return 0;
+    r->payload[r->header.payload_size] = 0;
+    char *p = r->payload, *limit = r->payload + r->header.payload_size;
+    for (uint32_t i = 0; i < r->header.argc + r->header.envc; i++) {
+        if (p >= limit) return -1;
+        // the env array is after the NULL terminator of the args array
+        r->args[i < r->header.argc ? i : i + 1] = p;
+        p += strlen(p) + 1;
+    }
+    r->env = r->args + r->header.argc + 1;
+    return 1;
+}
+
+static int
+run_request(void *x) {
+    LaunchRequest *r = x;
+    // Move the received fds above all target fds so that placing them at
+    // their targets cannot clobber one that has not been placed yet
+    int min_fd = 3;
+    for (unsigned i = 0; i < r->header.num_fds; i++) if (r->header.targets[i] >= min_fd) min_fd = r->header.targets[i] + 1;
+    for (unsigned i = 0; i < r->header.num_fds; i++) {
+        if ((r->fds[i] = fcntl(r->fds[i], F_DUPFD_CLOEXEC, min_fd)) < 0) exit_on_err("Failed to duplicate fd in zygote child");
+    }
+    for (unsigned i = 0; i < r->header.num_fds; i++) {
+        int ret;
+        while ((ret = dup2(r->fds[i], r->header.targets[i])) < 0 && errno == EINTR);
+        if (ret < 0) exit_on_err("dup2() failed in zygote child");
+    }
+    extern char **environ;
+    environ = r->env;
+    return setup_and_exec(r->args);
+}
+
+static void
+close_all_fds_except(int keep) {
+    // The zygote lives as long as kitty, so it must not keep open the fds it
+    // happened to inherit, such as the pty and remote control socket of the
+    // window whose launch started it, otherwise they would never be closed.
+#ifdef SYS_close_range
+    if ((keep <= 3 || syscall(SYS_close_range, 3u, (unsigned)keep - 1, 0u) == 0) && syscall(SYS_close_range, (unsigned)keep + 1, ~0u, 0u) == 0) return;
+#endif
+    DIR *d = opendir("/proc/self/fd");
+    if (d) {
+        const int dfd = dirfd(d);
+        struct dirent *e;
+        while ((e = readdir(d))) {
+            char *end;
+            errno = 0;
+            long fd = strtol(e->d_name, &end, 10);
+            if (errno || end == e->d_name || *end || fd < 3 || fd == keep || fd == dfd) continue;
+            close_fd((int)fd);
+        }
+        closedir(d);
+        return;
+    }
+    long max_fd = sysconf(_SC_OPEN_MAX);
+    if (max_fd < 0) max_fd = FD_SETSIZE;
+    for (int c = 3; c < max_fd; c++) { if (c != keep) close_fd(c); }
+}
+
+static int
+zygote_main(int sock) {
+    close_all_fds_except(sock);
+    if (fcntl(sock, F_SETFD, FD_CLOEXEC) != 0) exit_on_err("Failed to set close on exec on zygote socket");
+    // 256KB is plenty for setup_and_exec() and execvp()
+    static char child_stack[256 * 1024] __attribute__((aligned(16)));
+    LaunchRequest r;
+    while (true) {
+        int ret = read_request(sock, &r);
+        if (ret == 0) { free_request(&r); break; }
+        int32_t reply = -EINVAL;
+        if (ret > 0) {
+            // CLONE_PARENT makes the child a child of kitty so that kitty can
+            // wait for it and gets SIGCHLD when it exits
+            pid_t pid = clone(run_request, child_stack + sizeof(child_stack), CLONE_PARENT | SIGCHLD, &r);
+            reply = pid < 0 ? -errno : pid;
+        }
+        free_request(&r);
+        // After a malformed request the stream cannot be trusted so quit
+        if (!write_fully(sock, &reply, sizeof(reply)) || ret < 0) break;
+    }
+    return 0;
+}
+// }}}
+#endif
+
+int
+main(int argc, char *argv[]) {
+    if (argc == 3 && strcmp(argv[1], "--zygote") == 0) {
+#ifdef __linux__
+        char *end;
+        int sock = parse_fd(argv[2], &end);
+        if (sock < 0) { write_to_stderr("Invalid zygote socket fd\n"); return EXIT_FAILURE; }
+        return zygote_main(sock);
+#else
+        write_to_stderr("The zygote is only supported on Linux\n");
+        return EXIT_FAILURE;
+#endif
+    }
+    if (argc < 8) {
+        write_to_stderr("Usage: kitty-spawn-helper cwd tty_name ready_fd preserved_fds kitten_exe exe argv0 [args...]\n");
+        return EXIT_FAILURE;
+    }
+    return setup_and_exec(argv + 1);
+}
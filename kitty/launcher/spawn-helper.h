@@ -0,0 +1,26 @@
+/*
+ * spawn-helper.h
+ * Copyright (C) 2026 Kovid Goyal <kovid at kovidgoyal.net>
+ *
+ * Distributed under terms of the GPL3 license.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// The protocol used to send launch requests to the spawn helper running as a
+// zygote. kitty writes a ZygoteRequest over a stream socket with the fds
+// attached as SCM_RIGHTS, in the same order as targets. It is followed by
+// payload_size bytes containing argc NUL terminated strings, which are the
+// command line arguments of the spawn helper without argv[0], followed by
+// envc NUL terminated strings, which are the environment of the child. The
+// child gets the fds at the numbers in targets. The zygote replies with an
+// int32_t that is either the pid of the child or a negated errno.
+
+#define ZYGOTE_MAX_FDS 64u
+
+typedef struct ZygoteRequest {
+    uint32_t payload_size, argc, envc, num_fds;
+    int32_t targets[ZYGOTE_MAX_FDS];
+} ZygoteRequest;
@@ -2,23 +2,29 @@
 # License: GPLv3 Copyright: 2020, Kovid Goyal <kovid at kovidgoyal.net>
 
 
+from importlib import import_module
+
 from .base import Layout
-from .grid import Grid
-from .splits import Splits
-from .stack import Stack
-from .tall import Fat, Tall
-from .vertical import Horizontal, Vertical
-
-all_layouts: dict[str, type[Layout]] = {
-    Stack.name: Stack,
-    Tall.name: Tall,
-    Fat.name: Fat,
-    Vertical.name: Vertical,
-    Horizontal.name: Horizontal,
-    Grid.name: Grid,
-    Splits.name: Splits,
+
+# Layouts are imported on first use, so that only the layouts actually used
+# are loaded at startup. Maps layout name to (module, class name).
+all_layouts: dict[str, tuple[str, str]] = {
+    'stack': ('stack', 'Stack'),
+    'tall': ('tall', 'Tall'),
+    'fat': ('tall', 'Fat'),
+    'vertical': ('vertical', 'Vertical'),
+    'horizontal': ('vertical', 'Horizontal'),
+    'grid': ('grid', 'Grid'),
+    'splits': ('splits', 'Splits'),
 }
 
+
+def layout_class(name: str) -> type[Layout]:
+    module, cls = all_layouts[name]
+    ans: type[Layout] = getattr(import_module(f'{__package__}.{module}'), cls)
+    return ans
+
+
 KeyType = tuple[str, int, int, str]
 
 
@@ -36,7 +42,7 @@ def __call__(
         ans = create_layout_object_for.cache.get(key)
         if ans is None:
             name, layout_opts = name.partition(':')[::2]
-            ans = create_layout_object_for.cache[key] = all_layouts[name](
+            ans = create_layout_object_for.cache[key] = layout_class(name)(
                 os_window_id, tab_id, layout_opts)
         return ans
 
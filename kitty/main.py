@@ -60,6 +60,7 @@
 from .os_window_size import edge_spacing, initial_window_size_func
 from .session import create_sessions, get_os_window_sizing_data
 from .shaders import CompileError, load_shader_programs
+from .startup_profiler import mark as mark_startup_stage, report_after_first_frame
 from .types import LayerShellConfig
 from .utils import (
     cleanup_ssh_control_masters,
@@ -305,8 +306,11 @@ def _run_app(opts: Options, args: CLIOptions, bad_lines: Sequence[BadLine] = (),
                     pre_show_callback,
                     args.title or appname, winname,
                     wincls, wstate, load_all_shaders, disallow_override_title=bool(args.title), layer_shell_config=run_app.layer_shell_config, x=pos_x, y=pos_y)
+        mark_startup_stage('OS window created')
         boss = Boss(opts, args, cached_values, global_shortcuts, talk_fd)
         boss.start(window_id, startup_sessions)
+        mark_startup_stage('first child started')
+        report_after_first_frame()
         if args.debug_font_fallback:
             dump_font_debug()
         if bad_lines or boss.misc_config_errors:
@@ -544,6 +548,7 @@ def kitty_main(called_from_panel: bool = False) -> None:
         if not called_from_panel:
             cli_flags = getattr(sys, 'kitty_run_data', {}).get('cli_flags', None)
         usage = msg = appname = None
+    mark_startup_stage('kitty imported')
     cli_opts, rest = parse_args(args=args, result_class=CLIOptions, usage=usage, message=msg, appname=appname, preparsed_from_c=cli_flags)
     if getattr(sys, 'cmdline_args_for_open', False):
         setattr(sys, 'cmdline_args_for_open', rest)
@@ -566,6 +571,7 @@ def kitty_main(called_from_panel: bool = False) -> None:
         return
     bad_lines: list[BadLine] = []
     opts = create_opts(cli_opts, accumulate_bad_lines=bad_lines)
+    mark_startup_stage('options read')
     if is_quick_access_terminal_app:
         opts.macos_hide_from_tasks = True
     setup_environment(opts, cli_opts)
@@ -588,6 +594,7 @@ def kitty_main(called_from_panel: bool = False) -> None:
     # kitty can handle them. See https://github.com/kovidgoyal/kitty/issues/4636
     mask_kitty_signals_process_wide()
     init_glfw(opts, cli_opts.debug_keyboard, cli_opts.debug_rendering)
+    mark_startup_stage('glfw initialized')
     try:
         with setup_profiling():
             # Avoid needing to launch threads to reap zombies
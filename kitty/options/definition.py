@@ -1068,6 +1068,19 @@
 scrolling. However, it limits the rendering speed to the refresh rate of your
 monitor. With a very high speed mouse/high keyboard repeat rate, you may notice
 some slight input latency. If so, set this to :code:`no`.
+'''
+    )
+
+opt('image_cold_storage_limit', '1024',
+    option_type='positive_int', ctype='uint',
+    long_text='''
+The maximum amount of image data (in MB) that each window keeps on disk for
+images evicted from the in-memory image storage quota of
+:doc:`graphics-protocol`. Such images are reloaded transparently when next
+displayed. Once this limit is exceeded, the least recently used of them are
+deleted. A value of zero deletes evicted images immediately. Note that on config
+reload if this is changed it will only affect newly created windows, not
+existing ones.
 '''
     )
 egr()  # }}}
@@ -3732,6 +3745,15 @@
 will not work in programs run in this session.
 ''')
 
+opt('spawn_zygote', 'no', option_type='to_bool', long_text='''
+Use a small helper process that is started once and launches all new windows.
+Since the helper has a much smaller address space than kitty, launching from
+it is faster and does not depend on how much memory kitty is using or on how
+busy kitty is. The launched programs are still children of kitty. Only
+supported on Linux, ignored elsewhere. Changing this option by reloading the
+config will only affect newly created windows.
+''')
+
 opt('+menu_map', '',
     option_type='menu_map', add_to_default=False, ctype='!menu_map',
     long_text='''
@@ -1029,6 +1029,9 @@ def forward_stdio(self, val: str, ans: dict[str, typing.Any]) -> None:
     def hide_window_decorations(self, val: str, ans: dict[str, typing.Any]) -> None:
         ans['hide_window_decorations'] = hide_window_decorations(val)
 
+    def image_cold_storage_limit(self, val: str, ans: dict[str, typing.Any]) -> None:
+        ans['image_cold_storage_limit'] = positive_int(val)
+
     def inactive_border_color(self, val: str, ans: dict[str, typing.Any]) -> None:
         ans['inactive_border_color'] = to_color(val)
 
@@ -1298,6 +1301,9 @@ def single_window_margin_width(self, val: str, ans: dict[str, typing.Any]) -> No
     def single_window_padding_width(self, val: str, ans: dict[str, typing.Any]) -> None:
         ans['single_window_padding_width'] = optional_edge_width(val)
 
+    def spawn_zygote(self, val: str, ans: dict[str, typing.Any]) -> None:
+        ans['spawn_zygote'] = to_bool(val)
+
     def startup_session(self, val: str, ans: dict[str, typing.Any]) -> None:
         ans['startup_session'] = config_or_absolute_path(val)
 
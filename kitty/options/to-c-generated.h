@@ -759,6 +759,19 @@ convert_from_opts_sync_to_monitor(PyObject *py_opts, Options *opts) {
     Py_DECREF(ret);
 }
 
+static void
+convert_from_python_image_cold_storage_limit(PyObject *val, Options *opts) {
+    opts->image_cold_storage_limit = PyLong_AsUnsignedLong(val);
+}
+
+static void
+convert_from_opts_image_cold_storage_limit(PyObject *py_opts, Options *opts) {
+    PyObject *ret = PyObject_GetAttrString(py_opts, "image_cold_storage_limit");
+    if (ret == NULL) return;
+    convert_from_python_image_cold_storage_limit(ret, opts);
+    Py_DECREF(ret);
+}
+
 static void
 convert_from_python_enable_audio_bell(PyObject *val, Options *opts) {
     opts->enable_audio_bell = PyObject_IsTrue(val);
@@ -1566,6 +1579,8 @@ convert_opts_from_python_opts(PyObject *py_opts, Options *opts) {
     if (PyErr_Occurred()) return false;
     convert_from_opts_sync_to_monitor(py_opts, opts);
     if (PyErr_Occurred()) return false;
+    convert_from_opts_image_cold_storage_limit(py_opts, opts);
+    if (PyErr_Occurred()) return false;
     convert_from_opts_enable_audio_bell(py_opts, opts);
     if (PyErr_Occurred()) return false;
     convert_from_opts_visual_bell_duration(py_opts, opts);
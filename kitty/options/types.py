@@ -366,6 +366,7 @@
     'foreground',
     'forward_stdio',
     'hide_window_decorations',
+    'image_cold_storage_limit',
     'inactive_border_color',
     'inactive_tab_background',
     'inactive_tab_font_style',
@@ -446,6 +447,7 @@
     'show_hyperlink_targets',
     'single_window_margin_width',
     'single_window_padding_width',
+    'spawn_zygote',
     'startup_session',
     'strip_trailing_spaces',
     'symbol_map',
@@ -576,6 +578,7 @@ class Options:
     foreground: Color = Color(221, 221, 221)
     forward_stdio: bool = False
     hide_window_decorations: int = 0
+    image_cold_storage_limit: int = 1024
     inactive_border_color: Color = Color(204, 204, 204)
     inactive_tab_background: Color = Color(153, 153, 153)
     inactive_tab_font_style: tuple[bool, bool] = (False, False)
@@ -649,6 +652,7 @@ class Options:
     show_hyperlink_targets: bool = False
     single_window_margin_width: FloatEdges = FloatEdges(left=-1.0, top=-1.0, right=-1.0, bottom=-1.0)
     single_window_padding_width: FloatEdges = FloatEdges(left=-1.0, top=-1.0, right=-1.0, bottom=-1.0)
+    spawn_zygote: bool = False
     startup_session: str | None = None
     strip_trailing_spaces: choices_for_strip_trailing_spaces = 'never'
     sync_to_monitor: bool = True
@@ -202,8 +202,9 @@ static inline void parse_graphics_code(PS *self, uint8_t *parser_buf,
 
       case transmission_type: {
         g.transmission_type = parser_buf[pos++];
-        if (g.transmission_type != 'd' && g.transmission_type != 'f' &&
-            g.transmission_type != 's' && g.transmission_type != 't') {
+        if (g.transmission_type != 'S' && g.transmission_type != 'd' &&
+            g.transmission_type != 'f' && g.transmission_type != 's' &&
+            g.transmission_type != 't') {
           REPORT_ERROR("Malformed GraphicsCommand control block, unknown flag "
                        "value for transmission_type: 0x%x",
                        g.transmission_type);
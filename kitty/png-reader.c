@@ -30,6 +30,21 @@ struct custom_error_handler {
     png_read_data *d;
 };
 
+struct png_decoder {
+    struct custom_error_handler eh;
+    png_read_data *d, stream_data;
+    png_structp png;
+    png_infop info;
+    int max_image_dimension;
+    cmsHPROFILE input_profile;
+    cmsHTRANSFORM colorspace_transform;
+    // used only for progressive decoding, where errors are reported once all data has been fed
+    png_error_handler_func report_error;
+    bool failed, finished;
+    const char *error_code;
+    char error_msg[256];
+};
+
 static void
 read_png_error_handler(png_structp png_ptr, png_const_charp msg) {
     struct custom_error_handler *eh;
@@ -44,36 +59,36 @@ read_png_warn_handler(png_structp UNUSED png_ptr, png_const_charp msg) {
     if (global_state.debug_rendering) log_error("libpng WARNING: %s", msg);
 }
 
-#define ABRT(code, msg) { if(d->err_handler) d->err_handler(d, #code, msg); goto err; }
+#define ABRT(code, msg) { if(d->err_handler) d->err_handler(d, #code, msg); return false; }
 
-void
-inflate_png_inner(png_read_data *d, const uint8_t *buf, size_t bufsz, int max_image_dimension) {
-    struct fake_file f = {.buf = buf, .sz = bufsz};
-    png_structp png = NULL;
-    png_infop info = NULL;
-    struct custom_error_handler eh = {.d = d};
-    png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &eh, read_png_error_handler, read_png_warn_handler);
-    if (!png) ABRT(ENOMEM, "Failed to create PNG read structure");
-    info = png_create_info_struct(png);
-    if (!info) ABRT(ENOMEM, "Failed to create PNG info structure");
-
-    if (setjmp(eh.jb)) goto err;
-
-    png_set_read_fn(png, &f, read_png_from_buffer);
-    png_read_info(png, info);
+static bool
+create_read_structs(png_decoder *s) {
+    png_read_data *d = s->d;
+    s->eh.d = d;
+    s->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, &s->eh, read_png_error_handler, read_png_warn_handler);
+    if (!s->png) ABRT(ENOMEM, "Failed to create PNG read structure");
+    s->info = png_create_info_struct(s->png);
+    if (!s->info) ABRT(ENOMEM, "Failed to create PNG info structure");
+    return true;
+}
+
+// Sets up the transforms to get 8-bit sRGB RGBA data out of libpng once the
+// image header has been read and allocates the output buffer
+static bool
+setup_decode(png_decoder *s) {
+    png_read_data *d = s->d;
+    png_structp png = s->png; png_infop info = s->info;
     png_byte color_type, bit_depth;
     d->width      = png_get_image_width(png, info);
     d->height     = png_get_image_height(png, info);
     // libpng uses too much memory for overly large images
-    if (d->width > max_image_dimension || d->height > max_image_dimension) {
+    if (d->width > s->max_image_dimension || d->height > s->max_image_dimension) {
         ABRT(ENOMEM, "PNG image is too large");
     }
     color_type = png_get_color_type(png, info);
     bit_depth  = png_get_bit_depth(png, info);
     double image_gamma;
     int intent;
-    cmsHPROFILE input_profile = NULL;
-    cmsHTRANSFORM colorspace_transform = NULL;
     if (png_get_sRGB(png, info, &intent)) {
         // do nothing since we output sRGB
     } else if (png_get_gAMA(png, info, &image_gamma)) {
@@ -85,14 +100,14 @@ inflate_png_inner(png_read_data *d, const uint8_t *buf, size_t bufsz, int max_im
         png_bytep profdata;
         png_uint_32 proflen;
         if (png_get_iCCP(png, info, &name, &compression_type, &profdata, &proflen) & PNG_INFO_iCCP) {
-            input_profile = cmsOpenProfileFromMem(profdata, proflen);
-            if (input_profile) {
+            s->input_profile = cmsOpenProfileFromMem(profdata, proflen);
+            if (s->input_profile) {
                 if (!srgb_profile) {
                     srgb_profile = cmsCreate_sRGBProfile();
                     if (!srgb_profile) ABRT(ENOMEM, "Out of memory allocating sRGB colorspace profile");
                 }
-                colorspace_transform = cmsCreateTransform(
-                    input_profile, TYPE_RGBA_8, srgb_profile, TYPE_RGBA_8, INTENT_PERCEPTUAL, 0);
+                s->colorspace_transform = cmsCreateTransform(
+                    s->input_profile, TYPE_RGBA_8, srgb_profile, TYPE_RGBA_8, INTENT_PERCEPTUAL, 0);
 
             }
         }
@@ -110,6 +125,7 @@ inflate_png_inner(png_read_data *d, const uint8_t *buf, size_t bufsz, int max_im
     if (color_type == PNG_COLOR_TYPE_RGB || color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_PALETTE) png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
 
     if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png);
+    png_set_interlace_handling(png);
     png_read_update_info(png, info);
 
     png_uint_32 rowbytes = png_get_rowbytes(png, info);
@@ -119,21 +135,122 @@ inflate_png_inner(png_read_data *d, const uint8_t *buf, size_t bufsz, int max_im
     d->row_pointers = malloc(d->height * sizeof(png_bytep));
     if (d->row_pointers == NULL) ABRT(ENOMEM, "Out of memory allocating row_pointers buffer for PNG");
     for (size_t i = 0; i < (size_t)d->height; i++) d->row_pointers[i] = d->decompressed + i * rowbytes * sizeof(png_byte);
-    png_read_image(png, d->row_pointers);
+    return true;
+}
+#undef ABRT
 
-    if (colorspace_transform) {
+static void
+finish_decode(png_decoder *s) {
+    png_read_data *d = s->d;
+    if (s->colorspace_transform) {
         for (int i = 0; i < d->height; i++) {
-            cmsDoTransform(colorspace_transform, d->row_pointers[i], d->row_pointers[i], d->width);
+            cmsDoTransform(s->colorspace_transform, d->row_pointers[i], d->row_pointers[i], d->width);
         }
-        cmsDeleteTransform(colorspace_transform);
     }
-    if (input_profile) cmsCloseProfile(input_profile);
-
     d->ok = true;
+}
+
+static void
+release_decoder(png_decoder *s) {
+    if (s->png) png_destroy_read_struct(&s->png, s->info ? &s->info : NULL, NULL);
+    s->png = NULL; s->info = NULL;
+    if (s->colorspace_transform) cmsDeleteTransform(s->colorspace_transform);
+    s->colorspace_transform = NULL;
+    if (s->input_profile) cmsCloseProfile(s->input_profile);
+    s->input_profile = NULL;
+}
+
+void
+inflate_png_inner(png_read_data *d, const uint8_t *buf, size_t bufsz, int max_image_dimension) {
+    struct fake_file f = {.buf = buf, .sz = bufsz};
+    png_decoder s = {.d = d, .max_image_dimension = max_image_dimension};
+    if (!create_read_structs(&s)) goto err;
+    if (setjmp(s.eh.jb)) goto err;
+
+    png_set_read_fn(s.png, &f, read_png_from_buffer);
+    png_read_info(s.png, s.info);
+    if (!setup_decode(&s)) goto err;
+    png_read_image(s.png, d->row_pointers);
+    finish_decode(&s);
 err:
-    if (png) png_destroy_read_struct(&png, info ? &info : NULL, NULL);
-    return;
+    release_decoder(&s);
+}
+
+// Progressive decoding {{{
+static void
+defer_error(png_read_data *d, const char *code, const char *msg) {
+    png_decoder *s = (png_decoder*)((char*)d - offsetof(png_decoder, stream_data));
+    if (!s->error_code) {
+        s->error_code = code;
+        snprintf(s->error_msg, sizeof(s->error_msg), "%s", msg);
+    }
+}
+
+static void
+progressive_info_callback(png_structp png, png_infop info UNUSED) {
+    png_decoder *s = png_get_progressive_ptr(png);
+    if (!setup_decode(s)) longjmp(s->eh.jb, 1);
+}
+
+static void
+progressive_row_callback(png_structp png, png_bytep new_row, png_uint_32 row_num, int pass UNUSED) {
+    png_decoder *s = png_get_progressive_ptr(png);
+    // new_row is NULL for rows that are unchanged in this pass of an interlaced image
+    if (new_row && row_num < (png_uint_32)s->d->height) png_progressive_combine_row(png, s->d->row_pointers[row_num], new_row);
+}
+
+static void
+progressive_end_callback(png_structp png, png_infop info UNUSED) {
+    png_decoder *s = png_get_progressive_ptr(png);
+    s->finished = true;
+}
+
+png_decoder*
+png_decoder_new(png_error_handler_func err_handler, int max_image_dimension) {
+    png_decoder *s = calloc(1, sizeof(png_decoder));
+    if (!s) return NULL;
+    s->d = &s->stream_data;
+    s->stream_data.err_handler = defer_error;
+    s->report_error = err_handler;
+    s->max_image_dimension = max_image_dimension;
+    if (create_read_structs(s)) png_set_progressive_read_fn(s->png, s, progressive_info_callback, progressive_row_callback, progressive_end_callback);
+    else s->failed = true;
+    return s;
+}
+
+bool
+png_decoder_feed(png_decoder *s, const uint8_t *buf, size_t sz) {
+    // Anything after the end of the image is ignored
+    if (s->failed || s->finished) return !s->failed;
+    if (setjmp(s->eh.jb)) {
+        s->failed = true;
+        release_decoder(s);
+        return false;
+    }
+    png_process_data(s->png, s->info, (png_bytep)buf, sz);
+    return true;
+}
+
+png_read_data*
+png_decoder_finish(png_decoder *s) {
+    png_read_data *d = s->d;
+    if (!s->failed && s->finished) finish_decode(s);
+    else if (s->report_error) {
+        if (s->error_code) s->report_error(d, s->error_code, s->error_msg);
+        else s->report_error(d, "ENODATA", "Incomplete PNG data");
+    }
+    release_decoder(s);
+    return d;
+}
+
+void
+png_decoder_free(png_decoder *s) {
+    if (!s) return;
+    release_decoder(s);
+    free(s->stream_data.decompressed); free(s->stream_data.row_pointers); free(s->stream_data.error.buf);
+    free(s);
 }
+// }}}
 
 // Structure to hold memory write state
 typedef struct {
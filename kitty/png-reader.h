@@ -28,5 +28,15 @@ typedef struct png_read_data {
 } png_read_data;
 
 void inflate_png_inner(png_read_data *d, const uint8_t *buf, size_t bufsz, int max_image_dimension);
+
+// Progressive decoding, PNG data is fed to the decoder as it arrives. Errors
+// are reported via err_handler only when png_decoder_finish() is called, which
+// returns the decoded data, whose ok field is true on success. The decoded data
+// is freed by png_decoder_free() unless the caller takes ownership of it.
+typedef struct png_decoder png_decoder;
+png_decoder* png_decoder_new(png_error_handler_func err_handler, int max_image_dimension);
+bool png_decoder_feed(png_decoder *s, const uint8_t *buf, size_t sz);
+png_read_data* png_decoder_finish(png_decoder *s);
+void png_decoder_free(png_decoder *s);
 const char* png_from_32bit_rgba(const char *data, size_t width, size_t height, size_t *out_size, bool flip_vertically);
 const char* png_from_24bit_rgb(const char *data, size_t width, size_t height, size_t *out_size, bool flip_vertically);
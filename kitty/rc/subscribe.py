@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+# License: GPLv3 Copyright: 2026, Kovid Goyal <kovid at kovidgoyal.net>
+
+from typing import TYPE_CHECKING
+
+from .base import (
+    MATCH_WINDOW_OPTION,
+    ArgsType,
+    Boss,
+    PayloadGetType,
+    PayloadType,
+    RCOptions,
+    RemoteCommand,
+    RemoteControlErrorWithoutTraceback,
+    ResponseType,
+    Window,
+)
+
+if TYPE_CHECKING:
+    from kitty.cli_stub import SubscribeRCOptions as CLIOptions
+
+
+event_names = (
+    'window_created', 'window_closed', 'focus', 'title', 'cwd', 'cmd_start', 'cmd_finish', 'bell', 'progress',
+)
+
+
+class Subscribe(RemoteCommand):
+
+    protocol_spec = __doc__ = '''
+    events/list.str: The names of the events to subscribe to, all events if empty
+    match/str: Only send events for windows matching this expression
+    '''
+
+    short_desc = 'Subscribe to events'
+    desc = (
+        'Keep the connection to kitty open and print out events as they happen, one JSON object per line.'
+        ' This is much more efficient than polling the output of :ref:`at-ls` to notice changes.'
+        ' Specify the names of the events you are interested in, or nothing to get all events.'
+        ' The available events are: :code:`window_created`, :code:`window_closed`, :code:`focus`, :code:`title`,'
+        ' :code:`cwd`, :code:`cmd_start`, :code:`cmd_finish`, :code:`bell` and :code:`progress`.'
+        ' The :code:`cwd` and :code:`cmd_*` events require :ref:`shell_integration`.'
+        ' Every event has the :code:`event`, :code:`window_id`, :code:`tab_id` and :code:`os_window_id` keys'
+        ' along with event specific data, such as :code:`title` for the title event.'
+        ' Only works when connecting to kitty via a socket, see :option:`kitten @ --to`.'
+        ' Use :option:`--match` to get events only for some windows, in which case, :code:`window_closed`'
+        ' is sent only for windows that matched the last time an event was generated for them.'
+        ' If events are not read fast enough, some are dropped, which is indicated by an :code:`events_dropped`'
+        ' event with the number of dropped events in :code:`count`.'
+    )
+    options_spec = MATCH_WINDOW_OPTION
+    args = RemoteCommand.Args(
+        spec='[EVENT ...]', json_field='events', special_parse='+events:setup_subscription(io_data, args, &payload)',
+        completion=RemoteCommand.CompletionSpec.from_string('type:keyword group:"Event" kwds:' + ','.join(event_names)),
+        args_choices=lambda: event_names)
+
+    def message_to_kitty(self, global_opts: RCOptions, opts: 'CLIOptions', args: ArgsType) -> PayloadType:
+        return {'events': args, 'match': opts.match}
+
+    def response_from_kitty(self, boss: Boss, window: Window | None, payload_get: PayloadGetType) -> ResponseType:
+        from kitty.remote_control import start_event_subscription
+        peer_id = payload_get('peer_id', missing=0)
+        if peer_id <= 0:
+            raise RemoteControlErrorWithoutTraceback('Subscribing to events is only supported over a socket, use --to')
+        events = frozenset(payload_get('events') or event_names)
+        if unknown := events - frozenset(event_names):
+            raise RemoteControlErrorWithoutTraceback(f'Unknown events: {", ".join(sorted(unknown))}')
+        return start_event_subscription(boss, peer_id, events, payload_get('match') or '', window.id if window else 0)
+
+
+subscribe = Subscribe()
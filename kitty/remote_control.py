@@ -28,6 +28,8 @@
     get_boss,
     get_options,
     monotonic,
+    peer_pending_output_size,
+    push_data_to_peer,
     read_command_response,
     send_data_to_peer,
 )
@@ -42,10 +44,112 @@
     from .window import Window
 
 
-def encode_response_for_peer(response: Any) -> bytes:
+class FramedResponse(dict[str, Any]):
+    # A response to a peer that asked for binary framing of responses, see
+    # send_framed_response_to_peer() in child-monitor.c. The data is still
+    # produced in full before any of it is sent.
+    pass
+
+
+def encode_response_for_peer(response: Any) -> bytes | tuple[bytes, str | bytes]:
+    if isinstance(response, FramedResponse) and isinstance(data := response.get('data'), (str, bytes)):
+        # The data is framed in chunks by the talk thread, without being
+        # JSON encoded
+        return json.dumps({k: v for k, v in response.items() if k != 'data'}).encode('utf-8'), data
     return b'\x1bP@kitty-cmd' + json.dumps(response).encode('utf-8') + b'\x1b\\'
 
 
+# Events are dropped while more than this many bytes sent to a subscriber
+# are still unread, so that a slow subscriber cannot make kitty use unbounded
+# memory
+MAX_PENDING_EVENT_BYTES = 1024 * 1024
+
+
+class EventSubscription:
+    # A peer subscribed to events with kitten @ subscribe
+    num_dropped_events: int = 0
+
+    def __init__(self, peer_id: int, events: frozenset[str], match: str = '', self_window_id: int = 0) -> None:
+        self.peer_id = peer_id
+        self.events = events
+        self.match = match
+        self.self_window_id = self_window_id
+        # Whether a window matched the last time it was checked, used for
+        # window_closed, since closed windows can no longer be matched
+        self.matched_windows: dict[int, bool] = {}
+
+    def wants(self, boss: BossType, event: str, window: 'Window') -> bool:
+        if not self.match:
+            return event in self.events
+        if event == 'window_closed':
+            return self.matched_windows.pop(window.id, False) and event in self.events
+        if event not in self.events and event != 'window_created':
+            return False
+        self_window = boss.window_id_map.get(self.self_window_id) if self.self_window_id else None
+        try:
+            matched = any(True for _ in boss.match_windows(self.match, self_window, (window,)))
+        except Exception:
+            matched = False
+        self.matched_windows[window.id] = matched
+        return matched and event in self.events
+
+
+def start_event_subscription(boss: BossType, peer_id: int, events: frozenset[str], match: str = '', self_window_id: int = 0) -> AsyncResponse:
+    # The subscribe command is answered immediately, the command itself is
+    # treated as asynchronous so that the peer is kept open for events till it
+    # closes the connection
+    boss.rc_event_subscriptions[peer_id] = EventSubscription(peer_id, events, match, self_window_id)
+    push_data_to_peer(peer_id, cast(bytes, encode_response_for_peer({'ok': True})))
+    return AsyncResponse()
+
+
+def send_rc_event(boss: BossType, event: str, window: 'Window', data: dict[str, Any]) -> None:
+    # Events are encoded once and pushed to every subscribed peer, so traffic
+    # is proportional to the number of changes
+    encoded = b''
+    for sub in tuple(boss.rc_event_subscriptions.values()):
+        if sub.wants(boss, event, window):
+            if peer_pending_output_size(sub.peer_id) > MAX_PENDING_EVENT_BYTES:
+                sub.num_dropped_events += 1
+                continue
+            if sub.num_dropped_events:
+                push_data_to_peer(sub.peer_id, cast(bytes, encode_response_for_peer({'ok': True, 'data': {
+                    'event': 'events_dropped', 'count': sub.num_dropped_events}})))
+                sub.num_dropped_events = 0
+            if not encoded:
+                payload = {'event': event, 'window_id': window.id, 'tab_id': window.tab_id, 'os_window_id': window.os_window_id}
+                payload.update(data)
+                encoded = cast(bytes, encode_response_for_peer({'ok': True, 'data': payload}))
+            push_data_to_peer(sub.peer_id, encoded)
+
+
+def decode_framed_response(data: bytes) -> dict[str, Any] | None:
+    # Returns None if data does not contain a complete framed response
+    response: dict[str, Any] | None = None
+    chunks: list[bytes] | None = None
+    pos = 0
+    while pos + 5 <= len(data):
+        ftype, sz = data[pos:pos+1], int.from_bytes(data[pos+1:pos+5], 'big')
+        payload = data[pos+5:pos+5+sz]
+        if len(payload) < sz:
+            break
+        pos += 5 + sz
+        if ftype == b'R':
+            response = json.loads(payload)
+        elif ftype == b'D':
+            # empty data is sent as a single empty D frame
+            if chunks is None:
+                chunks = []
+            chunks.append(payload)
+        elif ftype == b'E' and response is not None:
+            if chunks is not None:
+                response['data'] = b''.join(chunks).decode('utf-8')
+            return response
+        else:
+            raise ValueError(f'Invalid frame of type: {ftype!r} in remote control response')
+    return None
+
+
 def parse_cmd(serialized_cmd: memoryview, encryption_key: EllipticCurveKey) -> dict[str, Any]:
     # See https://github.com/python/cpython/issues/74379 for why we cant use
     # memoryview directly :((
@@ -248,7 +352,8 @@ def handle_cmd(
         if stream:
             return {'ok': True, 'stream': True}
         return ans
-    response: dict[str, Any] = {'ok': True}
+    response: dict[str, Any] = FramedResponse() if peer_id > 0 and cmd.get('binary_response') else {}
+    response['ok'] = True
     if ans is not None:
         response['data'] = ans
     if not no_response:
@@ -338,32 +443,37 @@ def send(self, data: bytes | Iterable[str | bytes]) -> None:
                     out.flush()
         self.socket.shutdown(socket.SHUT_WR)
 
-    def simple_recv(self, timeout: float) -> bytes:
+    def recv_response(self, timeout: float) -> dict[str, Any]:
         dcs = re.compile(br'\x1bP@kitty-cmd([^\x1b]+)\x1b\\')
         self.socket.settimeout(timeout)
         st = monotonic()
         with self.socket.makefile('rb') as src:
             data = src.read()
+        if data[:1] == b'R' and (response := decode_framed_response(data)) is not None:
+            return response
         m = dcs.search(data)
         if m is None:
             if monotonic() - st > timeout:
                 raise TimeoutError('Timed out while waiting to read cmd response')
             raise SocketClosed('Remote control connection was closed by kitty without any response being received')
-        return bytes(m.group(1))
+        return cast(dict[str, Any], json.loads(m.group(1)))
 
 
 class RCIO(TTYIO):
 
-    def simple_recv(self, timeout: float) -> bytes:
+    def recv_response(self, timeout: float) -> dict[str, Any]:
         ans: list[bytes] = []
         read_command_response(self.tty_fd, timeout, ans)
-        return b''.join(ans)
+        return cast(dict[str, Any], json.loads(b''.join(ans)))
 
 
 def do_io(
     to: str | None, original_cmd: dict[str, Any], no_response: bool, response_timeout: float, encrypter: 'CommandEncrypter'
 ) -> dict[str, Any]:
     payload = original_cmd.get('payload')
+    if to:
+        # responses over sockets can use binary framing, escape codes sent via the tty cannot
+        original_cmd['binary_response'] = True
     if not isinstance(payload, GeneratorType):
         send_data: bytes | Iterator[bytes] = encode_send(encrypter(original_cmd))
     else:
@@ -379,9 +489,7 @@ def send_generator() -> Iterator[bytes]:
         io.send(send_data)
         if no_response:
             return {'ok': True}
-        received = io.simple_recv(timeout=response_timeout)
-
-    return cast(dict[str, Any], json.loads(received.decode('ascii')))
+        return io.recv_response(timeout=response_timeout)
 
 
 cli_msg = (
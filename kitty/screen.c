@@ -675,6 +675,7 @@ dealloc(Screen* self) {
     free(self->as_ansi_buf.buf);
     free(self->last_rendered_window_char.canvas);
     free(self->extra_cursors.locations); free(self->paused_rendering.extra_cursors.locations);
+    free(self->row_extents.cells);
     if (self->lc) { cleanup_list_of_chars(self->lc); free(self->lc); self->lc = NULL; }
     Py_TYPE(self)->tp_free((PyObject*)self);
 } // }}}
@@ -1507,9 +1508,22 @@ screen_dirty_line_graphics(Screen *self, const unsigned int top, const unsigned
         grman_remove_cell_images(main_buf ? self->main_grman : self->alt_grman, top, bottom);
 }
 
+static void
+write_graphics_response(void *self, const char *response) {
+    write_escape_code_to_child(self, ESC_APC, response);
+}
+
+bool
+screen_finish_graphics_decodes(Screen *self, bool wait) {
+    bool main_finished = grman_finish_decodes(self->main_grman, wait, &self->is_dirty, write_graphics_response, self);
+    bool alt_finished = grman_finish_decodes(self->alt_grman, wait, &self->is_dirty, write_graphics_response, self);
+    return main_finished || alt_finished;
+}
+
 void
 screen_handle_graphics_command(Screen *self, const GraphicsCommand *cmd, const uint8_t *payload) {
     unsigned int x = self->cursor->x, y = self->cursor->y;
+    if (grman_needs_decodes_finished(self->grman, cmd)) grman_finish_decodes(self->grman, true, &self->is_dirty, write_graphics_response, self);
     const char *response = grman_handle_command(self->grman, cmd, payload, self->cursor, &self->is_dirty, self->cell_size);
     if (response != NULL) write_escape_code_to_child(self, ESC_APC, response);
     if (x != self->cursor->x || y != self->cursor->y) {
@@ -3149,10 +3163,13 @@ set_color_table_color(Screen *self, unsigned int code, PyObject *color) {
 void
 process_cwd_notification(Screen *self, unsigned int code, const char *data, size_t sz) {
     if (code == 7) {
+        // shells report the cwd at every prompt, only notify when it changes
+        if (self->last_reported_cwd && (size_t)PyBytes_GET_SIZE(self->last_reported_cwd) == sz && memcmp(PyBytes_AS_STRING(self->last_reported_cwd), data, sz) == 0) return;
         PyObject *x = PyBytes_FromStringAndSize(data, sz);
         if (x) {
             Py_CLEAR(self->last_reported_cwd);
             self->last_reported_cwd = x;
+            CALLBACK("cwd_changed", NULL);
         } else { PyErr_Clear(); }
     }  // we ignore OSC 6 document reporting as we dont have a use for it
 }
@@ -3357,16 +3374,67 @@ get_line_edge_colors(Screen *self, color_type *left, color_type *right) {
 }
 
 
+static bool
+ensure_row_extents(Screen *self, unsigned int render_lines) {
+    if (self->row_extents.render_lines != render_lines || self->row_extents.columns != self->columns) {
+        self->row_extents.cells_valid = false; self->row_extents.selection_valid = false;
+        if (render_lines > self->row_extents.capacity) {
+            free(self->row_extents.cells);
+            self->row_extents.cells = malloc(2u * render_lines * sizeof(index_type));
+            if (!self->row_extents.cells) {
+                self->row_extents.selection = NULL;
+                self->row_extents.capacity = 0; self->row_extents.render_lines = 0;
+                return false;
+            }
+            self->row_extents.selection = self->row_extents.cells + render_lines;
+            self->row_extents.capacity = render_lines;
+        }
+        self->row_extents.render_lines = render_lines; self->row_extents.columns = self->columns;
+    }
+    return self->row_extents.cells != NULL;
+}
+
+static index_type
+gpu_cells_extent(const GPUCell *cells, index_type xnum) {
+    while (xnum) {
+        const GPUCell *g = cells + xnum - 1;
+        const uint32_t bg_type = g->bg & 0xff;  // 1 is indexed and 2 is RGB, anything else is the default background
+        if (g->sprite_idx || bg_type == 1 || bg_type == 2 || g->attrs.decoration || g->attrs.reverse || g->attrs.strike || g->attrs.mark) break;
+        xnum--;
+    }
+    return xnum;
+}
+
 static void
-update_line_data(Line *line, unsigned int dest_y, uint8_t *data) {
+update_line_data(Screen *self, Line *line, unsigned int dest_y, uint8_t *data) {
     size_t base = sizeof(GPUCell) * dest_y * line->xnum;
     memcpy(data + base, line->gpu_cells, line->xnum * sizeof(GPUCell));
+    if (self->row_extents.cells_valid) self->row_extents.cells[dest_y] = gpu_cells_extent(line->gpu_cells, line->xnum);
 }
 
 static void
-update_line_data_blank(unsigned xnum, unsigned int dest_y, uint8_t *data) {
-    const size_t sz = xnum * sizeof(GPUCell);
+update_line_data_blank(Screen *self, unsigned int dest_y, uint8_t *data) {
+    const size_t sz = self->columns * sizeof(GPUCell);
     memset(data + sz * dest_y, 0, sz);
+    if (self->row_extents.cells_valid) self->row_extents.cells[dest_y] = 0;
+}
+
+void
+screen_cursor_span(Screen *self, index_type x, index_type y, index_type *num_cols, index_type *num_rows) {
+    // The number of cells covered by a cursor at the specified position
+    *num_cols = 1; *num_rows = 1;
+    if (x >= self->columns || y >= self->lines) return;
+    LineBuf *linebuf = self->paused_rendering.expires_at ? self->paused_rendering.linebuf : self->linebuf;
+    linebuf_init_line(linebuf, y);
+    const CPUCell *c = linebuf->line->cpu_cells + x;
+    if (c->is_multicell && !c->x && !c->y) { *num_cols = mcd_x_limit(c); *num_rows = c->scale; }
+}
+
+bool
+screen_row_extents(const Screen *self, unsigned int render_lines, const index_type **cells, const index_type **selection) {
+    if (!self->row_extents.cells_valid || !self->row_extents.selection_valid || self->row_extents.render_lines != render_lines || self->row_extents.columns != self->columns) return false;
+    *cells = self->row_extents.cells; *selection = self->row_extents.selection;
+    return true;
 }
 
 
@@ -3534,11 +3602,19 @@ screen_update_only_line_graphics_data(Screen *self) {
     }
 }
 
+static void
+start_row_extents(Screen *self, unsigned int render_lines) {
+    // rows that are not updated below are drawn in full
+    self->row_extents.cells_valid = ensure_row_extents(self, render_lines);
+    if (self->row_extents.cells_valid) for (unsigned y = 0; y < render_lines; y++) self->row_extents.cells[y] = self->columns;
+}
+
 void
 screen_update_cell_data(Screen *self, void *address, FONTS_DATA_HANDLE fonts_data, bool cursor_has_moved) {
     if (self->paused_rendering.expires_at) {
         if (!self->paused_rendering.cell_data_updated) {
             LineBuf *linebuf = self->paused_rendering.linebuf;
+            start_row_extents(self, render_lines_for_screen(self));
             for (index_type y = 0; y < self->lines; y++) {
                 linebuf_init_line(linebuf, y);
                 if (linebuf->line->attrs.has_dirty_text) {
@@ -3548,7 +3624,7 @@ screen_update_cell_data(Screen *self, void *address, FONTS_DATA_HANDLE fonts_dat
                             self->marker, linebuf->line, &self->as_ansi_buf);
                     linebuf_mark_line_clean(linebuf, y);
                 }
-                update_line_data(linebuf->line, y, address);
+                update_line_data(self, linebuf->line, y, address);
             }
         }
         return;
@@ -3562,6 +3638,7 @@ screen_update_cell_data(Screen *self, void *address, FONTS_DATA_HANDLE fonts_dat
     self->scroll_changed = false;
     const unsigned int render_lines = render_lines_for_screen(self);
     const int render_row_offset = pixel_scroll_enabled(self);
+    start_row_extents(self, render_lines);
     Line line = {.text_cache = self->text_cache};
     for (unsigned int render_row = 0; render_row < render_lines; render_row++) {
         const int virtual_y = (int)render_row - render_row_offset;
@@ -3569,7 +3646,7 @@ screen_update_cell_data(Screen *self, void *address, FONTS_DATA_HANDLE fonts_dat
         index_type lnum = 0;
         Line *linep = render_line_for_virtual_y(self, virtual_y, &line, &lnum, &is_history);
         if (linep == NULL) {
-            update_line_data_blank(self->columns, render_row, address);
+            update_line_data_blank(self, render_row, address);
             continue;
         }
         if (is_history) {
@@ -3592,7 +3669,7 @@ screen_update_cell_data(Screen *self, void *address, FONTS_DATA_HANDLE fonts_dat
                 linebuf_mark_line_clean(self->linebuf, lnum);
             }
         }
-        update_line_data(linep, render_row, address);
+        update_line_data(self, linep, render_row, address);
     }
     if (is_overlay_active && self->overlay_line.ynum + self->scrolled_by < self->lines) {
         if (self->overlay_line.is_dirty) {
@@ -3793,6 +3870,7 @@ screen_has_selection(Screen *self) {
 
 void
 screen_apply_selection(Screen *self, void *address_, size_t size) {
+    const size_t size_ = size;
     uint8_t *address = address_;
     memset(address, 0, size);
     const int offset = pixel_scroll_enabled(self);
@@ -3812,6 +3890,17 @@ screen_apply_selection(Screen *self, void *address_, size_t size) {
         if (ec->locations[i].cell < size) address[ec->locations[i].cell] |= (ec->locations[i].shape & 7) << 2;
     }
     ec->dirty = false;
+    const unsigned render_lines = render_lines_for_screen(self);
+    if (size_ / self->columns == render_lines && ensure_row_extents(self, render_lines)) {
+        address = address_;
+        for (unsigned y = 0; y < render_lines; y++) {
+            const uint8_t *row = address + y * self->columns;
+            index_type x = self->columns;
+            while (x && !row[x-1]) x--;
+            self->row_extents.selection[y] = x;
+        }
+        self->row_extents.selection_valid = true;
+    }
 }
 
 static index_type
@@ -4315,6 +4404,8 @@ update_overlay_line_data(Screen *self, uint8_t *data) {
     const int render_row_offset = pixel_scroll_enabled(self);
     const size_t base = sizeof(GPUCell) * (self->overlay_line.ynum + self->scrolled_by + render_row_offset) * self->columns;
     memcpy(data + base, self->overlay_line.gpu_cells, self->columns * sizeof(GPUCell));
+    const index_type y = self->overlay_line.ynum + self->scrolled_by + render_row_offset;
+    if (self->row_extents.cells_valid && y < self->row_extents.render_lines) self->row_extents.cells[y] = self->columns;
 }
 
 // }}}
@@ -5834,6 +5925,12 @@ dump_lines_with_attrs(Screen *self, PyObject *args) {
     Py_RETURN_NONE;
 }
 
+static PyObject*
+finish_graphics_decodes(Screen *self, PyObject *wait) {
+    if (screen_finish_graphics_decodes(self, PyObject_IsTrue(wait))) { Py_RETURN_TRUE; }
+    Py_RETURN_FALSE;
+}
+
 static PyObject*
 cursor_at_prompt(Screen *self, PyObject *args UNUSED) {
     int y = screen_cursor_at_a_shell_prompt(self);
@@ -5961,6 +6058,7 @@ static PyMethodDef methods[] = {
     MND(dump_lines_with_attrs, METH_VARARGS)
     MND(cpu_cells, METH_VARARGS)
     MND(cursor_at_prompt, METH_NOARGS)
+    MND(finish_graphics_decodes, METH_O)
     {"visual_line", (PyCFunction)pyvisual_line, METH_VARARGS, ""},
     MND(current_url_text, METH_NOARGS)
     MND(draw, METH_O)
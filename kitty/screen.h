@@ -192,6 +192,13 @@ typedef struct {
     ListOfChars *lc;
     monotonic_t parsing_at;
     ExtraCursors extra_cursors;
+    struct {
+        // for every render row, one past the last cell that draws anything
+        // other than the default background, from the cell and selection data
+        index_type *cells, *selection;
+        unsigned int capacity, render_lines, columns;
+        bool cells_valid, selection_valid;
+    } row_extents;
 } Screen;
 
 #define pixel_scroll_enabled(screen) (OPT(pixel_scroll) && !screen->paused_rendering.expires_at && screen->linebuf == screen->main_linebuf)
@@ -271,6 +278,8 @@ bool screen_is_selection_dirty(Screen *self);
 bool screen_has_selection(Screen*);
 bool screen_invert_colors(Screen *self);
 void screen_update_cell_data(Screen *self, void *address, FONTS_DATA_HANDLE, bool cursor_has_moved);
+void screen_cursor_span(Screen *self, index_type x, index_type y, index_type *num_cols, index_type *num_rows);
+bool screen_row_extents(const Screen *self, unsigned int render_lines, const index_type **cells, const index_type **selection);
 bool screen_is_cursor_visible(const Screen *self);
 unsigned screen_multi_cursor_count(const Screen *self);
 bool screen_selection_range_for_line(Screen *self, index_type y, index_type *start, index_type *end);
@@ -289,6 +298,7 @@ void screen_mark_url(Screen *self, index_type start_x, index_type start_y, index
 void set_active_hyperlink(Screen*, char*, char*);
 hyperlink_id_type screen_mark_hyperlink(Screen*, index_type, index_type);
 void screen_handle_graphics_command(Screen *self, const GraphicsCommand *cmd, const uint8_t *payload);
+bool screen_finish_graphics_decodes(Screen *self, bool wait);
 void screen_handle_multicell_command(Screen *self, const MultiCellCommand *cmd, const uint8_t *payload);
 bool screen_open_url(Screen*);
 bool screen_set_last_visited_prompt(Screen*, index_type);
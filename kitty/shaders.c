@@ -30,6 +30,10 @@ enum {
     NUM_PROGRAMS
 };
 enum { SPRITE_MAP_UNIT, GRAPHICS_UNIT, SPRITE_DECORATIONS_MAP_UNIT };
+// Max number of image quads drawn by a single instanced draw call. Each
+// instance uses two vec4 uniforms so this fits the minimum GL limit of 1024
+// vertex uniform components with room to spare.
+#define GRAPHICS_BATCH_SIZE 64
 
 typedef struct UIRenderData {
     unsigned screen_width, screen_height, cell_width, cell_height, screen_left, screen_top, full_framebuffer_width, full_framebuffer_height;
@@ -641,20 +645,26 @@ cell_prepare_to_render(ssize_t vao_idx, Screen *screen, FONTS_DATA_HANDLE fonts_
 
 static void
 draw_graphics(int program, ImageRenderData *data, GLuint start, GLuint count, float extra_alpha) {
+    static GLfloat src_rects[4 * GRAPHICS_BATCH_SIZE], dest_rects[4 * GRAPHICS_BATCH_SIZE];
     bind_program(program);
     if (program != GRAPHICS_ALPHA_MASK_PROGRAM) glUniform1f(graphics_program_layouts[program].uniforms.extra_alpha, extra_alpha);
     glActiveTexture(GL_TEXTURE0 + GRAPHICS_UNIT);
     GraphicsUniforms *u = &graphics_program_layouts[program].uniforms;
-    for (GLuint i=0; i < count;) {
-        ImageRenderData *group = data + start + i;
-        glBindTexture(GL_TEXTURE_2D, group->texture_id);
-        if (group->group_count == 0) { i++; continue; }
-        for (GLuint k=0; k < group->group_count; k++, i++) {
-            ImageRenderData *rd = data + start + i;
-            glUniform4f(u->src_rect, rd->src_rect.left, rd->src_rect.top, rd->src_rect.right, rd->src_rect.bottom);
-            glUniform4f(u->dest_rect, rd->dest_rect.left, rd->dest_rect.top, rd->dest_rect.right, rd->dest_rect.bottom);
-            draw_quad(true, 0);
+    data += start;
+    for (GLuint i = 0; i < count;) {
+        if (data[i].group_count == 0) { i++; continue; }
+        // Consecutive refs using the same texture, which includes all refs of
+        // an image in a z-index layer, are drawn as instances of a single quad
+        const uint32_t texture_id = data[i].texture_id;
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+        GLsizei n = 0;
+        for (; i < count && n < GRAPHICS_BATCH_SIZE && data[i].texture_id == texture_id && data[i].group_count; i++, n++) {
+            memcpy(src_rects + 4 * n, &data[i].src_rect, sizeof(data[i].src_rect));
+            memcpy(dest_rects + 4 * n, &data[i].dest_rect, sizeof(data[i].dest_rect));
         }
+        glUniform4fv(u->src_rects, n, src_rects);
+        glUniform4fv(u->dest_rects, n, dest_rects);
+        draw_quad(true, n);
     }
 }
 
@@ -1102,14 +1112,75 @@ call_cell_program(int program, const UIRenderData *ui, ssize_t vao_idx, bool for
     bind_vao_uniform_buffer(vao_idx, uniform_buffer, cell_program_layouts[program].render_data.index);
     glUniform1ui(cell_program_layouts[program].uniforms.draw_bg_bitfield, draw_bg_bitfield);
     glUniform1f(cell_program_layouts[program].uniforms.row_offset, row_offset_for_screen(ui->screen));
+    glUniform1ui(cell_program_layouts[program].uniforms.instance_offset, 0);
     if (for_final_output) glEnable(GL_FRAMEBUFFER_SRGB);
     draw_quad(!for_final_output, render_lines_for_screen(ui->screen) * ui->screen->columns);
     if (for_final_output) glDisable(GL_FRAMEBUFFER_SRGB);
 }
 
+static void
+point_cell_attributes_at(ssize_t vao_idx, unsigned first_cell) {
+    // GL 3.3 has no base instance for instanced draws, so offset the instanced
+    // attributes instead. The locations are fixed in cell_vertex.glsl
+    CELL_BUFFERS;
+    repoint_integer_attribute(vao_idx, cell_data_buffer, 0, 3, GL_UNSIGNED_INT, sizeof(GPUCell), first_cell * sizeof(GPUCell) + offsetof(GPUCell, fg));
+    repoint_integer_attribute(vao_idx, cell_data_buffer, 1, 2, GL_UNSIGNED_INT, sizeof(GPUCell), first_cell * sizeof(GPUCell) + offsetof(GPUCell, sprite_idx));
+    repoint_integer_attribute(vao_idx, selection_buffer, 2, 1, GL_UNSIGNED_BYTE, 0, first_cell);
+    glUniform1ui(cell_program_layouts[CELL_PROGRAM].uniforms.instance_offset, first_cell);
+}
+
+static void
+draw_cell_range(ssize_t vao_idx, unsigned start, unsigned end) {
+    if (end <= start) return;
+    point_cell_attributes_at(vao_idx, start);
+    draw_quad(false, end - start);
+}
+
+static bool
+draw_cells_in_row_ranges(const UIRenderData *ui, ssize_t vao_idx) {
+    // Cells after the last one in a row that has text, a non-default
+    // background, a decoration or a selection produce nothing but the default
+    // background. When the background is opaque, clear the window to it and
+    // draw only the cells before that point in each row, so that the work done
+    // scales with the content rather than the window size.
+    Screen *screen = ui->screen;
+    const unsigned render_lines = render_lines_for_screen(screen), columns = screen->columns;
+    const index_type *cell_extents, *selection_extents;
+    if (ui->bg_alpha < 1.f || screen_invert_colors(screen) || !screen_row_extents(screen, render_lines, &cell_extents, &selection_extents)) return false;
+    const CursorRenderInfo *cursor = &screen->cursor_render_info;
+    unsigned cursor_y1 = render_lines, cursor_y2 = 0;
+    if (cursor->is_visible && cursor->cursor_opacity > 0) {
+        // the cursor can span as many rows as the largest multicell scale
+        cursor_y1 = cursor->y + pixel_scroll_enabled(screen); cursor_y2 = cursor_y1 + (1u << SCALE_BITS);
+    }
+    enable_scissor_using_top_left_origin((Viewport){.left=ui->screen_left, .top=ui->screen_top, .width=ui->screen_width, .height=ui->screen_height}, ui->full_framebuffer_height);
+    blank_canvas(1.f, ui->background_color, true);
+    disable_scissor();
+
+    bind_program(CELL_PROGRAM);
+    CELL_BUFFERS;
+    bind_vao_uniform_buffer(vao_idx, uniform_buffer, cell_program_layouts[CELL_PROGRAM].render_data.index);
+    glUniform1ui(cell_program_layouts[CELL_PROGRAM].uniforms.draw_bg_bitfield, DRAW_BOTH_BG);
+    glUniform1f(cell_program_layouts[CELL_PROGRAM].uniforms.row_offset, row_offset_for_screen(screen));
+    glEnable(GL_FRAMEBUFFER_SRGB);
+    // Consecutive rows are merged into a single range when all but the last are drawn in full
+    unsigned start = 0, end = 0;
+    for (unsigned y = 0; y < render_lines; y++) {
+        const unsigned extent = cursor_y1 <= y && y < cursor_y2 ? columns : MAX(cell_extents[y], selection_extents[y]);
+        if (!extent) continue;
+        const unsigned row_start = y * columns;
+        if (row_start != end) { draw_cell_range(vao_idx, start, end); start = row_start; }
+        end = row_start + extent;
+    }
+    draw_cell_range(vao_idx, start, end);
+    glDisable(GL_FRAMEBUFFER_SRGB);
+    point_cell_attributes_at(vao_idx, 0);
+    return true;
+}
+
 static void
 draw_cells_without_layers(const UIRenderData *ui, ssize_t vao_idx) {
-    call_cell_program(CELL_PROGRAM, ui, vao_idx, true, DRAW_BOTH_BG);
+    if (!draw_cells_in_row_ranges(ui, vao_idx)) call_cell_program(CELL_PROGRAM, ui, vao_idx, true, DRAW_BOTH_BG);
 }
 
 static void
@@ -1397,6 +1468,11 @@ blank_os_window(OSWindow *osw) {
 
 static void
 start_os_window_rendering(OSWindow *os_window, Tab *tab) {
+    Region clip;
+    if (os_window_damage_clip(os_window, &clip)) {
+        debug_rendering("Rendering window %llu clipped to: left=%u top=%u right=%u bottom=%u\n", os_window->id, clip.left, clip.top, clip.right, clip.bottom);
+        set_damage_clip((Viewport){.left=clip.left, .top=clip.top, .width=clip.right - clip.left, .height=clip.bottom - clip.top}, os_window->viewport_height);
+    }
     // note that during live resize rendering is done in layers
     if (os_window->live_resize.in_progress) blank_os_window(os_window);
     if (os_window->needs_layers) {
@@ -1430,6 +1506,7 @@ start_os_window_rendering(OSWindow *os_window, Tab *tab) {
 static void
 stop_os_window_rendering(OSWindow *os_window, Tab *tab, Window *active_window) {
     if (OPT(cursor_trail) && tab->cursor_trail.needs_render) draw_cursor_trail(&tab->cursor_trail, active_window);
+    clear_damage_clip();
     if (os_window->needs_layers) {
         set_framebuffer_to_use_for_output(0);
         bind_framebuffer_for_output(0);
@@ -1660,7 +1737,7 @@ init_shaders(PyObject *module) {
     C(CELL_PROGRAM); C(CELL_FG_PROGRAM); C(CELL_BG_PROGRAM); C(BORDERS_PROGRAM);
     C(GRAPHICS_PROGRAM); C(GRAPHICS_PREMULT_PROGRAM); C(GRAPHICS_ALPHA_MASK_PROGRAM);
     C(BGIMAGE_PROGRAM); C(TINT_PROGRAM); C(TRAIL_PROGRAM); C(BLIT_PROGRAM); C(SCREENSHOT_PROGRAM); C(ROUNDED_RECT_PROGRAM);
-    C(GLSL_VERSION);
+    C(GLSL_VERSION); C(GRAPHICS_BATCH_SIZE);
     C(GL_VERSION);
     C(GL_VENDOR);
     C(GL_SHADING_LANGUAGE_VERSION);
@@ -24,6 +24,7 @@
     DIM,
     GLSL_VERSION,
     GRAPHICS_ALPHA_MASK_PROGRAM,
+    GRAPHICS_BATCH_SIZE,
     GRAPHICS_PREMULT_PROGRAM,
     GRAPHICS_PROGRAM,
     MARK,
@@ -205,6 +206,7 @@ def resolve_cell_defines(only_fg: int, only_bg: int, src: str) -> str:
             cell.apply_to_sources(vertex=fn, frag=fn)
             cell.compile(prog, allow_recompile)
         graphics = program_for('graphics')
+        graphics_vertex_replacer = MultiReplacer(GRAPHICS_BATCH_SIZE=GRAPHICS_BATCH_SIZE)
 
         def resolve_graphics_fragment_defines(which: str, is_premult: bool, f: str) -> str:
             ans = f.replace('#define ALPHA_TYPE', f'#define {which}', 1)
@@ -215,7 +217,7 @@ def resolve_graphics_fragment_defines(which: str, is_premult: bool, f: str) -> s
             GRAPHICS_ALPHA_MASK_PROGRAM: ('ALPHA_MASK', False),
             GRAPHICS_PREMULT_PROGRAM: ('IMAGE', True),
         }.items():
-            graphics.apply_to_sources(frag=partial(resolve_graphics_fragment_defines, which, is_premult))
+            graphics.apply_to_sources(vertex=graphics_vertex_replacer, frag=partial(resolve_graphics_fragment_defines, which, is_premult))
             graphics.compile(p, allow_recompile)
 
         program_for('bgimage').compile(BGIMAGE_PROGRAM, allow_recompile)
@@ -21,6 +21,11 @@
 bool FUNC(utf8_decode_to_esc)(UTF8Decoder *d UNUSED, const uint8_t *src UNUSED, size_t src_sz UNUSED) NOSIMD
 const uint8_t* FUNC(find_either_of_two_bytes)(const uint8_t *haystack UNUSED, const size_t sz UNUSED, const uint8_t a UNUSED, const uint8_t b UNUSED) NOSIMD
 void FUNC(xor_data64)(const uint8_t key[64] UNUSED, uint8_t* data UNUSED, const size_t data_sz UNUSED) NOSIMD
+void FUNC(render_alpha_mask_row)(const uint8_t *alpha_mask UNUSED, pixel *dest UNUSED, const size_t count UNUSED, const pixel color UNUSED) NOSIMD
+void FUNC(alpha_mask_to_pixels)(const uint8_t *alpha_mask UNUSED, pixel *dest UNUSED, const size_t count UNUSED, const pixel color UNUSED) NOSIMD
+void FUNC(downsample_and_add_4x4)(const uint8_t *src UNUSED, const size_t src_stride UNUSED, uint8_t *dest UNUSED, const size_t dest_width UNUSED) NOSIMD
+void FUNC(blend_rgba_onto_rgb)(uint8_t *dest UNUSED, const uint8_t *src UNUSED, const size_t count UNUSED) NOSIMD
+void FUNC(blend_rgba_onto_rgba)(uint8_t *dest UNUSED, const uint8_t *src UNUSED, const size_t count UNUSED) NOSIMD
 #undef NOSIMD
 #else
 
@@ -820,6 +825,158 @@ start_classification:
 #undef handle_trailing_bytes
 }
 
+// Pixel kernels {{{
+
+#if KITTY_SIMD_LEVEL == 128
+#define pixels_per_vec 4
+#define set1_epi32 simde_mm_set1_epi32
+#define max_epu32 simde_mm_max_epu32
+#define add_epi32 simde_mm_add_epi32
+#define sub_epi32 simde_mm_sub_epi32
+#define mullo_epi32 simde_mm_mullo_epi32
+#define cmpeq_epi32 simde_mm_cmpeq_epi32
+#define shift_left_by_bits32 simde_mm_slli_epi32
+#define float_vec_t simde__m128
+#define cvtepi32_ps simde_mm_cvtepi32_ps
+#define cvttps_epi32 simde_mm_cvttps_epi32
+#define div_ps simde_mm_div_ps
+static inline integer_t
+FUNC(load_alpha_as_pixels)(const uint8_t *p) { int32_t q; memcpy(&q, p, sizeof(q)); return simde_mm_cvtepu8_epi32(simde_mm_cvtsi32_si128(q)); }
+#else
+#define pixels_per_vec 8
+#define set1_epi32 simde_mm256_set1_epi32
+#define max_epu32 simde_mm256_max_epu32
+#define add_epi32 simde_mm256_add_epi32
+#define sub_epi32 simde_mm256_sub_epi32
+#define mullo_epi32 simde_mm256_mullo_epi32
+#define cmpeq_epi32 simde_mm256_cmpeq_epi32
+#define shift_left_by_bits32 simde_mm256_slli_epi32
+#define float_vec_t simde__m256
+#define cvtepi32_ps simde_mm256_cvtepi32_ps
+#define cvttps_epi32 simde_mm256_cvttps_epi32
+#define div_ps simde_mm256_div_ps
+static inline integer_t
+FUNC(load_alpha_as_pixels)(const uint8_t *p) { return simde_mm256_cvtepu8_epi32(simde_mm_loadl_epi64((const simde__m128i*)p)); }
+#endif
+#define load_alpha_as_pixels FUNC(load_alpha_as_pixels)
+
+void
+FUNC(render_alpha_mask_row)(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color) {
+    const integer_t col = set1_epi32((int)color), low_byte = set1_epi32(0xff);
+    size_t i = 0;
+    for (; i + pixels_per_vec <= count; i += pixels_per_vec) {
+        const integer_t existing = and_si(load_unaligned((const integer_t*)(dest + i)), low_byte);
+        store_unaligned((integer_t*)(dest + i), or_si(col, max_epu32(load_alpha_as_pixels(alpha_mask + i), existing)));
+    }
+    for (; i < count; i++) dest[i] = color | MAX(alpha_mask[i], dest[i] & 0xff);
+    zero_upper();
+}
+
+void
+FUNC(alpha_mask_to_pixels)(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color) {
+    const integer_t col = set1_epi32((int)color);
+    size_t i = 0;
+    for (; i + pixels_per_vec <= count; i += pixels_per_vec) {
+        store_unaligned((integer_t*)(dest + i), or_si(col, load_alpha_as_pixels(alpha_mask + i)));
+    }
+    for (; i < count; i++) dest[i] = color | alpha_mask[i];
+    zero_upper();
+}
+
+void
+FUNC(downsample_and_add_4x4)(const uint8_t *src, const size_t src_stride, uint8_t *dest, const size_t dest_width) {
+    // Horizontal adds do not cross 128 bit lanes so this uses 128 bit
+    // registers at all levels, producing 8 output bytes per iteration.
+    const uint8_t *r0 = src, *r1 = r0 + src_stride, *r2 = r1 + src_stride, *r3 = r2 + src_stride;
+#define widen(p) simde_mm_cvtepu8_epi16(simde_mm_loadl_epi64((const simde__m128i*)(p)))
+#define column_sums(off) simde_mm_add_epi16(simde_mm_add_epi16(widen(r0 + off), widen(r1 + off)), simde_mm_add_epi16(widen(r2 + off), widen(r3 + off)))
+    size_t x = 0;
+    for (; x + 8 <= dest_width; x += 8) {
+        const size_t off = 4 * x;
+        const simde__m128i c0 = column_sums(off), c1 = column_sums(off + 8), c2 = column_sums(off + 16), c3 = column_sums(off + 24);
+        const simde__m128i block_sums = simde_mm_hadd_epi16(simde_mm_hadd_epi16(c0, c1), simde_mm_hadd_epi16(c2, c3));
+        const simde__m128i averages = simde_mm_srli_epi16(block_sums, 4);
+        const simde__m128i existing = simde_mm_loadl_epi64((const simde__m128i*)(dest + x));
+        simde_mm_storel_epi64((simde__m128i*)(dest + x), simde_mm_adds_epu8(existing, simde_mm_packus_epi16(averages, averages)));
+    }
+#undef column_sums
+#undef widen
+    for (; x < dest_width; x++) {
+        unsigned total = 0;
+        for (unsigned c = 4 * x; c < 4 * x + 4; c++) total += r0[c] + r1[c] + r2[c] + r3[c];
+        dest[x] = (uint8_t)MIN(255u, dest[x] + total / 16);
+    }
+}
+
+void
+FUNC(blend_rgba_onto_rgb)(uint8_t *dest, const uint8_t *src, const size_t count) {
+    // Three byte pixels do not fit in 32 bit lanes and shuffles do not cross
+    // 128 bit lanes, so this uses 128 bit registers at all levels, four
+    // pixels per iteration. The loads and stores of dest are 16 bytes wide,
+    // the last four bytes being written back unchanged.
+    const simde__m128i expand = simde_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const simde__m128i pack = simde_mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const simde__m128i keep_tail = simde_mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1);
+    const simde__m128i channel = simde_mm_set1_epi32(0xff), c255 = simde_mm_set1_epi32(255), one = simde_mm_set1_epi32(1);
+    size_t i = 0;
+    for (; i + 6 <= count; i += 4) {
+        const simde__m128i s = simde_mm_loadu_si128((const simde__m128i*)(src + 4 * i));
+        const simde__m128i existing = simde_mm_loadu_si128((const simde__m128i*)(dest + 3 * i));
+        const simde__m128i d = simde_mm_shuffle_epi8(existing, expand);
+        const simde__m128i a = simde_mm_srli_epi32(s, 24), ia = simde_mm_sub_epi32(c255, a);
+        simde__m128i ans = simde_mm_setzero_si128();
+#define C(shift) { \
+        const simde__m128i sc = simde_mm_and_si128(simde_mm_srli_epi32(s, shift), channel), dc = simde_mm_and_si128(simde_mm_srli_epi32(d, shift), channel); \
+        const simde__m128i x = simde_mm_add_epi32(simde_mm_mullo_epi32(sc, a), simde_mm_mullo_epi32(dc, ia)); \
+        /* x / 255 for 0 <= x <= 255 * 255 */ \
+        const simde__m128i q = simde_mm_srli_epi32(simde_mm_add_epi32(simde_mm_add_epi32(x, one), simde_mm_srli_epi32(x, 8)), 8); \
+        ans = simde_mm_or_si128(ans, simde_mm_slli_epi32(q, shift)); }
+        C(0) C(8) C(16)
+#undef C
+        simde_mm_storeu_si128((simde__m128i*)(dest + 3 * i), simde_mm_blendv_epi8(simde_mm_shuffle_epi8(ans, pack), existing, keep_tail));
+    }
+    for (; i < count; i++) blend_rgba_pixel_onto_rgb(dest + 3 * i, src + 4 * i);
+}
+
+void
+FUNC(blend_rgba_onto_rgba)(uint8_t *dest, const uint8_t *src, const size_t count) {
+    const integer_t channel = set1_epi32(0xff), c255 = set1_epi32(255), one = set1_epi32(1), zero = set1_epi32(0);
+    size_t i = 0;
+    for (; i + pixels_per_vec <= count; i += pixels_per_vec) {
+        const integer_t s = load_unaligned((const integer_t*)(src + 4 * i)), d = load_unaligned((const integer_t*)(dest + 4 * i));
+        const integer_t sa = shift_right_by_bits32(s, 24), da = shift_right_by_bits32(d, 24);
+        const integer_t ida = mullo_epi32(da, sub_epi32(c255, sa)), sa255 = mullo_epi32(sa, c255), den = add_epi32(sa255, ida);
+        const float_vec_t fden = cvtepi32_ps(den);
+        // den / 255 for 0 <= den <= 255 * 255
+        integer_t ans = shift_left_by_bits32(shift_right_by_bits32(add_epi32(add_epi32(den, one), shift_right_by_bits32(den, 8)), 8), 24);
+#define C(shift) { \
+        const integer_t sc = and_si(shift_right_by_bits32(s, shift), channel), dc = and_si(shift_right_by_bits32(d, shift), channel); \
+        const integer_t num = add_epi32(mullo_epi32(sa255, sc), mullo_epi32(dc, ida)); \
+        ans = or_si(ans, shift_left_by_bits32(cvttps_epi32(div_ps(cvtepi32_ps(num), fden)), shift)); }
+        C(0) C(8) C(16)
+#undef C
+        // pixels with zero source alpha are left unchanged
+        store_unaligned((integer_t*)(dest + 4 * i), blendv_epi8(ans, d, cmpeq_epi32(sa, zero)));
+    }
+    for (; i < count; i++) blend_rgba_pixel_onto_rgba(dest + 4 * i, src + 4 * i);
+    zero_upper();
+}
+
+#undef pixels_per_vec
+#undef set1_epi32
+#undef max_epu32
+#undef add_epi32
+#undef sub_epi32
+#undef mullo_epi32
+#undef cmpeq_epi32
+#undef shift_left_by_bits32
+#undef float_vec_t
+#undef cvtepi32_ps
+#undef cvttps_epi32
+#undef div_ps
+#undef load_alpha_as_pixels
+// }}}
+
 
 #undef FUNC
 #undef integer_t
@@ -16,6 +16,56 @@ static void (*xor_data64_impl)(const uint8_t key[64], uint8_t* data, const size_
 void xor_data64(const uint8_t key[64], uint8_t* data, const size_t data_sz) { xor_data64_impl(key, data, data_sz); }
 // }}}
 
+// pixel kernels {{{
+static void
+render_alpha_mask_row_scalar(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color) {
+    for (size_t i = 0; i < count; i++) dest[i] = color | MAX(alpha_mask[i], dest[i] & 0xff);
+}
+
+static void
+alpha_mask_to_pixels_scalar(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color) {
+    for (size_t i = 0; i < count; i++) dest[i] = color | alpha_mask[i];
+}
+
+static void
+downsample_and_add_4x4_scalar(const uint8_t *src, const size_t src_stride, uint8_t *dest, const size_t dest_width) {
+    for (size_t x = 0; x < dest_width; x++) {
+        unsigned total = 0;
+        for (const uint8_t *row = src; row < src + 4 * src_stride; row += src_stride) {
+            for (size_t c = 4 * x; c < 4 * x + 4; c++) total += row[c];
+        }
+        dest[x] = (uint8_t)MIN(255u, dest[x] + total / 16);
+    }
+}
+
+static void
+blend_rgba_onto_rgb_scalar(uint8_t *dest, const uint8_t *src, const size_t count) {
+    for (size_t i = 0; i < count; i++) blend_rgba_pixel_onto_rgb(dest + 3 * i, src + 4 * i);
+}
+
+static void
+blend_rgba_onto_rgba_scalar(uint8_t *dest, const uint8_t *src, const size_t count) {
+    for (size_t i = 0; i < count; i++) blend_rgba_pixel_onto_rgba(dest + 4 * i, src + 4 * i);
+}
+
+static void (*render_alpha_mask_row_impl)(const uint8_t*, pixel*, const size_t, const pixel) = render_alpha_mask_row_scalar;
+static void (*alpha_mask_to_pixels_impl)(const uint8_t*, pixel*, const size_t, const pixel) = alpha_mask_to_pixels_scalar;
+static void (*downsample_and_add_4x4_impl)(const uint8_t*, const size_t, uint8_t*, const size_t) = downsample_and_add_4x4_scalar;
+static void (*blend_rgba_onto_rgb_impl)(uint8_t*, const uint8_t*, const size_t) = blend_rgba_onto_rgb_scalar;
+static void (*blend_rgba_onto_rgba_impl)(uint8_t*, const uint8_t*, const size_t) = blend_rgba_onto_rgba_scalar;
+
+void
+render_alpha_mask_row(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color) { render_alpha_mask_row_impl(alpha_mask, dest, count, color); }
+void
+alpha_mask_to_pixels(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color) { alpha_mask_to_pixels_impl(alpha_mask, dest, count, color); }
+void
+downsample_and_add_4x4(const uint8_t *src, const size_t src_stride, uint8_t *dest, const size_t dest_width) { downsample_and_add_4x4_impl(src, src_stride, dest, dest_width); }
+void
+blend_rgba_onto_rgb(uint8_t *dest, const uint8_t *src, const size_t count) { blend_rgba_onto_rgb_impl(dest, src, count); }
+void
+blend_rgba_onto_rgba(uint8_t *dest, const uint8_t *src, const size_t count) { blend_rgba_onto_rgba_impl(dest, src, count); }
+// }}}
+
 // find_either_of_two_bytes {{{
 static const uint8_t*
 find_either_of_two_bytes_scalar(const uint8_t *haystack, const size_t sz, const uint8_t x, const uint8_t y) {
@@ -180,6 +230,99 @@ test_xor64(PyObject *self UNUSED, PyObject *args) {
     return ans;
 }
 
+typedef struct PixelKernels {
+    void (*render_alpha_mask_row)(const uint8_t*, pixel*, const size_t, const pixel);
+    void (*alpha_mask_to_pixels)(const uint8_t*, pixel*, const size_t, const pixel);
+    void (*downsample_and_add_4x4)(const uint8_t*, const size_t, uint8_t*, const size_t);
+    void (*blend_rgba_onto_rgb)(uint8_t*, const uint8_t*, const size_t);
+    void (*blend_rgba_onto_rgba)(uint8_t*, const uint8_t*, const size_t);
+} PixelKernels;
+
+static bool
+pixel_kernels_for(int which_function, PixelKernels *ans) {
+    switch (which_function) {
+        case 0:
+            *ans = (PixelKernels){render_alpha_mask_row, alpha_mask_to_pixels, downsample_and_add_4x4, blend_rgba_onto_rgb, blend_rgba_onto_rgba}; break;
+        case 1:
+            *ans = (PixelKernels){
+                render_alpha_mask_row_scalar, alpha_mask_to_pixels_scalar, downsample_and_add_4x4_scalar, blend_rgba_onto_rgb_scalar, blend_rgba_onto_rgba_scalar}; break;
+        case 2:
+            *ans = (PixelKernels){render_alpha_mask_row_128, alpha_mask_to_pixels_128, downsample_and_add_4x4_128, blend_rgba_onto_rgb_128, blend_rgba_onto_rgba_128}; break;
+        case 3:
+            *ans = (PixelKernels){render_alpha_mask_row_256, alpha_mask_to_pixels_256, downsample_and_add_4x4_256, blend_rgba_onto_rgb_256, blend_rgba_onto_rgba_256}; break;
+        default:
+            PyErr_SetString(PyExc_ValueError, "Unknown which_function");
+            return false;
+    }
+    return true;
+}
+
+static PyObject*
+test_pixel_kernel(PyObject *self UNUSED, PyObject *args) {
+    // kernel: 0 = render_alpha_mask_row, 1 = alpha_mask_to_pixels, 2 = downsample_and_add_4x4,
+    // 3 = blend_rgba_onto_rgb, 4 = blend_rgba_onto_rgba
+    // For the first two dest is an array of pixels, for downsample_and_add_4x4 src is four rows of 4 * len(dest) bytes each
+    // and for the blend kernels src is RGBA pixels and dest is RGB or RGBA pixels
+    RAII_PY_BUFFER(src);
+    RAII_PY_BUFFER(dest);
+    int kernel, which_function = 0; unsigned int color = 0;
+    if (!PyArg_ParseTuple(args, "is*s*|iI", &kernel, &src, &dest, &which_function, &color)) return NULL;
+    PixelKernels k;
+    if (!pixel_kernels_for(which_function, &k)) return NULL;
+    RAII_ALLOC(uint8_t, out, malloc(dest.len + 64));
+    if (!out) return PyErr_NoMemory();
+    memcpy(out, dest.buf, dest.len);
+    memset(out + dest.len, '>', 64);
+    switch (kernel) {
+        case 0: case 1: {
+            const size_t count = dest.len / sizeof(pixel);
+            if ((size_t)src.len < count) { PyErr_SetString(PyExc_ValueError, "alpha mask too short"); return NULL; }
+            (kernel ? k.alpha_mask_to_pixels : k.render_alpha_mask_row)(src.buf, (pixel*)out, count, color);
+        } break;
+        case 2:
+            if ((size_t)src.len != 16 * (size_t)dest.len) { PyErr_SetString(PyExc_ValueError, "src must be four rows of 4 * len(dest)"); return NULL; }
+            k.downsample_and_add_4x4(src.buf, 4 * dest.len, out, dest.len);
+            break;
+        case 3: case 4: {
+            const size_t dest_px_sz = kernel == 3 ? 3 : 4, count = dest.len / dest_px_sz;
+            if ((size_t)dest.len != count * dest_px_sz || (size_t)src.len != 4 * count) { PyErr_SetString(PyExc_ValueError, "src and dest must have the same number of pixels"); return NULL; }
+            (kernel == 3 ? k.blend_rgba_onto_rgb : k.blend_rgba_onto_rgba)(out, src.buf, count);
+        } break;
+        default:
+            PyErr_SetString(PyExc_ValueError, "Unknown kernel");
+            return NULL;
+    }
+    for (int i = 0; i < 64; i++) if (out[i + dest.len] != '>') { PyErr_SetString(PyExc_SystemError, "kernel wrote after end of data region"); return NULL; }
+    return PyBytes_FromStringAndSize((const char*)out, dest.len);
+}
+
+static PyObject*
+benchmark_pixel_kernels(PyObject *self UNUSED, PyObject *args) {
+    int which_function = 0; unsigned int width = 512, iterations = 10000;
+    if (!PyArg_ParseTuple(args, "|iII", &which_function, &width, &iterations)) return NULL;
+    PixelKernels k;
+    if (!pixel_kernels_for(which_function, &k)) return NULL;
+    RAII_ALLOC(uint8_t, mask, malloc(16u * width));
+    RAII_ALLOC(pixel, pixels, malloc(sizeof(pixel) * width));
+    RAII_ALLOC(uint8_t, row, calloc(width, 1));
+    RAII_ALLOC(uint8_t, rgba, malloc(8u * width));
+    if (!mask || !pixels || !row || !rgba) return PyErr_NoMemory();
+    for (unsigned i = 0; i < 8u * width; i++) rgba[i] = (uint8_t)(i * 13);
+    for (unsigned i = 0; i < 16u * width; i++) mask[i] = (uint8_t)(i * 31);
+    for (unsigned i = 0; i < width; i++) pixels[i] = i;
+    monotonic_t start, times[5];
+#define timeit(idx, call) start = monotonic(); for (unsigned i = 0; i < iterations; i++) { call; } times[idx] = monotonic() - start;
+    timeit(0, k.render_alpha_mask_row(mask, pixels, width, 0xffffff00));
+    timeit(1, k.alpha_mask_to_pixels(mask, pixels, width, 0xffffff00));
+    timeit(2, k.downsample_and_add_4x4(mask, 4 * width, row, width));
+    timeit(3, k.blend_rgba_onto_rgb(mask, rgba, width));
+    timeit(4, k.blend_rgba_onto_rgba(rgba + 4 * width, rgba, width));
+#undef timeit
+    return Py_BuildValue("{sdsdsdsdsd}",
+        "render_alpha_mask_row", monotonic_t_to_s_double(times[0]), "alpha_mask_to_pixels", monotonic_t_to_s_double(times[1]),
+        "downsample_and_add_4x4", monotonic_t_to_s_double(times[2]), "blend_rgba_onto_rgb", monotonic_t_to_s_double(times[3]),
+        "blend_rgba_onto_rgba", monotonic_t_to_s_double(times[4]));
+}
 
 // }}}
 
@@ -187,6 +330,8 @@ static PyMethodDef module_methods[] = {
     METHODB(test_utf8_decode_to_sentinel, METH_VARARGS),
     METHODB(test_find_either_of_two_bytes, METH_VARARGS),
     METHODB(test_xor64, METH_VARARGS),
+    METHODB(test_pixel_kernel, METH_VARARGS),
+    METHODB(benchmark_pixel_kernels, METH_VARARGS),
     {NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
@@ -233,6 +378,11 @@ init_simd(void *x) {
         find_either_of_two_bytes_impl = find_either_of_two_bytes_256;
         utf8_decode_to_esc_impl = utf8_decode_to_esc_256;
         xor_data64_impl = xor_data64_256;
+        render_alpha_mask_row_impl = render_alpha_mask_row_256;
+        alpha_mask_to_pixels_impl = alpha_mask_to_pixels_256;
+        downsample_and_add_4x4_impl = downsample_and_add_4x4_256;
+        blend_rgba_onto_rgb_impl = blend_rgba_onto_rgb_256;
+        blend_rgba_onto_rgba_impl = blend_rgba_onto_rgba_256;
     } else {
         A(has_avx2, False);
     }
@@ -241,6 +391,11 @@ init_simd(void *x) {
         if (find_either_of_two_bytes_impl == find_either_of_two_bytes_scalar) find_either_of_two_bytes_impl = find_either_of_two_bytes_128;
         if (utf8_decode_to_esc_impl == utf8_decode_to_esc_scalar) utf8_decode_to_esc_impl = utf8_decode_to_esc_128;
         if (xor_data64_impl == xor_data64_scalar) xor_data64_impl = xor_data64_128;
+        if (render_alpha_mask_row_impl == render_alpha_mask_row_scalar) render_alpha_mask_row_impl = render_alpha_mask_row_128;
+        if (alpha_mask_to_pixels_impl == alpha_mask_to_pixels_scalar) alpha_mask_to_pixels_impl = alpha_mask_to_pixels_128;
+        if (downsample_and_add_4x4_impl == downsample_and_add_4x4_scalar) downsample_and_add_4x4_impl = downsample_and_add_4x4_128;
+        if (blend_rgba_onto_rgb_impl == blend_rgba_onto_rgb_scalar) blend_rgba_onto_rgb_impl = blend_rgba_onto_rgb_128;
+        if (blend_rgba_onto_rgba_impl == blend_rgba_onto_rgba_scalar) blend_rgba_onto_rgba_impl = blend_rgba_onto_rgba_128;
     } else {
         A(has_sse4_2, False);
     }
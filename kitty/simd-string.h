@@ -49,6 +49,36 @@ const uint8_t* find_either_of_two_bytes(const uint8_t *haystack, const size_t sz
 // XOR data with the 64 byte key
 void xor_data64(const uint8_t key[64], uint8_t* data, const size_t data_sz);
 
+// Pixel kernels used when rendering sprites
+// dest[i] = color | MAX(alpha_mask[i], dest[i] & 0xff)
+void render_alpha_mask_row(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color);
+// dest[i] = color | alpha_mask[i]
+void alpha_mask_to_pixels(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color);
+// Saturating add the average of each 4x4 block from the four src rows starting at src into dest
+void downsample_and_add_4x4(const uint8_t *src, const size_t src_stride, uint8_t *dest, const size_t dest_width);
+
+// Pixel kernels used when composing image frames. The blending is done with
+// integer arithmetic and a single float division so that the SIMD
+// implementations produce results identical to these per pixel versions.
+static inline void
+blend_rgba_pixel_onto_rgb(uint8_t *dest, const uint8_t *src) {
+    const uint32_t a = src[3], ia = 255 - a;
+    for (unsigned i = 0; i < 3; i++) dest[i] = (uint8_t)((src[i] * a + dest[i] * ia) / 255);
+}
+
+static inline void
+blend_rgba_pixel_onto_rgba(uint8_t *dest, const uint8_t *src) {
+    const int32_t sa = src[3];
+    if (!sa) return;
+    const int32_t ida = dest[3] * (255 - sa), sa255 = sa * 255, den = sa255 + ida;
+    for (unsigned i = 0; i < 3; i++) dest[i] = (uint8_t)((float)(sa255 * src[i] + dest[i] * ida) / (float)den);
+    dest[3] = (uint8_t)(den / 255);
+}
+// Alpha blend count RGBA pixels from src onto the count RGB pixels in dest
+void blend_rgba_onto_rgb(uint8_t *dest, const uint8_t *src, const size_t count);
+// Alpha blend count RGBA pixels from src onto the count RGBA pixels in dest
+void blend_rgba_onto_rgba(uint8_t *dest, const uint8_t *src, const size_t count);
+
 // SIMD implementations, internal use
 bool utf8_decode_to_esc_128(UTF8Decoder *d, const uint8_t *src, size_t src_sz);
 bool utf8_decode_to_esc_256(UTF8Decoder *d, const uint8_t *src, size_t src_sz);
@@ -56,3 +86,13 @@ const uint8_t* find_either_of_two_bytes_128(const uint8_t *haystack, const size_
 const uint8_t* find_either_of_two_bytes_256(const uint8_t *haystack, const size_t sz, const uint8_t a, const uint8_t b);
 void xor_data64_128(const uint8_t key[64], uint8_t* data, const size_t data_sz);
 void xor_data64_256(const uint8_t key[64], uint8_t* data, const size_t data_sz);
+void render_alpha_mask_row_128(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color);
+void render_alpha_mask_row_256(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color);
+void alpha_mask_to_pixels_128(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color);
+void alpha_mask_to_pixels_256(const uint8_t *alpha_mask, pixel *dest, const size_t count, const pixel color);
+void downsample_and_add_4x4_128(const uint8_t *src, const size_t src_stride, uint8_t *dest, const size_t dest_width);
+void downsample_and_add_4x4_256(const uint8_t *src, const size_t src_stride, uint8_t *dest, const size_t dest_width);
+void blend_rgba_onto_rgb_128(uint8_t *dest, const uint8_t *src, const size_t count);
+void blend_rgba_onto_rgb_256(uint8_t *dest, const uint8_t *src, const size_t count);
+void blend_rgba_onto_rgba_128(uint8_t *dest, const uint8_t *src, const size_t count);
+void blend_rgba_onto_rgba_256(uint8_t *dest, const uint8_t *src, const size_t count);
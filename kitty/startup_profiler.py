@@ -0,0 +1,170 @@
+#!/usr/bin/env python
+# License: GPLv3 Copyright: 2026, Kovid Goyal <kovid at kovidgoyal.net>
+
+# Records how long each module takes to import and when the various stages of
+# startup are reached. Enabled by setting KITTY_PROFILE_STARTUP, see
+# docs/glossary.rst. This module must not import anything from kitty at module
+# level as it is installed before the rest of kitty is imported.
+
+import json
+import os
+import sys
+import time
+from collections.abc import Sequence
+from importlib.abc import Loader, MetaPathFinder
+from importlib.machinery import ModuleSpec
+from types import ModuleType
+from typing import Any
+
+
+class ImportRecord:
+
+    __slots__ = ('name', 'cumulative', 'children_time', 'start')
+
+    def __init__(self, name: str) -> None:
+        self.name = name
+        self.start = self.cumulative = self.children_time = 0.
+
+    @property
+    def self_time(self) -> float:
+        return self.cumulative - self.children_time
+
+
+class TimedLoader(Loader):
+
+    def __init__(self, loader: Loader, profiler: 'StartupProfiler') -> None:
+        self.loader = loader
+        self.profiler = profiler
+
+    def __getattr__(self, name: str) -> Any:
+        return getattr(self.loader, name)
+
+    def create_module(self, spec: ModuleSpec) -> ModuleType | None:
+        # extension modules do all their work here, so time it as well
+        with self.profiler.timing(spec.name):
+            return self.loader.create_module(spec)
+
+    def exec_module(self, module: ModuleType) -> None:
+        # dont leave the proxy around in the module, it is only needed once
+        module.__loader__ = self.loader
+        if module.__spec__ is not None:
+            module.__spec__.loader = self.loader
+        with self.profiler.timing(module.__name__):
+            self.loader.exec_module(module)
+
+
+class Timing:
+
+    def __init__(self, profiler: 'StartupProfiler', name: str) -> None:
+        self.profiler, self.name = profiler, name
+
+    def __enter__(self) -> None:
+        p = self.profiler
+        if (r := p.records.get(self.name)) is None:
+            r = p.records[self.name] = ImportRecord(self.name)
+        r.start = time.monotonic()
+        p.stack.append(r)
+
+    def __exit__(self, *a: object) -> None:
+        p = self.profiler
+        r = p.stack.pop()
+        elapsed = time.monotonic() - r.start
+        r.cumulative += elapsed
+        if p.stack:
+            p.stack[-1].children_time += elapsed
+
+
+class StartupProfiler(MetaPathFinder):
+
+    def __init__(self, output: str) -> None:
+        self.output = output
+        self.started_at = time.monotonic()
+        self.records: dict[str, ImportRecord] = {}
+        self.stack: list[ImportRecord] = []
+        self.marks: list[tuple[str, float]] = []
+        self.reported = False
+
+    def timing(self, name: str) -> Timing:
+        return Timing(self, name)
+
+    def find_spec(self, fullname: str, path: Sequence[str] | None, target: ModuleType | None = None) -> ModuleSpec | None:
+        for finder in sys.meta_path:
+            if finder is self or (find_spec := getattr(finder, 'find_spec', None)) is None:
+                continue
+            spec: ModuleSpec | None = find_spec(fullname, path, target)
+            if spec is not None:
+                if spec.loader is not None and hasattr(spec.loader, 'exec_module'):
+                    spec.loader = TimedLoader(spec.loader, self)
+                return spec
+        return None
+
+    def mark(self, name: str) -> None:
+        self.marks.append((name, time.monotonic() - self.started_at))
+
+    def as_dict(self, max_modules: int = 40) -> dict[str, Any]:
+        records = sorted(self.records.values(), key=lambda r: r.self_time, reverse=True)
+        return {
+            'marks': {name: at * 1000 for name, at in self.marks},
+            'import_time': sum(r.self_time for r in records) * 1000,
+            'num_modules': len(records),
+            'modules': [{'name': r.name, 'self': r.self_time * 1000, 'cumulative': r.cumulative * 1000} for r in records[:max_modules]],
+        }
+
+    def as_text(self) -> str:
+        d = self.as_dict()
+        lines = ['Startup profile, times in ms since profiling started', '']
+        for name, at in d['marks'].items():
+            lines.append(f'{at:9.2f}  {name}')
+        lines.extend(('', f'{d["num_modules"]} modules imported in {d["import_time"]:.2f} ms, slowest:', '     self  cumulative  module'))
+        for m in d['modules']:
+            lines.append(f'{m["self"]:9.2f}  {m["cumulative"]:10.2f}  {m["name"]}')
+        return '\n'.join(lines)
+
+    def report(self) -> None:
+        if self.reported:
+            return
+        self.reported = True
+        if self.output == '-':
+            print(self.as_text(), file=sys.stderr, flush=True)
+            return
+        try:
+            # atomic so that tools waiting for the file never see it partially written
+            with open(self.output + '.tmp', 'w') as f:
+                if self.output.endswith('.json'):
+                    json.dump(self.as_dict(), f, indent=2)
+                else:
+                    print(self.as_text(), file=f)
+            os.replace(f.name, self.output)
+        except OSError as e:
+            print('Failed to write startup profile:', e, file=sys.stderr)
+
+
+profiler: StartupProfiler | None = None
+
+
+def install() -> None:
+    global profiler
+    # not inherited by the children of kitty
+    output = os.environ.pop('KITTY_PROFILE_STARTUP', '')
+    if output and profiler is None:
+        profiler = StartupProfiler(output)
+        sys.meta_path.insert(0, profiler)
+
+
+def mark(name: str) -> None:
+    if profiler is not None:
+        profiler.mark(name)
+
+
+def report_after_first_frame() -> None:
+    # A zero timer fires in the first iteration of the main loop, which is
+    # also where the first frame is rendered, so use it as the end of startup
+    if profiler is not None:
+        from .fast_data_types import add_timer
+
+        def done(timer_id: int | None) -> None:
+            if profiler is not None:
+                profiler.mark('first frame')
+                profiler.report()
+                sys.meta_path.remove(profiler)
+        add_timer(done, 0, False)
@@ -65,6 +65,7 @@ typedef struct Options {
     color_type url_color, background, foreground, active_border_color, inactive_border_color, bell_border_color, tab_bar_background, tab_bar_margin_color,
         window_title_bar_active_foreground, window_title_bar_active_background, window_title_bar_inactive_foreground, window_title_bar_inactive_background;
     monotonic_t repaint_delay, input_delay;
+    unsigned int image_cold_storage_limit;
     bool focus_follows_mouse;
     unsigned int hide_window_decorations;
     bool macos_hide_from_tasks, macos_quit_when_last_window_closed, macos_window_resizable, macos_traditional_fullscreen;
@@ -350,8 +351,39 @@ typedef struct OSWindow {
     CloseRequest close_request;
     bool is_layer_shell, hide_on_focus_loss;
     struct { int x, y; } last_drag_event;
+    struct {
+        // Damaged area of the frame being rendered, in framebuffer pixels with a top left origin
+        Region frame;
+        bool is_full;
+        // Damage of the most recently swapped frames, most recent first
+        Region history[4];
+        unsigned history_count;
+        // set when a rendered frame could not be swapped
+        bool history_is_invalid;
+    } damage;
 } OSWindow;
 
+static inline void
+union_of_regions(Region *d, Region r) {
+    if (r.right <= r.left || r.bottom <= r.top) return;
+    if (d->right <= d->left || d->bottom <= d->top) *d = r;
+    else {
+        d->left = MIN(d->left, r.left); d->top = MIN(d->top, r.top);
+        d->right = MAX(d->right, r.right); d->bottom = MAX(d->bottom, r.bottom);
+    }
+}
+
+static inline void
+damage_os_window_region(OSWindow *w, Region r) { union_of_regions(&w->damage.frame, r); }
+
+static inline void
+damage_os_window(OSWindow *w) { w->damage.is_full = true; }
+
+static inline bool
+os_window_is_damaged(const OSWindow *w) {
+    return w->damage.is_full || (w->damage.frame.right > w->damage.frame.left && w->damage.frame.bottom > w->damage.frame.top);
+}
+
 static inline float
 effective_os_window_alpha(OSWindow *w) {
     return (!w->background_opacity.supports_transparency || w->background_opacity.os_forces_opaque) ?
@@ -512,5 +544,6 @@ void dispatch_buffered_keys(Window *w);
 bool screen_needs_rendering_in_layers(OSWindow *os_window, Window *w, Screen *screen);
 void setup_os_window_for_rendering(OSWindow*, Tab*, Window*, bool);
 void swap_window_buffers(OSWindow *w);
+bool os_window_damage_clip(OSWindow *w, Region *clip);
 void take_screenshot_of_rectangular_region(OSWindow *os_window, Region region, unsigned char *dst_buf, unsigned *thumb_w, unsigned *thumb_h);
 bool current_framebuffer_is_ok(void);
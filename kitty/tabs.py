@@ -9,10 +9,10 @@
 import weakref
 from collections import deque
 from collections.abc import Callable, Generator, Iterable, Iterator, Sequence
-from contextlib import suppress
+from contextlib import contextmanager, suppress
 from functools import wraps
 from gettext import gettext as _
-from typing import Any, Concatenate, Deque, NamedTuple, Optional, ParamSpec, TypeVar, cast
+from typing import TYPE_CHECKING, Any, Concatenate, Deque, NamedTuple, Optional, ParamSpec, TypeVar, cast
 
 from .borders import Border, Borders
 from .child import Child
@@ -55,13 +55,15 @@
 from .layout.base import Layout
 from .layout.interface import create_layout_object_for, evict_cached_layouts
 from .progress import ProgressState
-from .tab_bar import TabBar, TabBarData, apply_title_template
 from .types import ac
 from .typing_compat import EdgeLiteral, SessionTab, SessionType, TypedDict
 from .utils import cmdline_for_hold, color_as_int, log_error, platform_window_id, resolved_shell, shlex_split, which
 from .window import CwdRequest, Watchers, Window, WindowCreationSpec, WindowDict, global_watchers
 from .window_list import WindowList
 
+if TYPE_CHECKING:
+    from .tab_bar import TabBar, TabBarData
+
 P = ParamSpec('P')
 T = TypeVar('T')
 
@@ -381,7 +383,8 @@ def make_relative(cwd: str) -> str:
             ] + launch_cmds
         return []
 
-    def data_for_tab_bar(self, is_active: bool) -> TabBarData:
+    def data_for_tab_bar(self, is_active: bool) -> 'TabBarData':
+        from .tab_bar import TabBarData
         t = self
         title = t.name or t.title or appname
         needs_attention = False
@@ -460,13 +463,19 @@ def on_bell(self, window: Window) -> None:
 
     def relayout(self) -> None:
         if self.allow_relayouts:
+            tm = self.tab_manager_ref()
+            if tm is not None and tm.creating_tabs_in_batch:
+                tm.tabs_touched_in_batch[self.id] = self
+                return
             if self.windows:
                 self.current_layout(self.windows)
             self.relayout_borders()
 
     def relayout_borders(self) -> None:
         tm = self.tab_manager_ref()
-        if tm is not None:
+        if tm is not None and tm.creating_tabs_in_batch:
+            tm.tabs_touched_in_batch[self.id] = self
+        elif tm is not None:
             ly = self.current_layout
             opts = get_options()
             draw_borders = (
@@ -1110,7 +1119,7 @@ def make_active(self) -> None:
 
 
 class TabBeingDropped(NamedTuple):
-    data: TabBarData
+    data: 'TabBarData'
     tab_ids: Sequence[int] = ()
     last_drop_move_x: int = -1
 
@@ -1122,6 +1131,9 @@ class TabManager:  # {{{
     total_progress: int = 0
     has_indeterminate_progress: bool = False
     tab_being_dropped: TabBeingDropped | None = None
+    creating_tabs_in_batch: bool = False
+    # tabs whose layout or borders changed while creating tabs in a batch
+    tabs_touched_in_batch: dict[int, Tab]
 
     def __init__(self, os_window_id: int, args: CLIOptions, wm_class: str, wm_name: str, startup_session: SessionType | None = None):
         self.os_window_id = os_window_id
@@ -1134,22 +1146,51 @@ def __init__(self, os_window_id: int, args: CLIOptions, wm_class: str, wm_name:
         self.tab_bar_hidden = get_options().tab_bar_style == 'hidden'
         self.tabs: list[Tab] = []
         self.active_tab_history: Deque[int] = deque()
-        self.tab_bar = TabBar(self.os_window_id)
+        self._tab_bar: 'TabBar | None' = None
         self._active_tab_idx = 0
 
         if startup_session is not None:
             self.add_tabs_from_session(startup_session)
 
-    @update_tab_bar_visibility
+    @contextmanager
+    def batched_tab_creation(self) -> Generator[list[Tab], None, None]:
+        '''
+        Tabs appended to the yielded list, and any other tabs in this tab
+        manager laid out while they are created, such as tabs focused by the
+        session, are laid out, along with the tab bar, only once all of them
+        have been created. Otherwise every window would be laid out, and its
+        pty resized, once when its tab is created and again when the tab bar
+        becomes visible.
+        '''
+        visible_before = is_tab_bar_visible(self.os_window_id)
+        added_tabs: list[Tab] = []
+        self.tabs_touched_in_batch = {}
+        self.creating_tabs_in_batch = True
+        try:
+            yield added_tabs
+        finally:
+            self.creating_tabs_in_batch = False
+            touched = {t.id: t for t in added_tabs}
+            touched.update(self.tabs_touched_in_batch)
+            self.tabs_touched_in_batch = {}
+            if visible_before != self.tab_bar_should_be_visible and not self.tab_bar_hidden:
+                self.layout_tab_bar()
+                self.resize(only_tabs=True)
+            else:
+                for tab in touched.values():
+                    if tab in self.tabs:
+                        tab.relayout()
+            self.mark_tab_bar_dirty()
+
     def add_tabs_from_session(self, session: SessionType, session_name: str = '') -> None:
         active_tab = self.active_tab
-        added_tabs = []
-        for i, t in enumerate(session.tabs):
-            tab = Tab(self, session_tab=t, session_name=session_name or self.created_in_session_name)
-            self.tabs.append(tab)
-            added_tabs.append(tab)
-            if i == session.active_tab_idx:
-                active_tab = tab
+        with self.batched_tab_creation() as added_tabs:
+            for i, t in enumerate(session.tabs):
+                tab = Tab(self, session_tab=t, session_name=session_name or self.created_in_session_name)
+                self.tabs.append(tab)
+                added_tabs.append(tab)
+                if i == session.active_tab_idx:
+                    active_tab = tab
 
         # Handle focus_tab_spec if specified
         if session.focus_tab_spec is not None:
@@ -1213,9 +1254,17 @@ def active_tab_idx(self, val: int) -> None:
                 if w is not None:
                     w.focus_changed(True)
 
+    @property
+    def tab_bar(self) -> 'TabBar':
+        # created on first use as the tab bar is not shown for a single tab by default
+        if self._tab_bar is None:
+            from .tab_bar import TabBar
+            self._tab_bar = TabBar(self.os_window_id)
+        return self._tab_bar
+
     def refresh_sprite_positions(self) -> None:
-        if not self.tab_bar_hidden:
-            self.tab_bar.screen.refresh_sprite_positions()
+        if not self.tab_bar_hidden and self._tab_bar is not None:
+            self._tab_bar.screen.refresh_sprite_positions()
 
     @property
     def tab_bar_should_be_visible(self) -> bool:
@@ -1243,7 +1292,8 @@ def _set_active_tab(self, idx: int, store_in_history: bool = True) -> None:
     def layout_tab_bar(self) -> None:
         # set tab_bar_should_be_visible so that tab_bar.layout() gets correct dimensions
         self.mark_tab_bar_dirty()
-        self.tab_bar.layout()
+        if self._tab_bar is not None or self.tab_bar_should_be_visible:
+            self.tab_bar.layout()
 
     @property
     def any_window(self) -> Window | None:
@@ -1253,6 +1303,8 @@ def any_window(self) -> Window | None:
         return None
 
     def mark_tab_bar_dirty(self) -> None:
+        if self.creating_tabs_in_batch:
+            return
         should_be_shown = not self.tab_bar_hidden and self.tab_bar_should_be_visible
         mark_tab_bar_dirty(self.os_window_id, should_be_shown)
         w = self.active_window or self.any_window
@@ -1263,7 +1315,8 @@ def mark_tab_bar_dirty(self) -> None:
                 watcher(boss, w, data)
 
     def update_tab_bar_data(self) -> None:
-        self.tab_bar.update(self.tab_bar_data)
+        if self._tab_bar is not None:
+            self._tab_bar.update(self.tab_bar_data)
 
     def title_changed(self, tab: Tab) -> None:
         self.mark_tab_bar_dirty()
@@ -1569,7 +1622,7 @@ def previous_active_tab() -> Tab | None:
         removed_tab.destroy()
 
     @property
-    def tab_bar_data(self) -> Sequence[TabBarData]:
+    def tab_bar_data(self) -> Sequence['TabBarData']:
         at = self.active_tab
         tab_being_dragged_from_here = False
         dragged_tab_id, drag_started = get_tab_being_dragged()[:2]
@@ -1672,6 +1725,7 @@ def swap_tabs(self, idx: int, nidx: int) -> None:
             swap_tabs(self.os_window_id, idx, nidx)
 
     def start_tab_drag(self, pixels: bytes, width: int, height: int) -> None:
+        from .tab_bar import apply_title_template
         dragged_tab_id = get_tab_being_dragged()[0]
         for i, tab in enumerate(self.tabs_to_be_shown_in_tab_bar):
             if tab.id == dragged_tab_id:
@@ -1798,8 +1852,9 @@ def tab_bar_rects(self) -> tuple[Border, ...]:
     def destroy(self) -> None:
         for t in self:
             t.destroy()
-        self.tab_bar.destroy()
-        del self.tab_bar
+        if self._tab_bar is not None:
+            self._tab_bar.destroy()
+            self._tab_bar = None
         del self.tabs
 
     def apply_options(self) -> None:
@@ -1807,7 +1862,8 @@ def apply_options(self) -> None:
         for tab in self:
             tab.apply_options(at is tab)
         self.tab_bar_hidden = get_options().tab_bar_style == 'hidden'
-        self.tab_bar.apply_options()
+        if self._tab_bar is not None:
+            self._tab_bar.apply_options()
         self.update_tab_bar_data()
         self.layout_tab_bar()
 # }}}
@@ -1170,6 +1170,7 @@ def write_to_child(self, data: str | bytes | memoryview) -> None:
 
     def title_updated(self) -> None:
         update_window_title(self.os_window_id, self.tab_id, self.id, self.title)
+        self.notify_rc_subscribers('title', title=self.title)
         t = self.tabref()
         if t is not None:
             t.title_changed(self)
@@ -1254,6 +1255,7 @@ def desktop_notify(self, osc_code: int, raw_datab: memoryview) -> None:
                 log_error(f'Ignoring malmormed OSC 9;4 progress report: {raw_data!r}')
                 return
             self.progress.update(*parts[:2])
+            self.notify_rc_subscribers('progress', state=self.progress.state.name, percent=self.progress.percent)
             if (tab := self.tabref()) is not None:
                 tab.update_progress()
             self.clear_progress_if_needed()
@@ -1265,6 +1267,7 @@ def clear_progress_if_needed(self, timer_id: int | None = None) -> None:
         if timer_id is not None:  # this is a timer callback
             self.clear_progress_timer = 0
         if self.progress.clear_progress():
+            self.notify_rc_subscribers('progress', state=self.progress.state.name, percent=self.progress.percent)
             if (tab := self.tabref()) is not None:
                 tab.update_progress()
         else:
@@ -1358,6 +1361,7 @@ def focus_changed(self, focused: bool) -> None:
             return
         self.is_focused = focused
         call_watchers(weakref.ref(self), 'on_focus_change', {'focused': focused})
+        self.notify_rc_subscribers('focus', focused=focused)
         for c in self.actions_on_focus_change:
             try:
                 c(self, focused)
@@ -1390,6 +1394,10 @@ def title_changed(self, new_title: memoryview | None, is_base64: bool = False) -
         if self.override_title is None:
             self.title_updated()
 
+    def cwd_changed(self) -> None:
+        if self.screen.last_reported_cwd:
+            self.notify_rc_subscribers('cwd', cwd=path_from_osc7_url(self.screen.last_reported_cwd))
+
     def osc_context(self, ctx_data: memoryview) -> None:
         pass  # this is systemd's useless OSC 3008 context protocol https://systemd.io/OSC_CONTEXT/
 
@@ -1415,6 +1423,7 @@ def on_da1(self) -> None:
         self.screen.send_escape_code_to_child(ESC_CSI, da1(get_options()))
 
     def on_bell(self) -> None:
+        self.notify_rc_subscribers('bell')
         cb = get_options().command_on_bell
         if cb and cb != ['none']:
             import shlex
@@ -1714,6 +1723,8 @@ def handle_cmd_end(self, exit_status: str = '') -> None:
 
         self.call_watchers(self.watchers.on_cmd_startstop, {
             "is_start": False, "time": end_time, 'cmdline': self.last_cmd_cmdline, 'exit_status': self.last_cmd_exit_status})
+        self.notify_rc_subscribers(
+            'cmd_finish', cmdline=self.last_cmd_cmdline, exit_status=self.last_cmd_exit_status, duration=last_cmd_output_duration)
 
         opts = get_options()
         when, duration, action, notify_cmdline, _ = opts.notify_on_cmd_finish
@@ -1757,6 +1768,7 @@ def cmd_output_marking(self, is_start: bool | None, cmdline: str = '') -> None:
             cmdline = decode_cmdline(cmdline) if cmdline else ''
             self.last_cmd_cmdline = cmdline
             self.call_watchers(self.watchers.on_cmd_startstop, {"is_start": True, "time": start_time, 'cmdline': cmdline, 'exit_status': 0})
+            self.notify_rc_subscribers('cmd_start', cmdline=cmdline)
         else:
             self.handle_cmd_end(cmdline)
     # }}}
@@ -1857,8 +1869,15 @@ def call_watchers(self, which: Iterable[Watcher], data: dict[str, Any]) -> None:
                 import traceback
                 traceback.print_exc()
 
+    def notify_rc_subscribers(self, event: str, **data: Any) -> None:
+        boss = get_boss()
+        if boss.rc_event_subscriptions:
+            from .remote_control import send_rc_event
+            send_rc_event(boss, event, self, data)
+
     def destroy(self) -> None:
         self.call_watchers(self.watchers.on_close, {})
+        self.notify_rc_subscribers('window_closed')
         self.destroyed = True
         self.clipboard_request_manager.close()
         del self.kitten_result_processors
@@ -84,6 +84,9 @@ def title_changed(self, data, is_base64=False) -> None:
     def osc_context(self, data):
         pass
 
+    def cwd_changed(self) -> None:
+        pass
+
     def icon_changed(self, data) -> None:
         self.iconbuf += str(data, 'utf-8')
 
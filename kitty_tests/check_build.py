@@ -120,6 +120,43 @@ def test_launcher_ensures_stdio(self):
 '''])
         self.assertEqual(cp.returncode, 0)
 
+    def test_spawn_helper(self):
+        from kitty.child import zygote
+        from kitty.constants import is_freebsd, is_macos, spawn_helper_exe
+        helper = spawn_helper_exe()
+        self.assertTrue(helper, 'The spawn helper is missing')
+        self.run_spawn(helper)
+        if not is_macos and not is_freebsd:
+            try:
+                zygote_fd = zygote.fd_for_spawn()
+                self.assertGreater(zygote_fd, -1)
+                self.run_spawn(helper, zygote_fd)
+            finally:
+                zygote.shutdown()
+
+    def run_spawn(self, helper, zygote_fd=-1):
+        from kitty.constants import kitten_exe
+        from kitty.fast_data_types import spawn
+        master, slave = os.openpty()
+        ready_read_fd, ready_write_fd = os.pipe()
+        os.set_inheritable(ready_read_fd, True)
+        passed_read_fd, passed_write_fd = os.pipe()
+        os.set_inheritable(passed_write_fd, True)
+        script = f'[ "$(ps -o sid= -p $$)" -eq $$ ] && tty >/dev/null && echo "$KVAR" >/dev/fd/{passed_write_fd}'
+        try:
+            pid = spawn('/bin/sh', '/', ('sh', '-c', script), ('KVAR=ok', 'PATH=' + os.defpath), master, slave, -1, -1,
+                        ready_read_fd, ready_write_fd, (), kitten_exe(), False, (passed_write_fd,), helper, zygote_fd)
+        finally:
+            for fd in (slave, ready_read_fd, passed_write_fd):
+                os.close(fd)
+        os.close(ready_write_fd)
+        try:
+            self.assertEqual(os.waitpid(pid, 0)[1], 0)
+            with open(passed_read_fd, 'rb') as f:
+                self.assertEqual(f.read(), b'ok\n')
+        finally:
+            os.close(master)
+
 
 def main() -> None:
     tests = unittest.defaultTestLoader.loadTestsFromTestCase(TestBuild)
@@ -15,10 +15,14 @@
     DECAWM,
     ParsedFontFeature,
     get_fallback_font,
+    has_avx2,
+    has_sse4_2,
     set_allow_use_of_box_fonts,
     sprite_idx_to_pos,
     sprite_map_set_layout,
     sprite_map_set_limits,
+    test_cell_data_row_extents,
+    test_pixel_kernel,
     test_render_line,
     test_sprite_position_increment,
     wcwidth,
@@ -301,6 +305,38 @@ def test_sprite_map(self):
         self.ae(test_sprite_position_increment(), (0, 0, 2))
         self.ae(test_sprite_position_increment(), (1, 0, 2))
 
+    def test_pixel_kernels(self):
+        from random import Random
+        r = Random(1234)
+        functions = [0]
+        if has_sse4_2:
+            functions.append(2)
+        if has_avx2:
+            functions.append(3)
+
+        def t(kernel, src, dest, color=0):
+            expected = test_pixel_kernel(kernel, src, dest, 1, color)
+            for which_function in functions:
+                self.ae(expected, test_pixel_kernel(kernel, src, dest, which_function, color), f'{kernel=} {which_function=} {len(dest)=}')
+
+        for count in range(70):
+            mask = r.randbytes(count)
+            pixels = r.randbytes(4 * count)
+            t(0, mask, pixels, 0xabcdef00)
+            t(1, mask, pixels, 0xffffff00)
+            t(2, r.randbytes(16 * count), r.randbytes(count))
+        self.ae(test_pixel_kernel(2, b'\xff' * 16, b'\x10'), b'\xff')
+        self.ae(test_pixel_kernel(2, b'\x20' * 16, b'\x10'), b'\x30')
+
+    def test_cell_data_row_extents(self):
+        from . import parse_bytes
+        s = self.create_screen(cols=10, lines=6, scrollback=0)
+        parse_bytes(s, b'abc  \r\n\x1b[42m  \x1b[m \r\n' + b'x' * 10 + b'\r\n\x1b[4m \x1b[m\r\n\x1b[7m \x1b[m')
+        self.ae(test_cell_data_row_extents(s), ((3, 0), (2, 0), (10, 0), (1, 0), (1, 0), (0, 0)))
+        s.start_selection(1, 5)
+        s.update_selection(3, 5)
+        self.ae(test_cell_data_row_extents(s)[5], (0, 4))
+
     def test_box_drawing(self):
         s = self.create_screen(cols=len(box_chars) + 1, lines=1, scrollback=0)
         prerendered = len(self.sprites)
@@ -309,6 +345,36 @@ def test_box_drawing(self):
         test_render_line(line)
         self.assertEqual(len(self.sprites) - prerendered, len(box_chars))
 
+    def test_box_sprite_cache(self):
+        from kitty.fast_data_types import test_box_sprite_cache
+        scale = (0.001, 1, 1.5, 2)
+        with tempfile.TemporaryDirectory() as tdir:
+            loaded, path, masks = test_box_sprite_cache(tdir, 9, 18, scale)
+            self.assertFalse(loaded)
+            self.assertTrue(os.path.exists(path))
+            loaded, path2, masks2 = test_box_sprite_cache(tdir, 9, 18, scale)
+            self.assertTrue(loaded)
+            self.ae((path, masks), (path2, masks2))
+            # a different box_drawing_scale is a different key and renders differently
+            loaded, path3, masks3 = test_box_sprite_cache(tdir, 9, 18, (0.001, 2, 3, 4))
+            self.assertFalse(loaded)
+            self.assertNotEqual(path, path3)
+            self.assertNotEqual(masks, masks3)
+            # a cached set whose header does not match the key is rejected
+            os.replace(path3, path)
+            loaded, path4, masks4 = test_box_sprite_cache(tdir, 9, 18, scale)
+            self.assertFalse(loaded)
+            self.ae(masks4, masks)
+            # as is a truncated one
+            with open(path, 'r+b') as f:
+                f.truncate(os.path.getsize(path) // 2)
+            self.assertFalse(test_box_sprite_cache(tdir, 9, 18, scale)[0])
+            self.assertTrue(test_box_sprite_cache(tdir, 9, 18, scale)[0])
+            # only the most recently used sets are kept on disk
+            for i in range(40):
+                test_box_sprite_cache(tdir, 4, 4 + i, scale)
+            self.assertLessEqual(len(os.listdir(tdir)), 32)
+
     def test_scaled_box_drawing(self):
         self.scaled_drawing_test()
 
@@ -426,6 +492,37 @@ def test_fallback_font_not_last_resort(self):
         with self.assertRaises(ValueError, msg='No fallback font found'):
             get_fallback_font('\U0010FFFF', False, False)
 
+    @unittest.skipIf(is_macos, 'The fallback font cache is only used with fontconfig')
+    def test_fallback_font_cache(self):
+        from kitty.fast_data_types import fallback_font_cache_info
+        with self.assertRaises(ValueError):
+            get_fallback_font('\U0010FFFD', False, False)
+        before = fallback_font_cache_info()
+        self.assertGreater(before['negative_entries'], 0)
+        # a new font group has to resolve fallback fonts again, it should be
+        # served from the process wide cache
+        with setup_for_testing(size=self.font_size + 1, dpi=self.dpi, main_face_path=self.path_for_font(self.font_name)):
+            with self.assertRaises(ValueError):
+                get_fallback_font('\U0010FFFD', False, False)
+        after = fallback_font_cache_info()
+        self.ae(after['hits'], before['hits'] + 1)
+        self.ae(after['misses'], before['misses'])
+
+    @unittest.skipIf(is_macos, 'The font files cache is only used with fontconfig')
+    def test_font_files_cache(self):
+        from kitty.fast_data_types import font_cache_generation
+        from kitty.fonts.common import font_files_cache_key, load_font_files_cache, resolve_font_files
+        opts = Options()
+        opts.font_family = parse_font_spec('monospace')
+        ff = get_font_files(opts)
+        generation = font_cache_generation()
+        self.ae(load_font_files_cache(generation)[font_files_cache_key(opts)], ff)
+        self.ae(load_font_files_cache(generation + 1), {})
+        self.ae(get_font_files(opts), resolve_font_files(opts))
+        # entries cached by other kitty versions are not used
+        from kitty.constants import str_version
+        self.assertIn(repr(str_version), font_files_cache_key(opts))
+
     def test_coalesce_symbol_maps(self):
         q = {(2, 3): 'a', (4, 6): 'b', (5, 5): 'b', (7, 7): 'b', (9, 9): 'b', (1, 1): 'a'}
         self.ae(coalesce_symbol_maps(q), {(1, 3): 'a', (4, 7): 'b', (9, 9): 'b'})
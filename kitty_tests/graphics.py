@@ -85,6 +85,15 @@ def byte_block(sz):
     return (all_bytes * d) + all_bytes[:m]
 
 
+def rgba_png(data, width, height):
+    def chunk(ctype, payload):
+        return len(payload).to_bytes(4, 'big') + ctype + payload + zlib.crc32(ctype + payload).to_bytes(4, 'big')
+    stride = 4 * width
+    rows = b''.join(b'\0' + data[y * stride:(y + 1) * stride] for y in range(height))
+    ihdr = width.to_bytes(4, 'big') + height.to_bytes(4, 'big') + bytes((8, 6, 0, 0, 0))
+    return b'\x89PNG\r\n\x1a\n' + chunk(b'IHDR', ihdr) + chunk(b'IDAT', zlib.compress(rows)) + chunk(b'IEND', b'')
+
+
 def load_helpers(self):
     s = self.create_screen()
     g = s.grman
@@ -293,6 +302,11 @@ def reset(small_hole_threshold=0, defrag_factor=2):
         dc.wait_for_write()
         self.assertLess(dc.end_of_data_offset(), before)
         check_data()
+        st = dc.stats()
+        self.ae(st['queue_depth'], 0)
+        self.assertGreater(st['entries_written'], 25)
+        self.assertGreaterEqual(st['entries_written'], st['batches_written'])
+        self.assertGreater(st['defrag_steps'], 0)
         dc.clear()
 
         st = time.monotonic()
@@ -355,6 +369,23 @@ def clear_predicate(key):
         remove(3)
         self.assertEqual(dc.holes(), {(1, 9)})
 
+    def test_disk_cache_encryption(self):
+        for mode in ('xor', 'aes-ctr', 'chacha20'):
+            dc = self.create_screen().grman.disk_cache
+            dc.encryption = mode
+            self.ae(dc.encryption, mode)
+            data = {str(i).encode(): os.urandom(i * 37) for i in range(32)}
+            # entries are encrypted in chunks as they are written
+            data[b'large'] = os.urandom(200 * 1024 + 13)
+            for k, v in data.items():
+                dc.add(k, v)
+            self.assertTrue(dc.wait_for_write())
+            for k, v in data.items():
+                self.ae(dc.get(k), v)
+            dc.add(b'in ram', b'abcd')
+            self.ae(dc.get(b'in ram', True), b'abcd')
+        self.assertRaises(ValueError, setattr, dc, 'encryption', 'rot13')
+
     def test_suppressing_gr_command_responses(self):
         s, g, pl, sl = load_helpers(self)
         self.ae(pl('abcd', s=10, v=10, q=1), 'ENODATA:Insufficient image data: 4 < 400')
@@ -469,6 +500,25 @@ def load_temp(prefix='tty-graphics-protocol-'):
         self.assertRaises(
             FileNotFoundError, shm_unlink, name
         )  # check that file was deleted
+
+        # Test loading from persistent POSIX SHM
+        name = '/kitty-test-persistent-shm'
+        frames = [byte_block(4 * 4 * 4 + i)[i:] for i in range(4)]
+        shm_write(name, b''.join(frames[:2]))
+        try:
+            sl(name, s=4, v=4, t='S', O=0, S=64, i=2, expecting_data=frames[0])
+            sl(name, s=4, v=4, t='S', O=64, S=64, i=2, expecting_data=frames[1])
+            self.ae(pl(name, s=4, v=4, t='S', O=100, S=64, i=2).partition(':')[0], 'EINVAL')
+            # the object stays mapped so changes to it are seen
+            shm_write(name, b''.join(frames[2:]))
+            sl(name, s=4, v=4, t='S', O=64, S=64, i=2, expecting_data=frames[3])
+            # growing the object maps it again
+            shm_write(name, b''.join(frames))
+            sl(name, s=4, v=4, t='S', O=192, S=64, i=2, expecting_data=frames[3])
+        finally:
+            shm_unlink(name)
+        # unlinked objects are dropped
+        self.ae(pl(name, s=4, v=4, t='S', S=64, i=2).partition(':')[0], 'EBADF')
         s.reset()
         self.assertEqual(g.disk_cache.total_size, 0)
 
@@ -500,6 +550,22 @@ def png(mode='RGBA'):
         sl(data, f=100, expecting_data=rgba_data)
 
         self.ae(pl(b'a' * 20, f=100, S=20).partition(':')[0], 'EBADPNG')
+
+        # chunked PNG data is decoded as it arrives and errors are reported after the last chunk
+        def chunked(data, i, chunk_sz=7):
+            chunks = [data[x:x + chunk_sz] for x in range(0, len(data), chunk_sz)]
+            for n, chunk in enumerate(chunks):
+                more = int(n < len(chunks) - 1)
+                res = pl(chunk, f=100, i=i, m=more) if n == 0 else pl(chunk, m=more)
+                if more:
+                    self.assertIsNone(res)
+            return res
+        self.ae(chunked(data, 5), 'OK')
+        self.ae(g.image_for_client_id(5)['data'], rgba_data)
+        self.ae(chunked(data, 6, chunk_sz=1), 'OK')
+        self.ae(g.image_for_client_id(6)['data'], rgba_data)
+        self.ae(chunked(data[:len(data) // 2], 7).partition(':')[0], 'ENODATA')
+        self.ae(chunked(b'a' * 20, 8).partition(':')[0], 'EBADPNG')
         s.reset()
         self.assertEqual(g.disk_cache.total_size, 0)
 
@@ -513,6 +579,129 @@ def test_load_png_simple(self):
         # test error handling for loading bad png data
         self.assertRaisesRegex(ValueError, '[EBADPNG]', load_png_data, b'dsfsdfsfsfd')
 
+    def test_async_decode(self):
+        s, g, pl, sl = load_helpers(self)
+        w, h = 512, 512
+        data = byte_block(w * h * 4)
+        compressed = zlib.compress(data)
+        # large images are decoded in the background and responded to once done
+        self.assertIsNone(pl(compressed, s=w, v=h, o='z', i=7))
+        self.ae(g.image_count, 1)
+        s.callbacks.clear()
+        self.assertTrue(s.finish_graphics_decodes(True))
+        self.ae(parse_response(s.callbacks.wtcbuf), 'OK')
+        img = g.image_for_client_id(7)
+        self.ae((img['width'], img['height']), (w, h))
+        self.ae(img['data'], data)
+        self.assertFalse(s.finish_graphics_decodes(True))
+        # errors are reported on completion and the image is removed
+        self.assertIsNone(pl(compressed[:len(compressed) // 2], s=w, v=h, o='z', i=8))
+        s.callbacks.clear()
+        s.finish_graphics_decodes(True)
+        self.ae(parse_response(s.callbacks.wtcbuf).partition(':')[0], 'EINVAL')
+        self.assertIsNone(g.image_for_client_id(8))
+
+        def all_responses(res):
+            return [(r.image_id, r.code) for r in (parse_full_response(x + b'\033\\') for x in res.split(b'\033\\') if x)]
+
+        def responses(payload, **kw):
+            return all_responses(send_command(s, ','.join(f'{k}={v}' for k, v in kw.items()), payload))
+
+        # delete commands wait for pending decodes
+        self.assertIsNone(pl(compressed, s=w, v=h, o='z', i=9))
+        self.ae(responses('', a='d', d='I', i=9), [(9, 'OK')])
+        self.assertIsNone(g.image_for_client_id(9))
+        self.assertFalse(s.finish_graphics_decodes(True))
+        # frame commands wait for the decode of the image they refer to
+        self.assertIsNone(pl(compressed, s=w, v=h, o='z', i=10))
+        self.ae(responses(byte_block(4 * 4 * 4), a='f', s=4, v=4, i=10), [(10, 'OK'), (10, 'OK')])
+        self.ae(len(g.image_for_client_id(10)['extra_frames']), 1)
+        # as do put commands
+        self.assertIsNone(pl(compressed, s=w, v=h, o='z', i=11))
+        self.ae(responses('', a='p', i=11), [(11, 'OK'), (11, 'OK')])
+        self.ae(g.image_for_client_id(11)['data'], data)
+        self.ae(g.image_for_client_id(11)['refs.count'], 1)
+        # a put sees the failure of the decode of its image
+        self.assertIsNone(pl(compressed[:len(compressed) // 2], s=w, v=h, o='z', i=12))
+        self.ae(responses('', a='p', i=12), [(12, 'EINVAL'), (12, 'ENOENT')])
+        self.assertIsNone(g.image_for_client_id(12))
+        # the responses of commands not waiting for a decode are sent after those of earlier decodes
+        self.assertIsNone(pl(compressed, s=w, v=h, o='z', i=13))
+        self.ae(responses(b'abcd', s=1, v=1, i=14), [])
+        self.ae(responses('', a='p', i=14), [])
+        self.ae(responses(b'abcd', a='q', s=1, v=1, i=15), [])
+        self.assertIsNotNone(g.image_for_client_id(14))
+        s.callbacks.clear()
+        self.assertTrue(s.finish_graphics_decodes(True))
+        self.ae(all_responses(s.callbacks.wtcbuf), [(13, 'OK'), (14, 'OK'), (14, 'OK'), (15, 'OK')])
+        self.assertFalse(s.finish_graphics_decodes(True))
+        # large PNG images sent in chunks are decoded in the background as
+        # they arrive, without accumulating the compressed data
+        data = random.Random(16).randbytes(w * h * 4)
+        png = rgba_png(data, w, h)
+        chunks = [png[x:x + 4096] for x in range(0, len(png), 4096)]
+        self.assertGreater(len(chunks), 100)
+
+        def wait_for_decoder():
+            end = time.monotonic() + 10
+            while g.pending_decode_input and time.monotonic() < end:
+                time.sleep(0.001)
+            self.ae(g.pending_decode_input, 0)
+
+        for n, chunk in enumerate(chunks):
+            more = int(n < len(chunks) - 1)
+            self.assertIsNone(pl(chunk, f=100, i=16, m=more) if n == 0 else pl(chunk, m=more))
+            self.assertLessEqual(g.pending_decode_input, len(chunk))
+            wait_for_decoder()
+        s.callbacks.clear()
+        self.assertTrue(s.finish_graphics_decodes(True))
+        self.ae(all_responses(s.callbacks.wtcbuf), [(16, 'OK')])
+        self.ae(g.image_for_client_id(16)['data'], data)
+        # an interrupted transmission abandons its decode
+        for n, chunk in enumerate(chunks[:len(chunks) // 2]):
+            self.assertIsNone(pl(chunk, f=100, i=17, m=1) if n == 0 else pl(chunk, m=1))
+        self.ae(responses('', a='d', d='I', i=17), [(17, 'OK')])
+        self.ae([code for _, code in responses(chunks[-1], m=0)], ['EILSEQ'])
+        self.ae(g.pending_decode_input, 0)
+        self.assertFalse(s.finish_graphics_decodes(True))
+        self.assertIsNone(g.image_for_client_id(17))
+
+    def test_shared_image_data(self):
+        s, g, pl, sl = load_helpers(self)
+        s2, g2, pl2, sl2 = load_helpers(self)
+        w, h = 64, 64
+        data = byte_block(w * h * 4)
+        # identical images in different windows share their data and texture
+        img = sl(data, s=w, v=h)
+        self.ae(img['shared_refcount'], 1)
+        img2 = sl2(data, s=w, v=h, i=3)
+        self.ae(img2['shared_refcount'], 2)
+        self.ae(img['texture_id'], img2['texture_id'])
+        # images are matched by the SHA-256 digest of their data
+        s3, g3, pl3, sl3 = load_helpers(self)
+        self.ae(sl3(data, s=w, v=h, i=5)['shared_refcount'], 3)
+        self.assertIsNone(pl3('', a='d', d='I', i=5))
+        self.ae(g.image_for_client_id(1)['shared_refcount'], 2)
+        self.ae(g.disk_cache.total_size, 0)
+        self.ae(g2.disk_cache.total_size, 0)
+        # different data is not shared
+        other = sl(byte_block(w * h * 4 + 1)[1:], s=w, v=h, i=2)
+        self.ae(other['shared_refcount'], 1)
+        # small images are not shared
+        self.ae(sl(b'abc' * 4, s=2, v=2, f=24, i=4)['shared_refcount'], 0)
+        # modifying frames gives the image a private copy
+        self.ae(pl(byte_block(4 * 4 * 4), a='f', s=4, v=4), 'OK')
+        img = g.image_for_client_id(1)
+        self.ae(img['shared_refcount'], 0)
+        self.ae(img['data'], data)
+        self.assertGreaterEqual(g.disk_cache.total_size, w * h * 4 + 12)
+        self.ae(g2.image_for_client_id(3)['shared_refcount'], 1)
+        self.ae(g2.image_for_client_id(3)['data'], data)
+        # deleting the last reference frees the shared data
+        self.assertIsNone(pl2('', a='d', d='I', i=3))
+        self.assertIsNone(g2.image_for_client_id(3))
+        self.ae(sl2(data, s=w, v=h, i=3)['shared_refcount'], 1)
+
     def test_gr_operations_with_numbers(self):
         s = self.create_screen()
         g = s.grman
@@ -641,6 +830,34 @@ def group_counts():
         self.ae(put_image(s, 8, 16, id=2, z=-1)[1], 'OK')
         self.ae(group_counts(), (2, 1, 1, 2, 1))
 
+    def test_image_layer_culling(self):
+        cw, ch = 10, 20
+        s, dx, dy, put_image, put_ref, layers, rect_eq = put_helpers(self, cw, ch)
+        self.ae(put_image(s, cw, ch, id=1, placement_id=1)[1], 'OK')
+        l0 = layers(s)
+        self.ae(len(l0), 1)
+        rect_eq(l0[0]['dest_rect'], -1, 1, -1 + dx, 1 - dy)
+        # refs entirely outside the screen horizontally are never drawn
+        self.ae(put_ref(s, id=1, placement_id=2, parent_id=1, parent_placement_id=1, offset_from_parent_x=s.columns + 1)[1][0], 'OK')
+        self.ae(layers(s), l0)
+        # scrolling only moves and culls the existing layout
+        rect_eq(layers(s, scrolled_by=1)[0]['dest_rect'], -1, 1 - dy, -1 + dx, 1 - 2 * dy)
+        self.ae(layers(s, scrolled_by=s.lines), ())
+        self.ae(layers(s), l0)
+        # refs scrolled into view from the scrollback are drawn
+        put_ref(s, id=1, placement_id=3, parent_id=1, parent_placement_id=1, offset_from_parent_y=-2)
+        self.ae(len(layers(s)), 1)
+        self.ae(len(layers(s, scrolled_by=2)), 2)
+        # deleting a parent also removes the refs positioned relative to it
+        send_command(s, 'a=d,d=i,i=1,p=1')
+        self.ae(layers(s, scrolled_by=2), ())
+        # deleted refs are dropped from the layout, keeping the draw order
+        for z in (3, 2, 1):
+            self.ae(put_image(s, cw, ch, id=10 + z, z=z)[1], 'OK')
+        self.ae([x['z_index'] for x in layers(s)], [1, 2, 3])
+        send_command(s, 'a=d,d=i,i=12')
+        self.ae([x['z_index'] for x in layers(s)], [1, 3])
+
     def test_image_parents(self):
         cw, ch = 10, 20
         iw, ih = 10, 20
@@ -1264,19 +1481,120 @@ def expand(*rows):
             {'gap': 40, 'id': 3, 'data': b'3' * 12 + (b'333abc' + b'3' * 6) * 2},
         ))
 
-    def test_graphics_quota_enforcement(self):
+    def test_alpha_blending(self):
+        from random import Random
+
+        from kitty.fast_data_types import test_pixel_kernel
+        BLEND_ONTO_RGB, BLEND_ONTO_RGBA = 3, 4
+        # The blend kernels use integer arithmetic so that the SIMD
+        # implementations match the scalar one exactly, their results can
+        # differ from the float formulas below by this much
+        tolerance = 1
+        functions = [0]
+        if has_sse4_2:
+            functions.append(2)
+        if has_avx2:
+            functions.append(3)
+
+        def blend_onto_rgb(under, over):
+            a = over[3] / 255
+            return bytes(int(over[i] * a + under[i] * (1 - a)) for i in range(3))
+
+        def blend_onto_rgba(under, over):
+            if not over[3]:
+                return bytes(under)
+            da, sa = under[3] / 255, over[3] / 255
+            alpha = sa + da * (1 - sa)
+            return bytes(int((over[i] * sa + under[i] * da * (1 - sa)) / alpha) for i in range(3)) + bytes((int(255 * alpha),))
+
+        def t(kernel, over, under):
+            expected = test_pixel_kernel(kernel, over, under, 1)
+            for which_function in functions:
+                self.ae(expected, test_pixel_kernel(kernel, over, under, which_function), f'{kernel=} {which_function=} {len(under)=}')
+            usz = 3 if kernel == BLEND_ONTO_RGB else 4
+            blend = blend_onto_rgb if kernel == BLEND_ONTO_RGB else blend_onto_rgba
+            for i in range(len(over) // 4):
+                u = under[i * usz:(i + 1) * usz]
+                ref, actual = blend(u, over[i * 4:(i + 1) * 4]), expected[i * usz:(i + 1) * usz]
+                self.assertLessEqual(max(abs(x - y) for x, y in zip(ref, actual)), tolerance, f'{kernel=} over={over[i*4:i*4+4]!r} under={u!r}')
+
+        r = Random(1234)
+        for count in range(70):
+            over = bytearray(r.randbytes(4 * count))
+            over[3::8] = bytes(len(over[3::8]))  # fully transparent pixels
+            over[7::16] = b'\xff' * len(over[7::16])  # fully opaque pixels
+            t(BLEND_ONTO_RGB, bytes(over), r.randbytes(3 * count))
+            under = bytearray(r.randbytes(4 * count))
+            under[3::12] = bytes(len(under[3::12]))
+            t(BLEND_ONTO_RGBA, bytes(over), bytes(under))
+        for which_function in functions:
+            # opaque, transparent and half transparent over
+            self.ae(test_pixel_kernel(
+                BLEND_ONTO_RGB, b'\x10\x20\x30\xff' + b'\x10\x20\x30\x00' + b'\xff\x00\x00\x80', b'\x80' * 9, which_function),
+                b'\x10\x20\x30' + b'\x80' * 3 + b'\xbf\x3f\x3f')
+            self.ae(test_pixel_kernel(
+                BLEND_ONTO_RGBA, b'\x10\x20\x30\xff' + b'\x10\x20\x30\x00' + b'\xff\x00\x00\x80', b'\x80\x80\x80\x00' * 3, which_function),
+                b'\x10\x20\x30\xff' + b'\x80\x80\x80\x00' + b'\xff\x00\x00\x80')
+
+    def test_coalesced_frame_cache(self):
         s = self.create_screen()
         g = s.grman
+        li = make_send_command(s)
+        self.assertEqual(li(a='t').code, 'OK')
+        self.assertEqual(li(payload='2' * 36).code, 'OK')
+        self.assertEqual(li(payload='4' * 12, c=2, s=2, v=2).code, 'OK')
+        self.assertEqual(li(payload='5' * 3, c=3, s=1, v=1, x=3, y=2).code, 'OK')
+        self.ae(g.coalesced_frames_cached, 0)
+        # showing a frame caches its coalesced data
+        self.assertIsNone(li(a='a', c=4))
+        self.ae(g.coalesced_frames_cached, 1)
+
+        def frames():
+            return tuple(f['data'] for f in g.image_for_client_id(1)['extra_frames'])
+
+        self.ae(frames(), (b'2' * 36, b'444444222222' * 2 + b'2' * 12, b'444444222222' * 2 + b'222222222555'))
+        # editing a frame invalidates the frames based on it
+        self.assertEqual(li(payload='6' * 36, r=2).code, 'OK')
+        self.ae(frames(), (b'6' * 36, b'444444666666' * 2 + b'6' * 12, b'444444666666' * 2 + b'666666666555'))
+        # as do composition and deletion
+        self.assertEqual(li(a='c', r=1, c=2, w=1, h=1, x=2).code, 'OK')
+        self.ae(frames()[1:], (b'444444abc666' + b'444444666666' + b'6' * 12, b'444444abc666' + b'444444666666' + b'666666666555'))
+        self.assertGreater(g.coalesced_frames_cached, 0)
+        self.assertIsNone(li(a='d', d='f', r=4))
+        self.ae(frames(), (b'666666abc666' + b'6' * 24, b'444444abc666' + b'444444666666' + b'6' * 12))
+        self.assertIsNone(li(a='d', d='I'))
+        self.ae(g.coalesced_frames_cached, 0)
+
+    def test_graphics_quota_enforcement(self):
+        s = self.create_screen(options={'image_cold_storage_limit': 3})
+        g = s.grman
+        self.ae(g.cold_storage_limit, 3 * 1024 * 1024)
         g.storage_limit = 36*2
+        g.cold_storage_limit = 36
         li = make_send_command(s)
         # test quota for simple images
         self.assertEqual(li(a='T').code, 'OK')
         self.assertEqual(li(a='T', i=2).code, 'OK')
         self.assertEqual(g.disk_cache.total_size, g.storage_limit)
         self.assertEqual(g.image_count, 2)
+        # the least recently used image moves to the cold tier
         self.assertEqual(li(a='T', i=3).code, 'OK')
-        self.assertEqual(g.disk_cache.total_size, g.storage_limit)
-        self.assertEqual(g.image_count, 2)
+        self.assertEqual((g.used_storage, g.cold_storage), (g.storage_limit, 36))
+        self.assertEqual(g.image_count, 3)
+        self.assertTrue(g.image_for_client_id(1)['is_cold'])
+        # and is deleted when the cold tier overflows
+        self.assertEqual(li(a='T', i=4).code, 'OK')
+        self.assertEqual(g.disk_cache.total_size, g.storage_limit + g.cold_storage_limit)
+        self.assertEqual(g.image_count, 3)
+        self.assertTrue(g.image_for_client_id(2)['is_cold'])
+        self.assertFalse(g.image_for_client_id(3)['is_cold'])
+        # placing a cold image makes it hot again with its data intact
+        self.assertEqual(li(a='p', i=2, payload='', s=0, v=0, f=0).code, 'OK')
+        img = g.image_for_client_id(2)
+        self.assertFalse(img['is_cold'])
+        self.assertEqual(img['data'], b'abcdefghijkl' * 3)
+        self.assertTrue(g.image_for_client_id(3)['is_cold'])
+        self.assertEqual((g.used_storage, g.cold_storage), (g.storage_limit, 36))
         # test quota for frames
         for i in range(8):
             self.assertEqual(li(payload=f'{i}' * 36, i=2).code, 'OK')
@@ -1287,6 +1605,25 @@ def test_graphics_quota_enforcement(self):
         s.reset()
         self.ae(g.image_count, 0)
         self.assertEqual(g.disk_cache.total_size, 0)
+        # unplaced images move to the cold tier before placed ones, instead of being deleted
+        self.assertEqual(li(a='T', i=1).code, 'OK')
+        self.assertEqual(li(a='T', i=2).code, 'OK')
+        self.assertEqual(li(a='t', i=3).code, 'OK')
+        self.assertTrue(g.image_for_client_id(1)['is_cold'])
+        self.assertEqual(li(a='t', i=4).code, 'OK')
+        self.assertIsNone(g.image_for_client_id(1))
+        self.assertTrue(g.image_for_client_id(3)['is_cold'])
+        self.assertFalse(g.image_for_client_id(2)['is_cold'])
+        self.assertFalse(g.image_for_client_id(4)['is_cold'])
+        self.assertEqual((g.used_storage, g.cold_storage), (g.storage_limit, 36))
+        # placing an image reloaded from the cold tier keeps the hot tier within its limit
+        self.assertEqual(li(a='p', i=3, payload='', s=0, v=0, f=0).code, 'OK')
+        img = g.image_for_client_id(3)
+        self.assertFalse(img['is_cold'])
+        self.assertEqual(img['data'], b'abcdefghijkl' * 3)
+        self.assertTrue(g.image_for_client_id(4)['is_cold'])
+        self.assertFalse(g.image_for_client_id(2)['is_cold'])
+        self.assertEqual((g.used_storage, g.cold_storage), (g.storage_limit, 36))
 
     @unittest.skipIf(Image is None, 'PIL not available, skipping PNG tests')
     def test_cached_rgba_conversion(self):
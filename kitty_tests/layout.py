@@ -4,8 +4,11 @@
 from kitty.config import defaults
 from kitty.fast_data_types import Region
 from kitty.layout.base import lgd
-from kitty.layout.interface import Grid, Horizontal, Splits, Stack, Tall
-from kitty.layout.splits import Pair
+from kitty.layout.grid import Grid
+from kitty.layout.splits import Pair, Splits
+from kitty.layout.stack import Stack
+from kitty.layout.tall import Tall
+from kitty.layout.vertical import Horizontal
 from kitty.types import WindowGeometry
 from kitty.window import EdgeWidths
 from kitty.window_list import WindowList, reset_group_id_counter
@@ -251,6 +254,76 @@ def test_overlay_layout_operations(self):
             q = create_layout(layout_class)
             self.do_overlay_test(q)
 
+    def test_lazy_layout_registry(self):
+        from kitty.layout.interface import all_layouts, layout_class
+        for name in all_layouts:
+            self.ae(layout_class(name).name, name)
+        self.assertIs(layout_class('splits'), Splits)
+
+    def test_batched_tab_creation(self):
+        import weakref
+
+        from kitty.tabs import Tab as RealTab
+        from kitty.tabs import TabManager
+        self.set_options()
+        calls = {}
+
+        class FakeTabManager(TabManager):
+            tab_bar_hidden = True
+            tab_bar_should_be_visible = False
+            tab_bar_rects = ()
+
+            def __init__(self):
+                self.os_window_id = 0
+                self.tabs = []
+
+        class FakeWindows(list):
+            has_more_than_one_visible_group = False
+
+        class CountingLayout:
+            must_draw_borders = needs_window_borders = False
+
+            def __init__(self, tab_id):
+                self.tab_id = tab_id
+
+            def __call__(self, windows):
+                # laying out the windows is what resizes their ptys
+                calls.setdefault(self.tab_id, []).append('relayout')
+
+        def create_tab(tab_id):
+            t = RealTab.__new__(RealTab)
+            t.id = tab_id
+            t.allow_relayouts = True
+            t.tab_manager_ref = weakref.ref(tm)
+            t.windows = FakeWindows((Window(tab_id),))
+            t.current_layout = CountingLayout(tab_id)
+            t.borders = lambda **kw: calls.setdefault(tab_id, []).append('borders')
+            t.update_window_title_bars = lambda: None
+            return t
+
+        tm = FakeTabManager()
+        existing = create_tab(1)
+        tm.tabs.append(existing)
+        with tm.batched_tab_creation() as added_tabs:
+            for tab_id in (2, 3, 4):
+                t = create_tab(tab_id)
+                tm.tabs.append(t)
+                added_tabs.append(t)
+                # as done by Tab.startup() for every window in the session tab
+                t.relayout()
+                t.relayout()
+            # a session focusing a window in a pre-existing tab
+            existing.relayout_borders()
+            existing.relayout()
+            # a tab closed before the batch ends is not laid out
+            tm.tabs.remove(t)
+            self.ae(calls, {})
+        self.ae(calls, {tab_id: ['relayout', 'borders'] for tab_id in (1, 2, 3)})
+        self.ae(tm.tabs_touched_in_batch, {})
+        calls.clear()
+        existing.relayout()
+        self.ae(calls, {1: ['relayout', 'borders']})
+
     def test_splits(self):
         q = create_layout(Splits)
         all_windows = create_windows(q, num=0)
@@ -36,6 +36,12 @@ def test_launcher(self):
     def test_cli_parsing(self):
         cli_parsing(self)
 
+    def test_compiled_config(self):
+        compiled_config(self)
+
+    def test_shared_options(self):
+        shared_options(self)
+
 
 def cli_parsing(self):
     from kitty.cli import CLIOptions, Options, parse_cmdline, parse_option_spec
@@ -201,6 +207,74 @@ def pn(cmdline, **assertions):
     pn('+kitten panel -1 --edge=left', edge='left')
 
 
+def compiled_config(self):
+    from kitty.conf.utils import load_config as _load_config
+    from kitty.conf.utils import recording_dependencies
+    from kitty.config import defaults, load_compiled_config, parse_config, save_compiled_config
+    from kitty.options.parse import merge_result_dicts
+    conf, inc = os.path.join(self.tdir, 'kitty.conf'), os.path.join(self.tdir, 'inc.conf')
+    cache = os.path.join(self.tdir, 'cache', 'compiled')
+
+    def write(path, *lines):
+        with open(path, 'w') as f:
+            print(*lines, sep='\n', file=f)
+
+    def parse():
+        with recording_dependencies() as deps:
+            opts_dict, found_paths = _load_config(defaults, parse_config, merge_result_dicts, conf, inc + '-missing')
+        return deps, (opts_dict, found_paths, [])
+
+    write(conf, 'include inc.conf', 'font_features X +liga', 'map f1 new_window', 'bell_path /sounds/$KITTY_TEST_BELL')
+    write(inc, 'foreground red')
+    os.environ['KITTY_TEST_BELL'] = 'a.wav'
+    try:
+        deps, compiled = parse()
+        self.assertTrue(deps.cacheable)
+        save_compiled_config(cache, deps, compiled)
+        opts_dict = load_compiled_config(cache)[1][0]
+        self.ae(opts_dict['foreground'], to_color('red'))
+        self.ae(opts_dict['bell_path'], '/sounds/a.wav')
+        self.ae(opts_dict['font_features'], compiled[0]['font_features'])
+        self.ae(opts_dict['map'][-1].trigger, compiled[0]['map'][-1].trigger)
+        os.environ['KITTY_TEST_BELL'] = 'b.wav'
+        self.assertIsNone(load_compiled_config(cache))
+        os.environ['KITTY_TEST_BELL'] = 'a.wav'
+        self.assertIsNotNone(load_compiled_config(cache))
+        write(inc, 'foreground blue')
+        self.assertIsNone(load_compiled_config(cache))
+        save_compiled_config(cache, *parse())
+        write(inc + '-missing', 'background red')
+        self.assertIsNone(load_compiled_config(cache))
+        write(inc, 'geninclude g.py')
+        self.assertFalse(parse()[0].cacheable)
+        # problems reported by option parsers without failing
+        write(inc, 'font_features X')
+        del self.error_messages[:]
+        self.assertFalse(parse()[0].cacheable)
+        self.assertTrue(self.error_messages)
+        write(inc, 'foreground red')
+        self.assertTrue(parse()[0].cacheable)
+    finally:
+        del os.environ['KITTY_TEST_BELL']
+
+
+def shared_options(self):
+    from kitty.config import load_config
+    conf = os.path.join(self.tdir, 'shared.conf')
+    with open(conf, 'w') as f:
+        print('font_size 13', file=f)
+    opts = load_config(conf, share=True)
+    self.ae(opts.font_size, 13)
+    self.assertIs(load_config(conf, share=True), opts)
+    self.assertIsNot(load_config(conf, overrides=('font_size 14',), share=True), opts)
+    self.assertIsNot(load_config(conf), opts)
+    with open(conf, 'a') as f:
+        print('font_size 15', file=f)
+    o = load_config(conf, share=True)
+    self.assertIsNot(o, opts)
+    self.ae(o.font_size, 15)
+
+
 def conf_parsing(self):
     from kitty.config import defaults, load_config
     from kitty.constants import is_macos
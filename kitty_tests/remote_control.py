@@ -0,0 +1,115 @@
+#!/usr/bin/env python
+# License: GPLv3 Copyright: 2026, Kovid Goyal <kovid at kovidgoyal.net>
+
+import json
+import os
+from contextlib import suppress
+
+from kitty.types import AsyncResponse
+
+from . import BaseTest
+
+
+def frame(ftype: bytes, payload: bytes = b'') -> bytes:
+    return ftype + len(payload).to_bytes(4, 'big') + payload
+
+
+class TestRemoteControl(BaseTest):
+
+    def test_framed_responses(self):
+        from kitty.remote_control import decode_framed_response
+        raw = frame(b'R', b'{"ok": true}') + frame(b'D', 'hello '.encode()) + frame(b'D', 'wörld'.encode()) + frame(b'E')
+        for i in range(len(raw)):
+            self.assertIsNone(decode_framed_response(raw[:i]))
+        self.ae(decode_framed_response(raw), {'ok': True, 'data': 'hello wörld'})
+        # empty data is present, unlike no data
+        self.ae(decode_framed_response(frame(b'R', b'{"ok": true}') + frame(b'D') + frame(b'E')), {'ok': True, 'data': ''})
+        self.ae(decode_framed_response(frame(b'R', b'{"ok": true}') + frame(b'E')), {'ok': True})
+        with self.assertRaises(ValueError):
+            decode_framed_response(frame(b'X'))
+
+    def test_event_subscriptions(self):
+        from kitty import remote_control as rc
+        from kitty.boss import Boss
+        from kitty.fast_data_types import add_test_peer, send_data_to_peer, test_peer_state
+        from kitty.rc.subscribe import event_names
+
+        class FakeWindow:
+            def __init__(self, wid):
+                self.id = self.tab_id = self.os_window_id = wid
+
+        class FakeBoss:
+            window_id_map = {}
+
+            def __init__(self):
+                self.peer_data_map, self.rc_event_subscriptions = {}, {}
+
+            def match_windows(self, match, self_window, windows):
+                return (w for w in windows if match == f'id:{w.id}')
+
+        boss = FakeBoss()
+        peers = {}
+
+        def subscribe(events, match=''):
+            peer_id, fd = add_test_peer()
+            os.set_blocking(fd, False)
+            peers[peer_id] = fd
+            self.assertIsInstance(rc.start_event_subscription(boss, peer_id, events, match), AsyncResponse)
+            # what the main loop does with an asynchronous response
+            send_data_to_peer(peer_id, b'', True)
+            self.ae(received(peer_id), [{'ok': True}])
+            return peer_id
+
+        def received(peer_id):
+            # the talk thread is not running, so write the pending output as it would
+            self.ae(test_peer_state(peer_id, 'write')['pending_output'], 0)
+            data = b''
+            with suppress(BlockingIOError):
+                while chunk := os.read(peers[peer_id], 65536):
+                    data += chunk
+            prefix, suffix = b'\x1bP@kitty-cmd', b'\x1b\\'
+            return [json.loads(x[len(prefix):]) for x in data.split(suffix) if x]
+
+        def events(event, window, **data):
+            rc.send_rc_event(boss, event, window, data)
+            return [(peer_id, d['data']['event'], d['data'].get('window_id')) for peer_id in peers for d in received(peer_id)]
+
+        orig_limit = rc.MAX_PENDING_EVENT_BYTES
+        p1 = subscribe(frozenset({'title', 'window_closed'}))
+        p2 = subscribe(frozenset(event_names), match='id:2')
+        try:
+            w1, w2 = FakeWindow(1), FakeWindow(2)
+            self.ae(events('title', w1, title='x'), [(p1, 'title', 1)])
+            self.ae(events('focus', w1), [])
+            self.ae(events('focus', w2), [(p2, 'focus', 2)])
+            self.ae(events('title', w2), [(p1, 'title', 2), (p2, 'title', 2)])
+            self.ae(events('window_closed', w2), [(p1, 'window_closed', 2), (p2, 'window_closed', 2)])
+            # window 1 never matched so its closing is not sent to p2
+            self.ae(events('window_closed', w1), [(p1, 'window_closed', 1)])
+            # events leave the peers waiting for an asynchronous response, so
+            # they stay open till the subscriber closes the connection
+            for peer_id in peers:
+                state = test_peer_state(peer_id)
+                self.assertTrue(state['waiting_for_async_response'])
+                self.ae(state['unresponded_messages'], 0)
+
+            # a slow subscriber gets events dropped, and is told about it
+            rc.MAX_PENDING_EVENT_BYTES = 64
+            rc.send_rc_event(boss, 'title', w1, {'title': 'x' * 64})
+            self.assertGreater(test_peer_state(p1)['pending_output'], rc.MAX_PENDING_EVENT_BYTES)
+            rc.send_rc_event(boss, 'title', w1, {})
+            rc.send_rc_event(boss, 'title', w1, {})
+            self.ae([d['data']['title'] for d in received(p1)], ['x' * 64])
+            self.ae(events('title', w1), [(p1, 'events_dropped', None), (p1, 'title', 1)])
+            self.ae(events('title', w1), [(p1, 'title', 1)])
+            self.assertTrue(test_peer_state(p1)['waiting_for_async_response'])
+
+            # closing the connection ends the subscription
+            self.assertIs(Boss.peer_message_received(boss, b'peer_death', p2, True), False)
+            self.ae(list(boss.rc_event_subscriptions), [p1])
+            self.ae(events('title', w2), [(p1, 'title', 2)])
+        finally:
+            rc.MAX_PENDING_EVENT_BYTES = orig_limit
+            for peer_id, fd in peers.items():
+                test_peer_state(peer_id, 'remove')
+                os.close(fd)
@@ -1437,6 +1437,14 @@ def build_launcher(args: Options, launcher_dir: str = '.', bundle_type: str = 's
     desc = f'Linking {emphasis("launcher")} ...'
     cmd = env.cc + ldflags + objects + libs + pylib + ['-o', dest]
     args.compilation_database.add_command(desc, cmd, partial(newer, dest, *objects), key=LinkKey('kitty'))
+    # The spawn helper is exec'ed for every child process so it must be a
+    # small standalone executable not linked against libpython
+    src = 'kitty/launcher/spawn-helper.c'
+    helper = os.path.join(launcher_dir, 'kitty-spawn-helper')
+    link_targets.append(os.path.abspath(helper))
+    cmd = env.cc + cflags + ldflags + [src, '-o', helper]
+    args.compilation_database.add_command(
+        f'Building {emphasis("spawn helper")} ...', cmd, partial(newer, helper, src, 'kitty/launcher/spawn-helper.h'), key=CompileKey(src, os.path.basename(helper)), keyfile=src)
     if args.build_dsym and is_macos:
         desc = f'Linking dSYM {emphasis("launcher")} ...'
         dsym = f'{dest}.dSYM/Contents/Resources/DWARF/{os.path.basename(dest)}'
@@ -1819,6 +1827,7 @@ def create_minimal_macos_bundle(args: Options, launcher_dir: str, relocate: bool
     if relocate:
         shutil.copy2(os.path.join(launcher_dir, "kitty"), bin_dir)
         shutil.copy2(os.path.join(launcher_dir, "kitten"), bin_dir)
+        shutil.copy2(os.path.join(launcher_dir, "kitty-spawn-helper"), bin_dir)
     else:
         build_launcher(args, bin_dir)
         build_static_kittens(args, launcher_dir=bin_dir)
@@ -199,8 +199,10 @@ type rc_io_data struct {
 	handle_response            func(data []byte) error
 	timeout                    time.Duration
 	multiple_payload_generator func(io_data *rc_io_data) (bool, error)
+	on_event                   func(data []byte) error
 
-	chunks_done bool
+	chunks_done     bool
+	framed_response *Response
 }
 
 func (self *rc_io_data) next_chunk() (chunk []byte, err error) {
@@ -235,6 +237,9 @@ func get_response(do_io func(io_data *rc_io_data) ([]byte, error), io_data *rc_i
 		}
 		return nil, err
 	}
+	if io_data.framed_response != nil {
+		return io_data.framed_response, nil
+	}
 	if len(serialized_response) == 0 {
 		if io_data.rc.NoResponse {
 			res := Response{Ok: true}
@@ -244,14 +249,15 @@ func get_response(do_io func(io_data *rc_io_data) ([]byte, error), io_data *rc_i
 		err = fmt.Errorf("Received empty response from kitty")
 		return
 	}
+	return unmarshal_response(serialized_response)
+}
+
+func unmarshal_response(serialized_response []byte) (*Response, error) {
 	var response Response
-	err = json.Unmarshal(serialized_response, &response)
-	if err != nil {
-		err = fmt.Errorf("Invalid response received from kitty, unmarshalling error: %w", err)
-		return
+	if err := json.Unmarshal(serialized_response, &response); err != nil {
+		return nil, fmt.Errorf("Invalid response received from kitty, unmarshalling error: %w", err)
 	}
-	ans = &response
-	return
+	return &response, nil
 }
 
 var running_shell = false
@@ -277,6 +283,8 @@ func send_rc_command(io_data *rc_io_data) (err error) {
 	if err != nil {
 		return
 	}
+	// Responses over sockets can use binary framing, escape codes sent via the tty cannot
+	io_data.rc.BinaryResponse = global_options.to_network != ""
 	var response *Response
 	response, err = get_response(utils.IfElse(global_options.to_network == "", do_tty_io, do_socket_io), io_data)
 	if err != nil || response == nil {
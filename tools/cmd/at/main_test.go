@@ -3,10 +3,12 @@
 package at
 
 import (
+	"encoding/binary"
 	"encoding/json"
 	"fmt"
 	"github.com/kovidgoyal/kitty/tools/crypto"
 	"github.com/kovidgoyal/kitty/tools/utils"
+	"net"
 	"testing"
 )
 
@@ -102,3 +104,74 @@ func TestRCSerialization(t *testing.T) {
 		t.Fatal("Incorrect version in encrypted command: ", ec.Version)
 	}
 }
+
+func TestFramedResponse(t *testing.T) {
+	frame := func(ftype byte, payload string) []byte {
+		ans := []byte{ftype, 0, 0, 0, 0}
+		binary.BigEndian.PutUint32(ans[1:], uint32(len(payload)))
+		return append(ans, payload...)
+	}
+	var raw []byte
+	raw = append(raw, frame('R', `{"ok":true}`)...)
+	raw = append(raw, frame('D', "hello ")...)
+	raw = append(raw, frame('D', "world")...)
+	raw = append(raw, frame('E', "")...)
+	raw = append(raw, "extra"...)
+	// feed the data in every possible pair of pieces
+	for split := 0; split <= len(raw); split++ {
+		f := framed_response_reader{}
+		r, leftover, err := f.feed(raw[:split])
+		if err == nil && r == nil {
+			r, leftover, err = f.feed(raw[split:])
+		} else {
+			leftover = append(leftover, raw[split:]...)
+		}
+		if err != nil {
+			t.Fatal(err)
+		}
+		if r == nil || !r.Ok || !r.Data.is_string || r.Data.as_str != "hello world" || string(leftover) != "extra" {
+			t.Fatalf("Incorrect decoding of framed response split at: %d response: %#v leftover: %#v", split, r, string(leftover))
+		}
+	}
+	// empty data is present, unlike no data
+	f := framed_response_reader{}
+	r, _, err := f.feed(append(append(frame('R', `{"ok":true}`), frame('D', "")...), frame('E', "")...))
+	if err != nil || r == nil || !r.Data.is_string || r.Data.as_str != "" {
+		t.Fatalf("Incorrect decoding of framed response with empty data: %#v %v", r, err)
+	}
+	f = framed_response_reader{}
+	r, _, err = f.feed(append(frame('R', `{"ok":true}`), frame('E', "")...))
+	if err != nil || r == nil || r.Data.is_string {
+		t.Fatalf("Incorrect decoding of framed response without data: %#v %v", r, err)
+	}
+	f = framed_response_reader{}
+	if _, _, err := f.feed(frame('X', "")); err == nil {
+		t.Fatal("Invalid frame type did not cause an error")
+	}
+}
+
+func TestReadEvents(t *testing.T) {
+	server, client := net.Pipe()
+	go func() {
+		for _, ev := range []string{`{"ok": true, "data": {"event": "title", "title": "a"}}`, `{"ok": true, "data": {"event": "bell"}}`} {
+			_, _ = server.Write([]byte(cmd_escape_code_prefix + ev + cmd_escape_code_suffix))
+		}
+		server.Close()
+	}()
+	events := []string{}
+	io_data := rc_io_data{on_event: func(data []byte) error {
+		events = append(events, string(data))
+		return nil
+	}}
+	r := response_reader{}
+	if err := read_events(&r, &client, &io_data, []byte(`{"ok": true}`), nil); err != nil {
+		t.Fatal(err)
+	}
+	if len(events) != 2 || events[0] != `{"event": "title", "title": "a"}` || events[1] != `{"event": "bell"}` {
+		t.Fatalf("Unexpected events: %#v", events)
+	}
+	events = events[:0]
+	if err := read_events(&r, &client, &io_data, []byte(`{"ok": false, "error": "x"}`), nil); err != nil || len(events) != 0 {
+		t.Fatalf("Events read after failed subscription: %v %#v", err, events)
+	}
+}
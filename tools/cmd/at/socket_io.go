@@ -4,6 +4,8 @@ package at
 
 import (
 	"bytes"
+	"encoding/binary"
+	"encoding/json"
 	"errors"
 	"fmt"
 	"io"
@@ -44,13 +46,66 @@ func write_many_to_conn(conn *net.Conn, datums ...[]byte) error {
 	return nil
 }
 
+// Decodes responses sent by kitty with binary framing, used when the command
+// has BinaryResponse set. A response is an R frame containing the response as
+// JSON without its data, zero or more D frames containing the data and an E
+// frame. Every frame is a one byte type followed by the payload size as a big
+// endian uint32 and the payload.
+type framed_response_reader struct {
+	pending  []byte
+	response *Response
+	data     bytes.Buffer
+	has_data bool
+}
+
+const frame_header_size = 5
+
+// Returns the response once it is complete along with any bytes after it
+func (f *framed_response_reader) feed(data []byte) (ans *Response, leftover []byte, err error) {
+	if len(f.pending) > 0 {
+		f.pending = append(f.pending, data...)
+		data = f.pending
+	}
+	for len(data) >= frame_header_size {
+		sz := int(binary.BigEndian.Uint32(data[1:frame_header_size]))
+		if len(data) < frame_header_size+sz {
+			break
+		}
+		payload := data[frame_header_size : frame_header_size+sz]
+		switch data[0] {
+		case 'R':
+			f.response = &Response{}
+			if err = json.Unmarshal(payload, f.response); err != nil {
+				return nil, nil, fmt.Errorf("Invalid response received from kitty, unmarshalling error: %w", err)
+			}
+		case 'D':
+			f.data.Write(payload)
+			f.has_data = true
+		case 'E':
+			if f.response == nil {
+				return nil, nil, fmt.Errorf("Invalid response received from kitty, data without response")
+			}
+			if f.has_data {
+				f.response.Data = ResponseData{as_str: f.data.String(), is_string: true}
+			}
+			return f.response, data[frame_header_size+sz:], nil
+		default:
+			return nil, nil, fmt.Errorf("Invalid response received from kitty, unknown frame type: %d", data[0])
+		}
+		data = data[frame_header_size+sz:]
+	}
+	f.pending = append(f.pending[:0], data...)
+	return
+}
+
 type response_reader struct {
 	parser            wcswidth.EscapeCodeParser
 	storage           [utils.DEFAULT_IO_BUFFER_SIZE]byte
 	pending_responses [][]byte
+	unparsed          []byte
 }
 
-func (r *response_reader) read_response_from_conn(conn *net.Conn, timeout time.Duration) (serialized_response []byte, err error) {
+func (r *response_reader) read_response_from_conn(conn *net.Conn, timeout time.Duration) (serialized_response []byte, framed_response *Response, err error) {
 	keep_going := true
 	if len(r.pending_responses) == 0 {
 		r.parser.HandleDCS = func(data []byte) error {
@@ -60,16 +115,38 @@ func (r *response_reader) read_response_from_conn(conn *net.Conn, timeout time.D
 			}
 			return nil
 		}
+		var frames *framed_response_reader
 		buf := r.storage[:]
 		for keep_going {
-			var n int
-			(*conn).SetDeadline(time.Now().Add(timeout))
-			n, err = (*conn).Read(buf)
-			if err != nil {
-				keep_going = false
-				break
+			var data []byte
+			if len(r.unparsed) > 0 {
+				data, r.unparsed = r.unparsed, nil
+			} else {
+				var n int
+				if timeout > 0 {
+					(*conn).SetDeadline(time.Now().Add(timeout))
+				} else {
+					(*conn).SetDeadline(time.Time{})
+				}
+				n, err = (*conn).Read(buf)
+				if err != nil {
+					keep_going = false
+					break
+				}
+				data = buf[:n]
+			}
+			if frames == nil && len(data) > 0 && data[0] == 'R' {
+				frames = &framed_response_reader{}
+			}
+			if frames != nil {
+				var leftover []byte
+				if framed_response, leftover, err = frames.feed(data); err != nil || framed_response != nil {
+					r.unparsed = append([]byte{}, leftover...)
+					return
+				}
+			} else {
+				r.parser.Parse(data)
 			}
-			r.parser.Parse(buf[:n])
 		}
 	}
 	if len(r.pending_responses) > 0 {
@@ -79,6 +156,39 @@ func (r *response_reader) read_response_from_conn(conn *net.Conn, timeout time.D
 	return
 }
 
+// Reads the events kitty sends after a successful response to the subscribe
+// command till the connection is closed
+func read_events(r *response_reader, conn *net.Conn, io_data *rc_io_data, serialized_response []byte, framed_response *Response) (err error) {
+	response := framed_response
+	if response == nil {
+		if response, err = unmarshal_response(serialized_response); err != nil || !response.Ok {
+			// the error is reported by send_rc_command()
+			return nil
+		}
+	} else if !response.Ok {
+		return nil
+	}
+	for {
+		if serialized_response, framed_response, err = r.read_response_from_conn(conn, 0); err != nil {
+			if errors.Is(err, io.EOF) {
+				err = nil
+			}
+			return
+		}
+		if response = framed_response; response == nil {
+			if response, err = unmarshal_response(serialized_response); err != nil {
+				return
+			}
+		}
+		if !response.Ok {
+			return fmt.Errorf("%s", response.Error)
+		}
+		if err = io_data.on_event(utils.UnsafeStringToBytes(response.Data.as_str)); err != nil {
+			return
+		}
+	}
+}
+
 const cmd_escape_code_prefix = "\x1bP@kitty-cmd"
 const cmd_escape_code_suffix = "\x1b\\"
 
@@ -143,7 +253,7 @@ func simple_socket_io(conn *net.Conn, io_data *rc_io_data) (serialized_response
 			first_escape_code_sent = true
 			if wants_streaming {
 				var streaming_response []byte
-				streaming_response, err = r.read_response_from_conn(conn, io_data.timeout)
+				streaming_response, _, err = r.read_response_from_conn(conn, io_data.timeout)
 				if err != nil {
 					return
 				}
@@ -157,7 +267,11 @@ func simple_socket_io(conn *net.Conn, io_data *rc_io_data) (serialized_response
 	if io_data.rc.NoResponse {
 		return
 	}
-	return r.read_response_from_conn(conn, io_data.timeout)
+	serialized_response, io_data.framed_response, err = r.read_response_from_conn(conn, io_data.timeout)
+	if err == nil && io_data.on_event != nil {
+		err = read_events(&r, conn, io_data, serialized_response, io_data.framed_response)
+	}
+	return
 }
 
 func do_socket_io(io_data *rc_io_data) (serialized_response []byte, err error) {
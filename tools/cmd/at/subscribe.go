@@ -0,0 +1,17 @@
+// License: GPLv3 Copyright: 2026, Kovid Goyal, <kovid at kovidgoyal.net>
+
+package at
+
+import (
+	"fmt"
+	"os"
+)
+
+func setup_subscription(io_data *rc_io_data, args []string, payload *subscribe_json_type) error {
+	payload.Events = escape_list_of_strings(args)
+	io_data.on_event = func(data []byte) error {
+		_, err := fmt.Fprintln(os.Stdout, string(data))
+		return err
+	}
+	return nil
+}
@@ -51,10 +51,11 @@ const (
 type GRT_t int // enum
 
 const (
-	GRT_transmission_direct    GRT_t = iota // d
-	GRT_transmission_file                   // f
-	GRT_transmission_tempfile               // t
-	GRT_transmission_sharedmem              // s
+	GRT_transmission_direct               GRT_t = iota // d
+	GRT_transmission_file                              // f
+	GRT_transmission_tempfile                          // t
+	GRT_transmission_sharedmem                         // s
+	GRT_transmission_persistent_sharedmem              // S
 )
 
 type GRT_o int // enum